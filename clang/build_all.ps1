@@ -1,2 +1,3 @@
 ./build_lib.ps1
 ./build_tests.ps1
+./build_benchmarks.ps1
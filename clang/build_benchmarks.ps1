@@ -0,0 +1,9 @@
+cd $PSScriptRoot
+$CppFiles = ("../src/cpp/benchmarks/benchmarks.cpp")
+clang++ `
+    -std=c++17 -Wall -Wextra -pedantic -g -O2 -pthread -march=native `
+    -D BLAH_NO_THREAD_SUPPORT -D AX_RENDER_STATS `
+    -I ../include -I ../include/assimp-4.1.0/include -I ../src/hpp `
+    -o bin/ax_benchmarks.exe `
+    $CppFiles `
+    bin/libax_render_stats.a
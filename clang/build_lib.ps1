@@ -8,16 +8,30 @@ $CppFiles =
     "../src/cpp/ax/basic_buffer_ops.cpp",
     "../src/cpp/ax/basic_buffer.cpp",
     "../src/cpp/ax/basic_model.cpp",
+    "../src/cpp/ax/basic_texture.cpp",
+    "../src/cpp/ax/edge_list.cpp",
     "../src/cpp/ax/field.cpp",
+    "../src/cpp/ax/frame_pipeline.cpp",
+    "../src/cpp/ax/hierarchical_depth.cpp",
+    "../src/cpp/ax/mapped_file.cpp",
     "../src/cpp/ax/math.cpp",
+    "../src/cpp/ax/model_bvh.cpp",
+    "../src/cpp/ax/model_lods.cpp",
+    "../src/cpp/ax/model_order.cpp",
     "../src/cpp/ax/name.cpp",
     "../src/cpp/ax/parser.cpp",
+    "../src/cpp/ax/planar_buffer.cpp",
     "../src/cpp/ax/reflectable.cpp",
+    "../src/cpp/ax/render_stats.cpp",
     "../src/cpp/ax/string.cpp",
+    "../src/cpp/ax/triangle_traversal.cpp",
     "../src/cpp/ax/type_descriptor.cpp",
     "../src/cpp/ax/type_descriptors.cpp",
     "../src/cpp/ax/type.cpp",
-    "../src/cpp/ax/unparser.cpp")
+    "../src/cpp/ax/unparser.cpp",
+    "../src/cpp/ax/vertex_cache.cpp",
+    "../src/cpp/ax/visibility_buffer.cpp",
+    "../src/cpp/ax/worker_pool.cpp")
 if (!(Test-Path "bin")) { mkdir -p bin }
 clang++ `
     -std=c++17 -Wall -Wextra -pedantic -g -O2 -pthread -march=native `
@@ -27,3 +41,13 @@ clang++ `
 mv *.o bin
 llvm-ar rcs bin/libax.a bin/*.o
 rm bin/*.o
+
+# the benchmarks link a build that gathers render stats
+clang++ `
+    -std=c++17 -Wall -Wextra -pedantic -g -O2 -pthread -march=native `
+    -D BLAH_NO_THREAD_SUPPORT -D AX_RENDER_STATS `
+    -I ../include -I ../include/assimp-4.1.0/include -I ../src/hpp `
+    -c $CppFiles
+mv *.o bin
+llvm-ar rcs bin/libax_render_stats.a bin/*.o
+rm bin/*.o
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <memory>
 #include <iostream>
 #include <fstream>
@@ -5,17 +6,86 @@
 #include <string>
 #include <math.h>
 
+#if defined(__SSSE3__) || defined(__AVX2__)
+    #include <tmmintrin.h>
+    #define AX_TGA_SSSE3
+#endif
+
 #include "ax/basic_buffer.hpp"
 
 #include "ax/prelude.hpp"
 #include "ax/string.hpp"
 #include "ax/basic_model.hpp"
+#include "ax/mapped_file.hpp"
 
 namespace ax
 {
+    static_assert(sizeof(ax::color) == 4, "ax::color must be tightly packed for tga swizzling.");
+
+    // The largest width or height read or written in any format, being the most a tga can store.
+    constexpr int image_side_max = 65535;
+
+    // Convert count tga pixels of 1 (gray), 3 (bgr) or 4 (bgra) bytes each to rgba colors.
+    static void swizzle_from_tga(const uint8_t* source, int inbytespp, int count, ax::color* target)
+    {
+        VAR i = 0;
+#if defined(AX_TGA_SSSE3)
+        VAL alpha = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+        if (inbytespp == 4)
+        {
+            VAL mask = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+            for (; i + 4 <= count; i += 4)
+            {
+                VAL bgra = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 4));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(target + i), _mm_shuffle_epi8(bgra, mask));
+            }
+        }
+        else if (inbytespp == 3)
+        {
+            // each load takes 16 bytes to use 12, so stop while a whole load still fits
+            VAL mask = _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+            for (; i + 6 <= count; i += 4)
+            {
+                VAL bgr = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 3));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(target + i), _mm_or_si128(_mm_shuffle_epi8(bgr, mask), alpha));
+            }
+        }
+        else
+        {
+            const __m128i masks[4] =
+            {
+                _mm_setr_epi8(0, 0, 0, -1, 1, 1, 1, -1, 2, 2, 2, -1, 3, 3, 3, -1),
+                _mm_setr_epi8(4, 4, 4, -1, 5, 5, 5, -1, 6, 6, 6, -1, 7, 7, 7, -1),
+                _mm_setr_epi8(8, 8, 8, -1, 9, 9, 9, -1, 10, 10, 10, -1, 11, 11, 11, -1),
+                _mm_setr_epi8(12, 12, 12, -1, 13, 13, 13, -1, 14, 14, 14, -1, 15, 15, 15, -1)
+            };
+            for (; i + 16 <= count; i += 16)
+            {
+                VAL gray = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+                for (VAR k = 0; k < 4; ++k)
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(target + i + k * 4), _mm_or_si128(_mm_shuffle_epi8(gray, masks[k]), alpha));
+            }
+        }
+#endif
+        for (; i < count; ++i)
+        {
+            VAL pixel = source + i * inbytespp;
+            target[i] = inbytespp < 3 ?
+                ax::color(pixel[0], pixel[0], pixel[0], 255) :
+                ax::color(pixel[2], pixel[1], pixel[0], inbytespp < 4 ? 255 : pixel[3]);
+        }
+    }
+
     basic_buffer::basic_buffer() : basic_buffer(0, 0) { }
 
-    basic_buffer::basic_buffer(int w, int h) : pixels(), width(w), height(h)
+    basic_buffer::basic_buffer(int w, int h) :
+        pixels(),
+        width(w),
+        height(h),
+        tiles_cleared(),
+        tiles_x(0),
+        clear_pixel(),
+        clear_pending(false)
     {
         pixels.resize(width * height);
     }
@@ -32,6 +102,10 @@ namespace ax
             width = image.width;
             height = image.height;
             pixels = image.pixels;
+            tiles_cleared = image.tiles_cleared;
+            tiles_x = image.tiles_x;
+            clear_pixel = image.clear_pixel;
+            clear_pending = image.clear_pending;
         }
         return *this;
     }
@@ -39,12 +113,15 @@ namespace ax
     ax::basic_pixel& basic_buffer::get_pixel_in_place(int x, int y)
     {
         if (x < 0 || y < 0 || x >= width || y >= height) throw std::out_of_range("ax::basic_buffer pixel index out of range.");
+        if (clear_pending) resolve_tile_of(x, y);
         return pixels[x + y * width];
     }
 
     const ax::basic_pixel& basic_buffer::get_pixel(int x, int y) const
     {
-        return const_cast<basic_buffer*>(this)->get_pixel_in_place(x, y);
+        if (x < 0 || y < 0 || x >= width || y >= height) throw std::out_of_range("ax::basic_buffer pixel index out of range.");
+        if (clear_pending && tiles_cleared[x / clear_tile_size + y / clear_tile_size * tiles_x]) return clear_pixel;
+        return pixels[x + y * width];
     }
 
     bool basic_buffer::set_pixel(int x, int y, const ax::basic_pixel& pixel)
@@ -57,25 +134,74 @@ namespace ax
 
     void basic_buffer::fill(const ax::basic_pixel& pixel)
     {
+        reset_clear();
         VAL length = width * height;
         for (VAR i = 0; i < length; ++i) pixels[i] = pixel;
     }
 
+    void basic_buffer::fast_clear(const ax::basic_pixel& pixel)
+    {
+        tiles_x = (width + clear_tile_size - 1) / clear_tile_size;
+        VAL tiles_y = (height + clear_tile_size - 1) / clear_tile_size;
+        tiles_cleared.assign(itoz(tiles_x * tiles_y), static_cast<uint8_t>(1));
+        clear_pixel = pixel;
+        clear_pending = !tiles_cleared.empty();
+    }
+
+    void basic_buffer::resolve_clear()
+    {
+        if (!clear_pending) return;
+        VAL tiles_y = ztoi(tiles_cleared.size()) / tiles_x;
+        for (VAR tile_y = 0; tile_y < tiles_y; ++tile_y)
+            for (VAR tile_x = 0; tile_x < tiles_x; ++tile_x)
+                if (tiles_cleared[tile_x + tile_y * tiles_x]) resolve_tile(tile_x, tile_y);
+        reset_clear();
+    }
+
+    bool basic_buffer::get_tile_cleared(int tile_x, int tile_y) const
+    {
+        return clear_pending && tiles_cleared[tile_x + tile_y * tiles_x] != 0;
+    }
+
+    void basic_buffer::resolve_tile(int tile_x, int tile_y)
+    {
+        VAL x_end = std::min(width, (tile_x + 1) * clear_tile_size);
+        VAL y_end = std::min(height, (tile_y + 1) * clear_tile_size);
+        for (VAR y = tile_y * clear_tile_size; y < y_end; ++y)
+        {
+            VAL row = pixels.begin() + y * width;
+            std::fill(row + tile_x * clear_tile_size, row + x_end, clear_pixel);
+        }
+        tiles_cleared[tile_x + tile_y * tiles_x] = 0;
+    }
+
+    void basic_buffer::resolve_tile_of(int x, int y)
+    {
+        VAL tile_x = x / clear_tile_size;
+        VAL tile_y = y / clear_tile_size;
+        if (tiles_cleared[tile_x + tile_y * tiles_x]) resolve_tile(tile_x, tile_y);
+    }
+
+    void basic_buffer::reset_clear()
+    {
+        tiles_cleared.clear();
+        tiles_x = 0;
+        clear_pending = false;
+    }
+
     void basic_buffer::flip_vertical()
     {
-        VAL line_size = width * get_bytes_per_pixel();
-        VAL full_size = height * line_size;
-        VAL& line = std::unique_ptr<char[]>(new char[line_size]);
-        for (int j = 0; j < height / 2; ++j)
+        resolve_clear();
+        for (VAR j = 0; j < height / 2; ++j)
         {
-            std::memcpy(line.get(), &pixels[j], line_size);
-            std::memcpy(&pixels[j], &pixels[height - 1 - j], line_size);
-            std::memcpy(&pixels[height - 1 - j], line.get(), line_size);
+            VAL row = pixels.begin() + j * width;
+            std::swap_ranges(row, row + width, pixels.begin() + (height - 1 - j) * width);
         }
     }
 
     void basic_buffer::clear()
     {
+        reset_clear();
         pixels.resize(0);
         width = 0;
         height = 0;
@@ -114,25 +240,83 @@ namespace ax
         return specular;
     }
 
+    // Convert the colors of count pixels to the bgra bytes of a 32-bit tga.
+    static void swizzle_to_tga(const ax::basic_pixel* source, int count, uint8_t* target)
+    {
+        VAR i = 0;
+#if defined(AX_TGA_SSSE3)
+        VAL mask = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+        for (; i + 4 <= count; i += 4)
+        {
+            uint32_t colors[4];
+            for (VAR k = 0; k < 4; ++k) std::memcpy(&colors[k], &source[i + k].color, sizeof(ax::color));
+            VAL rgba = _mm_loadu_si128(reinterpret_cast<const __m128i*>(colors));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(target + i * 4), _mm_shuffle_epi8(rgba, mask));
+        }
+#endif
+        for (; i < count; ++i)
+        {
+            VAL& color = source[i].color;
+            target[i * 4] = color.b;
+            target[i * 4 + 1] = color.g;
+            target[i * 4 + 2] = color.r;
+            target[i * 4 + 3] = color.a;
+        }
+    }
+
+    // Convert count tightly packed colors to the bgra bytes of a 32-bit tga.
+    static void swizzle_to_tga(const ax::color* source, int count, uint8_t* target)
+    {
+        VAR i = 0;
+#if defined(AX_TGA_SSSE3)
+        VAL mask = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+        for (; i + 4 <= count; i += 4)
+        {
+            VAL rgba = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(target + i * 4), _mm_shuffle_epi8(rgba, mask));
+        }
+#endif
+        for (; i < count; ++i)
+        {
+            VAL& color = source[i];
+            target[i * 4] = color.b;
+            target[i * 4 + 1] = color.g;
+            target[i * 4 + 2] = color.r;
+            target[i * 4 + 3] = color.a;
+        }
+    }
+
     ax::option<std::string> basic_buffer::try_read_from_tga(const char* file_path)
     {
-        // open tga file
-        std::ifstream in;
-        in.open(file_path, std::ios::binary);
-        if (!in.is_open()) return ax::some("Can't open tga file "_s + file_path + ".");
-        
+        // map tga file
+        ax::mapped_file file;
+        if (file.try_open(file_path)) return ax::some("Can't open tga file "_s + file_path + ".");
+        return try_read_from_tga_data(file.get_data(), file.get_size());
+    }
+
+    ax::option<std::string> basic_buffer::try_read_from_tga_data(const char* data, std::size_t size)
+    {
         // read tga header
         tga_header header;
-        in.read(reinterpret_cast<char*>(&header), sizeof(header));
-        if (!in.good()) return ax::some("An error occured while reading tga header."_s);
-        
+        if (size < sizeof(header)) return ax::some("An error occured while reading tga header."_s);
+        std::memcpy(&header, data, sizeof(header));
+
         // read metadata
-        VAL width = header.width;
-        VAL height = header.height;
+        VAL width = static_cast<int>(static_cast<uint16_t>(header.width));
+        VAL height = static_cast<int>(static_cast<uint16_t>(header.height));
         VAL inbytespp = header.bitsperpixel >> 3;
         if (width <= 0 || height <= 0 || (inbytespp != 1 && inbytespp != 3 && inbytespp != 4)) return ax::some("Bad width, height, or bpp value."_s);
-        
+        VAL top_left = (header.imagedescriptor & 0x20) != 0;
+
+        // skip the image id and any color map
+        VAL colormap_size = header.colormaptype != 0 ?
+            itoz(static_cast<uint16_t>(header.colormaplength)) * ((itoz(static_cast<uint8_t>(header.colormapdepth)) + 7_z) / 8_z) :
+            0_z;
+        VAL data_offset = sizeof(header) + itoz(static_cast<uint8_t>(header.idlength)) + colormap_size;
+        if (size < data_offset) return ax::some("An error occured while reading tga header."_s);
+
         // reset fields
+        reset_clear();
         this->width = width;
         this->height = height;
         this->pixels.resize(width * height);
@@ -140,162 +324,417 @@ namespace ax
         // read content
         if (header.datatypecode == 2 || header.datatypecode == 3)
         {
-            VAL& error_opt = try_read_data_raw(inbytespp, in);
+            VAL& error_opt = try_read_data_raw(inbytespp, top_left, data + data_offset, size - data_offset);
             if (error_opt) return error_opt;
         }
         else if (header.datatypecode == 10 || header.datatypecode == 11)
         {
-            VAL& error_opt = try_read_data_rle(inbytespp, in);
+            VAL& error_opt = try_read_data_rle(inbytespp, top_left, data + data_offset, size - data_offset);
             if (error_opt) return error_opt;
         }
         else return ax::some("Unknown tga data type code "_s + header.datatypecode + ".");
 
-        // always flip after read due to buffer layout expectations (upside-down)
-        flip_vertical();
-
         // fin
         return ax::none<std::string>();
     }
 
-    ax::option<std::string> basic_buffer::try_write_to_tga(const char *file_path) const
+    ax::option<std::string> basic_buffer::try_write_to_tga(const char* file_path) const
     {
-        // flip self because buffer always has image upside-down
-        const_cast<basic_buffer*>(this)->flip_vertical();
-
         // open file for writing
         std::ofstream out;
         out.open(file_path, std::ios::binary);
-        if (!out.is_open())
-        {
-            const_cast<basic_buffer*>(this)->flip_vertical();
-            return ax::some("Can't open tga file "_s + file_path + " for saving an ax::basic_buffer.");
-        }
+        if (!out.is_open()) return ax::some("Can't open tga file "_s + file_path + " for saving an ax::basic_buffer.");
 
-        // write header
+        // write header, content and footer
+        VAL& header_error_opt = try_write_tga_header(width, height, out);
+        if (header_error_opt) return header_error_opt;
+        if (try_write_tga_rows(0, height, out) || try_write_tga_footer(out)) return ax::some("Failed to write to ax::basic_buffer to "_s + file_path + ".");
+        return ax::none<std::string>();
+    }
+
+    ax::option<std::string> basic_buffer::try_write_tga_header(int width, int height, std::ostream& out)
+    {
+        // write header, leaving the origin at the bottom-left to match the buffer's row order
+        if (width < 0 || height < 0 || width > image_side_max || height > image_side_max) return ax::some("Can't write a tga of "_s + std::to_string(width) + "x" + std::to_string(height) + " pixels.");
         tga_header header;
         std::memset(reinterpret_cast<char*>(&header), 0, sizeof(header));
         header.bitsperpixel = static_cast<char>(32);
-        header.width = static_cast<short>(width);
-        header.height = static_cast<short>(height);
+        header.width = static_cast<short>(static_cast<uint16_t>(width));
+        header.height = static_cast<short>(static_cast<uint16_t>(height));
         header.datatypecode = 2;
-        out.write(reinterpret_cast<char*>(&header), sizeof(header));        
-        if (!out.good())
-        {
-            const_cast<basic_buffer*>(this)->flip_vertical();
-            return ax::some("Failed to write tga header."_s);
-        }
+        out.write(reinterpret_cast<char*>(&header), sizeof(header));
+        if (!out.good()) return ax::some("Failed to write tga header."_s);
+        return ax::none<std::string>();
+    }
 
-        // write content
-        VAL length = width * height;
-        for (VAR i = 0; i < length; ++i)
+    ax::option<std::string> basic_buffer::try_write_tga_rows(int row_begin, int row_end, std::ostream& out) const
+    {
+        // write content in blocks of rows swizzled into a staging buffer
+        if (row_begin < 0 || row_end > height) throw std::out_of_range("ax::basic_buffer row index out of range.");
+        constexpr VAR block_size = 256_z * 1024_z;
+        VAL row_size = itoz(width) * sizeof(ax::color);
+        VAL block_rows = row_size > 0_z ? std::max(1, ztoi(block_size / row_size)) : 1;
+        std::vector<uint8_t> staging(itoz(block_rows) * row_size);
+        uint8_t clear_bgra[4];
+        swizzle_to_tga(&clear_pixel, 1, clear_bgra);
+        for (VAR j = row_begin; j < row_end && out.good(); j += block_rows)
         {
-            VAR color = color_to_tga(pixels[i].color);
-            out.write(reinterpret_cast<char*>(&color), sizeof(ax::color));
+            // swizzle whole rows at once unless fast-cleared tiles need encoding from the clear pixel
+            VAL row_count = std::min(block_rows, row_end - j);
+            if (!clear_pending) swizzle_to_tga(pixels.data() + itoz(j) * itoz(width), row_count * width, staging.data());
+            else
+            {
+                for (VAR y = j; y < j + row_count; ++y)
+                {
+                    VAL row_staging = staging.data() + itoz(y - j) * row_size;
+                    for (VAR tile_x = 0; tile_x < tiles_x; ++tile_x)
+                    {
+                        VAL x = tile_x * clear_tile_size;
+                        VAL count = std::min(clear_tile_size, width - x);
+                        if (tiles_cleared[tile_x + y / clear_tile_size * tiles_x]) for (VAR i = 0; i < count; ++i) std::memcpy(row_staging + itoz(x + i) * 4_z, clear_bgra, 4_z);
+                        else swizzle_to_tga(pixels.data() + itoz(y) * itoz(width) + itoz(x), count, row_staging + itoz(x) * 4_z);
+                    }
+                }
+            }
+            out.write(reinterpret_cast<const char*>(staging.data()), static_cast<std::streamsize>(itoz(row_count) * row_size));
         }
+        if (!out.good()) return ax::some("Failed to write tga rows."_s);
+        return ax::none<std::string>();
+    }
 
-        // check content
-        if (!out.good())
+    ax::option<std::string> basic_buffer::try_write_tga_colors(const ax::color* colors, std::size_t count, std::ostream& out)
+    {
+        // write colors in blocks swizzled into a staging buffer
+        constexpr VAR block_size = 64_z * 1024_z;
+        std::vector<uint8_t> staging(std::min(count, block_size) * sizeof(ax::color));
+        for (VAR i = 0_z; i < count && out.good(); i += block_size)
         {
-            const_cast<basic_buffer*>(this)->flip_vertical();
-            return ax::some("Failed to write to ax::basic_buffer to "_s + file_path + ".");
+            VAL block_count = std::min(block_size, count - i);
+            swizzle_to_tga(colors + i, ztoi(block_count), staging.data());
+            out.write(reinterpret_cast<const char*>(staging.data()), static_cast<std::streamsize>(block_count * sizeof(ax::color)));
         }
+        if (!out.good()) return ax::some("Failed to write tga rows."_s);
+        return ax::none<std::string>();
+    }
 
-        // write dev area ref
-        uint8_t developer_area_ref[4] = { 0, 0, 0, 0 };
-        out.write(reinterpret_cast<char*>(developer_area_ref), sizeof(developer_area_ref));
-        if (!out.good())
-        {
-            const_cast<basic_buffer*>(this)->flip_vertical();
-            return ax::some("Failed to write to ax::basic_buffer to "_s + file_path + ".");
-        }
+    ax::option<std::string> basic_buffer::try_write_tga_footer(std::ostream& out)
+    {
+        // write dev area ref, extension area ref and footer
+        uint8_t footer[26] = { 0, 0, 0, 0, 0, 0, 0, 0, 'T','R','U','E','V','I','S','I','O','N','-','X','F','I','L','E','.','\0' };
+        out.write(reinterpret_cast<char*>(footer), sizeof(footer));
+        if (!out.good()) return ax::some("Failed to write tga footer."_s);
+        return ax::none<std::string>();
+    }
 
-        // write extension area ref
-        uint8_t extension_area_ref[4] = { 0, 0, 0, 0 };
-        out.write(reinterpret_cast<char*>(extension_area_ref), sizeof(extension_area_ref));
-        if (!out.good())
+    ax::option<std::string> basic_buffer::try_read_data_raw(int inbytespp, bool top_left, const char* data, std::size_t size)
+    {
+        VAL row_size = itoz(width) * itoz(inbytespp);
+        if (size < row_size * itoz(height)) return ax::some("An error occured while reading tga data."_s);
+        VAL source = reinterpret_cast<const uint8_t*>(data);
+        std::vector<ax::color> row(width);
+        for (VAR j = 0; j < height; ++j)
         {
-            const_cast<basic_buffer*>(this)->flip_vertical();
-            return ax::some("Failed to write to ax::basic_buffer to "_s + file_path + ".");
+            swizzle_from_tga(source + itoz(j) * row_size, inbytespp, width, row.data());
+            set_row_colors(top_left ? height - 1 - j : j, row.data());
         }
+        return ax::none<std::string>();
+    }
 
-        // write footer
-        uint8_t footer[18] = { 'T','R','U','E','V','I','S','I','O','N','-','X','F','I','L','E','.','\0' };
-        out.write(reinterpret_cast<char*>(footer), sizeof(footer));
-        if (!out.good())
+    ax::option<std::string> basic_buffer::try_read_data_rle(int inbytespp, bool top_left, const char* data, std::size_t size)
+    {
+        VAR source = reinterpret_cast<const uint8_t*>(data);
+        VAL end = source + size;
+        std::vector<ax::color> row(width);
+        ax::color run_color;
+        VAR run = false;
+        VAR packet_remaining = 0;
+        for (VAR j = 0; j < height; ++j)
         {
-            const_cast<basic_buffer*>(this)->flip_vertical();
-            return ax::some("Failed to write to ax::basic_buffer to "_s + file_path + ".");
-        }
-
-        // unflip
-        const_cast<basic_buffer*>(this)->flip_vertical();
+            for (VAR i = 0; i < width;)
+            {
+                // read the next packet header, swizzling a run's color just once
+                if (packet_remaining == 0)
+                {
+                    if (source == end) return ax::some("An error occured while reading tga rle data."_s);
+                    VAL chunk_header = *source++;
+                    run = chunk_header >= 128;
+                    packet_remaining = (chunk_header & 127) + 1;
+                    if (run)
+                    {
+                        if (end - source < inbytespp) return ax::some("An error occured while reading tga rle color."_s);
+                        swizzle_from_tga(source, inbytespp, 1, &run_color);
+                        source += inbytespp;
+                    }
+                }
 
-        // success
+                // expand as much of the packet as the row holds, carrying the rest to the next row
+                VAL count = std::min(packet_remaining, width - i);
+                if (run) std::fill(row.begin() + i, row.begin() + i + count, run_color);
+                else
+                {
+                    if (end - source < count * inbytespp) return ax::some("An error occured while reading tga rle color."_s);
+                    swizzle_from_tga(source, inbytespp, count, row.data() + i);
+                    source += count * inbytespp;
+                }
+                packet_remaining -= count;
+                i += count;
+            }
+            set_row_colors(top_left ? height - 1 - j : j, row.data());
+        }
         return ax::none<std::string>();
     }
 
-    ax::option<std::string> basic_buffer::try_read_data_raw(int inbytespp, std::ifstream& in)
+    void basic_buffer::set_row_colors(int y, const ax::color* colors)
     {
-        for (VAR j = 0; j < height; ++j)
+        VAL row = pixels.data() + itoz(y) * itoz(width);
+        for (VAR i = 0; i < width; ++i) row[i].color = colors[i];
+    }
+
+    void basic_buffer::get_row_colors(int y, ax::color* colors) const
+    {
+        // take cleared tiles' colors from the clear pixel
+        VAL row = pixels.data() + itoz(y) * itoz(width);
+        if (!clear_pending) for (VAR i = 0; i < width; ++i) colors[i] = row[i].color;
+        else
         {
-            for (VAR i = 0; i < width; ++i)
+            for (VAR tile_x = 0; tile_x < tiles_x; ++tile_x)
             {
-                ax::color color;
-                in.read(reinterpret_cast<char*>(&color), inbytespp);
-                get_pixel_in_place(i, j).color = color_from_tga(inbytespp, color);
+                VAL x = tile_x * clear_tile_size;
+                VAL x_end = std::min(width, x + clear_tile_size);
+                VAL cleared = tiles_cleared[tile_x + y / clear_tile_size * tiles_x] != 0;
+                for (VAR i = x; i < x_end; ++i) colors[i] = cleared ? clear_pixel.color : row[i].color;
             }
-            if (!in.good()) return ax::some("An error occured while reading tga data."_s);
         }
-        return ax::none<std::string>();
     }
 
-    ax::option<std::string> basic_buffer::try_read_data_rle(int inbytespp, std::ifstream& in)
+    // The qoi ops, the color index hash and the stream's header and end marker sizes.
+    constexpr uint8_t qoi_op_index = 0x00;
+    constexpr uint8_t qoi_op_diff = 0x40;
+    constexpr uint8_t qoi_op_luma = 0x80;
+    constexpr uint8_t qoi_op_run = 0xC0;
+    constexpr uint8_t qoi_op_rgb = 0xFE;
+    constexpr uint8_t qoi_op_rgba = 0xFF;
+    constexpr uint8_t qoi_mask = 0xC0;
+    constexpr std::size_t qoi_header_size = 14_z;
+    constexpr uint8_t qoi_end_marker[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+
+    static inline int get_qoi_hash(const ax::color& color)
+    {
+        return (color.r * 3 + color.g * 5 + color.b * 7 + color.a * 11) & 63;
+    }
+
+    static inline bool get_colors_equal(const ax::color& a, const ax::color& b)
     {
-        VAL data_length = width * height * get_bytes_per_pixel();
-        for (VAR i = 0; i < data_length; i)
+        return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+    }
+
+    void basic_buffer::encode_qoi_rows(int row_begin, int row_end, std::vector<uint8_t>& data) const
+    {
+        // start from the pixel before the band as a decoder will, but only index colors the band
+        // itself has seen, since a decoder's index holds colors from earlier bands
+        ax::color index[64];
+        VAR indexed = 0ull;
+        VAR previous = row_begin > 0 ? get_pixel(width - 1, height - row_begin).color : ax::color(0, 0, 0, 255);
+        VAR run = 0;
+        std::vector<ax::color> row(itoz(width));
+        for (VAR r = row_begin; r < row_end; ++r)
         {
-            VAR chunk_header = static_cast<uint8_t>(in.get());
-            if (!in.good()) return ax::some("An error occured while reading tga rle data."_s);
-            if (chunk_header < 128)
+            // qoi rows run top-down while the buffer's run bottom-up
+            get_row_colors(height - 1 - r, row.data());
+            for (VAL& color : row)
             {
-                ++chunk_header;
-                for (int j = 0; j < chunk_header; ++j)
+                // extend runs of the previous color
+                if (get_colors_equal(color, previous))
                 {
-                    ax::color color;
-                    in.read(reinterpret_cast<char*>(&color), inbytespp);
-                    pixels[i / get_bytes_per_pixel()].color = color_from_tga(inbytespp, color);
-                    i += get_bytes_per_pixel();
+                    if (++run == 62)
+                    {
+                        data.push_back(static_cast<uint8_t>(qoi_op_run | (run - 1)));
+                        run = 0;
+                    }
+                    continue;
                 }
-            }
-            else
-            {
-                chunk_header -= 127;
-                ax::color color;
-                in.read(reinterpret_cast<char*>(&color), inbytespp);
-                for (int j = 0; j < chunk_header; ++j)
+                if (run > 0)
+                {
+                    data.push_back(static_cast<uint8_t>(qoi_op_run | (run - 1)));
+                    run = 0;
+                }
+
+                // refer to an indexed color, or else index it and encode it as the smallest delta
+                VAL hash = get_qoi_hash(color);
+                if ((indexed >> hash & 1ull) && get_colors_equal(index[hash], color)) data.push_back(static_cast<uint8_t>(qoi_op_index | hash));
+                else
                 {
-                    pixels[i / get_bytes_per_pixel()].color = color_from_tga(inbytespp, color);
-                    i += get_bytes_per_pixel();
+                    index[hash] = color;
+                    indexed |= 1ull << hash;
+                    if (color.a == previous.a)
+                    {
+                        VAL dr = static_cast<int8_t>(color.r - previous.r);
+                        VAL dg = static_cast<int8_t>(color.g - previous.g);
+                        VAL db = static_cast<int8_t>(color.b - previous.b);
+                        VAL dr_dg = dr - dg;
+                        VAL db_dg = db - dg;
+                        if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1)
+                            data.push_back(static_cast<uint8_t>(qoi_op_diff | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2)));
+                        else if (dg >= -32 && dg <= 31 && dr_dg >= -8 && dr_dg <= 7 && db_dg >= -8 && db_dg <= 7)
+                        {
+                            data.push_back(static_cast<uint8_t>(qoi_op_luma | (dg + 32)));
+                            data.push_back(static_cast<uint8_t>((dr_dg + 8) << 4 | (db_dg + 8)));
+                        }
+                        else data.insert(data.end(), { qoi_op_rgb, color.r, color.g, color.b });
+                    }
+                    else data.insert(data.end(), { qoi_op_rgba, color.r, color.g, color.b, color.a });
                 }
+                previous = color;
             }
-            if (!in.good()) return ax::some("An error occured while reading tga rle color."_s);
         }
+        if (run > 0) data.push_back(static_cast<uint8_t>(qoi_op_run | (run - 1)));
+    }
+
+    std::vector<uint8_t> basic_buffer::get_qoi_data(int band_rows, ax::worker_pool* pool) const
+    {
+        // write header
+        std::vector<uint8_t> data(qoi_header_size);
+        VAL write_u32 = [&](std::size_t offset, uint32_t value)
+        {
+            for (VAR i = 0_z; i < 4_z; ++i) data[offset + i] = static_cast<uint8_t>(value >> (24_z - i * 8_z));
+        };
+        data[0] = 'q'; data[1] = 'o'; data[2] = 'i'; data[3] = 'f';
+        write_u32(4_z, static_cast<uint32_t>(width));
+        write_u32(8_z, static_cast<uint32_t>(height));
+        data[12] = 4; // rgba
+        data[13] = 0; // srgb with linear alpha
+
+        // encode bands, concatenating them in order
+        if (!pool) encode_qoi_rows(0, height, data);
+        else
+        {
+            VAL band_count = itoz((height + band_rows - 1) / band_rows);
+            std::vector<std::vector<uint8_t>> bands(band_count);
+            pool->parallel_for(band_count, [&](std::size_t band)
+            {
+                VAL row_begin = ztoi(band) * band_rows;
+                encode_qoi_rows(row_begin, std::min(height, row_begin + band_rows), bands[band]);
+            });
+            for (VAL& band : bands) data.insert(data.end(), band.begin(), band.end());
+        }
+        data.insert(data.end(), std::begin(qoi_end_marker), std::end(qoi_end_marker));
+        return data;
+    }
+
+    std::vector<uint8_t> basic_buffer::get_qoi_data() const
+    {
+        return get_qoi_data(height, nullptr);
+    }
+
+    std::vector<uint8_t> basic_buffer::get_qoi_data(ax::worker_pool& pool) const
+    {
+        // band about a quarter million pixels at a time
+        constexpr VAR band_pixels = 256 * 1024;
+        return get_qoi_data(std::max(1, band_pixels / std::max(1, width)), &pool);
+    }
+
+    static ax::option<std::string> try_write_data(const char* file_path, const std::vector<uint8_t>& data)
+    {
+        std::ofstream out;
+        out.open(file_path, std::ios::binary);
+        if (!out.is_open()) return ax::some("Can't open qoi file "_s + file_path + " for saving an ax::basic_buffer.");
+        out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+        if (!out.good()) return ax::some("Failed to write to ax::basic_buffer to "_s + file_path + ".");
         return ax::none<std::string>();
     }
 
-    ax::color basic_buffer::color_from_tga(int inbytespp, const ax::color& color) const
+    ax::option<std::string> basic_buffer::try_write_to_qoi(const char* file_path) const
+    {
+        if (width > image_side_max || height > image_side_max) return ax::some("Can't write a qoi of "_s + std::to_string(width) + "x" + std::to_string(height) + " pixels.");
+        return try_write_data(file_path, get_qoi_data());
+    }
+
+    ax::option<std::string> basic_buffer::try_write_to_qoi(const char* file_path, ax::worker_pool& pool) const
     {
-        VAR result = color;
-        if (inbytespp < 3) result.g = result.b = result.r;
-        if (inbytespp < 4) result.a = 255;
-        std::swap(result.r, result.b);
-        return result;
+        if (width > image_side_max || height > image_side_max) return ax::some("Can't write a qoi of "_s + std::to_string(width) + "x" + std::to_string(height) + " pixels.");
+        return try_write_data(file_path, get_qoi_data(pool));
     }
 
-    ax::color basic_buffer::color_to_tga(const ax::color& color) const
+    ax::option<std::string> basic_buffer::try_read_from_qoi(const char* file_path)
     {
-        VAR result = color;
-        std::swap(result.r, result.b);
-        return result;
+        // map qoi file
+        ax::mapped_file file;
+        if (file.try_open(file_path)) return ax::some("Can't open qoi file "_s + file_path + ".");
+        return try_read_from_qoi_data(file.get_data(), file.get_size());
+    }
+
+    ax::option<std::string> basic_buffer::try_read_from_qoi_data(const char* data, std::size_t size)
+    {
+        // read header
+        VAR source = reinterpret_cast<const uint8_t*>(data);
+        if (size < qoi_header_size || std::memcmp(source, "qoif", 4_z) != 0) return ax::some("An error occured while reading qoi header."_s);
+        VAL read_u32 = [&](std::size_t offset)
+        {
+            return
+                static_cast<uint32_t>(source[offset]) << 24 | static_cast<uint32_t>(source[offset + 1_z]) << 16 |
+                static_cast<uint32_t>(source[offset + 2_z]) << 8 | static_cast<uint32_t>(source[offset + 3_z]);
+        };
+        VAL width_u32 = read_u32(4_z);
+        VAL height_u32 = read_u32(8_z);
+        VAL channels = source[12];
+        if (width_u32 == 0u || height_u32 == 0u || width_u32 > static_cast<uint32_t>(image_side_max) || height_u32 > static_cast<uint32_t>(image_side_max) || (channels != 3 && channels != 4))
+            return ax::some("Bad width, height, or channel count value."_s);
+
+        // reset fields
+        reset_clear();
+        width = static_cast<int>(width_u32);
+        height = static_cast<int>(height_u32);
+        pixels.resize(itoz(width) * itoz(height));
+
+        // decode rows top-down, carrying runs across them
+        VAL end = source + size;
+        source += qoi_header_size;
+        ax::color index[64] = {};
+        ax::color color(0, 0, 0, 255);
+        VAR run = 0;
+        std::vector<ax::color> row(itoz(width));
+        for (VAR r = 0; r < height; ++r)
+        {
+            for (VAR i = 0; i < width; ++i)
+            {
+                if (run > 0) --run;
+                else
+                {
+                    if (source == end) return ax::some("An error occured while reading qoi data."_s);
+                    VAL op = *source++;
+                    if (op == qoi_op_rgb || op == qoi_op_rgba)
+                    {
+                        VAL length = op == qoi_op_rgb ? 3 : 4;
+                        if (end - source < length) return ax::some("An error occured while reading qoi color."_s);
+                        color.r = source[0];
+                        color.g = source[1];
+                        color.b = source[2];
+                        if (op == qoi_op_rgba) color.a = source[3];
+                        source += length;
+                    }
+                    else if ((op & qoi_mask) == qoi_op_index) color = index[op];
+                    else if ((op & qoi_mask) == qoi_op_diff)
+                    {
+                        color.r = static_cast<uint8_t>(color.r + ((op >> 4) & 3) - 2);
+                        color.g = static_cast<uint8_t>(color.g + ((op >> 2) & 3) - 2);
+                        color.b = static_cast<uint8_t>(color.b + (op & 3) - 2);
+                    }
+                    else if ((op & qoi_mask) == qoi_op_luma)
+                    {
+                        if (source == end) return ax::some("An error occured while reading qoi color."_s);
+                        VAL dr_db = *source++;
+                        VAL dg = (op & 63) - 32;
+                        color.r = static_cast<uint8_t>(color.r + dg - 8 + (dr_db >> 4));
+                        color.g = static_cast<uint8_t>(color.g + dg);
+                        color.b = static_cast<uint8_t>(color.b + dg - 8 + (dr_db & 15));
+                    }
+                    else run = op & 63;
+                    index[get_qoi_hash(color)] = color;
+                }
+                row[itoz(i)] = color;
+            }
+            set_row_colors(height - 1 - r, row.data());
+        }
+        return ax::none<std::string>();
     }
 }
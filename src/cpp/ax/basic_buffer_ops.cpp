@@ -1,12 +1,21 @@
 #include <iostream>
 #include <fstream>
 #include <algorithm>
+#include <chrono>
 #include <functional>
+#include <memory>
 #include <string>
 #include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
 
 #include "ax/basic_buffer_ops.hpp"
 
+#include "ax/render_stats.hpp"
+#include "ax/string.hpp"
+#include "ax/triangle_traversal.hpp"
+
 namespace ax
 {
     void draw_dot(const ax::color& color, int x, int y, ax::basic_buffer& buffer)
@@ -58,6 +67,63 @@ namespace ax
         }
     }
 
+    void draw_line_clipped(const ax::color& color, int x, int y, int x2, int y2, ax::basic_buffer& buffer)
+    {
+        // determine steepness, transposing the viewport along with steep lines
+        VAL steep = std::abs(x - x2) < std::abs(y - y2);
+        if (steep)
+        {
+            std::swap(x, y);
+            std::swap(x2, y2);
+        }
+        VAL major_size = static_cast<int64_t>(steep ? buffer.get_height() : buffer.get_width());
+        VAL minor_size = static_cast<int64_t>(steep ? buffer.get_width() : buffer.get_height());
+
+        // invert
+        if (x > x2)
+        {
+            std::swap(x, x2);
+            std::swap(y, y2);
+        }
+
+        // clip parametrically like Liang-Barsky, but over steps rather than a continuous line so
+        // that the clipped line keeps the same pixels. After k steps, the minor axis has moved
+        // m(k) = ceil((k * error_delta - x_delta) / (2 * x_delta)) times, which never decreases,
+        // so each viewport edge bounds k from one side
+        VAL x_delta = static_cast<int64_t>(x2) - x;
+        VAL error_delta = std::abs(static_cast<int64_t>(y2) - y) * 2;
+        VAL error_heading = y2 > y ? 1 : -1;
+        VAL moves_min = error_heading > 0 ? -static_cast<int64_t>(y) : y - (minor_size - 1);
+        VAL moves_max = error_heading > 0 ? minor_size - 1 - y : static_cast<int64_t>(y);
+        if (x_delta == 0 || moves_max < 0 || moves_min > moves_max) return;
+        VAR k_begin = std::max(static_cast<int64_t>(0), -static_cast<int64_t>(x));
+        VAR k_end = std::min(x_delta, major_size - x);
+        if (error_delta == 0 && moves_min > 0) return;
+        if (error_delta != 0)
+        {
+            if (moves_min > 0) k_begin = std::max(k_begin, (2 * x_delta * moves_min - x_delta) / error_delta + 1);
+            k_end = std::min(k_end, (2 * x_delta * moves_max + x_delta) / error_delta + 1);
+        }
+        if (k_begin >= k_end) return;
+
+        // draw loop, starting from the first step inside the viewport
+        VAL error_begin = k_begin * error_delta - x_delta;
+        VAL moves_begin = error_begin > 0 ? (error_begin + 2 * x_delta - 1) / (2 * x_delta) : static_cast<int64_t>(0);
+        VAR error = k_begin * error_delta - 2 * x_delta * moves_begin;
+        VAR j = static_cast<int>(y + error_heading * moves_begin);
+        for (VAR i = static_cast<int>(x + k_begin); i < x + k_end; ++i)
+        {
+            if (steep) buffer.set_color_in_bounds(j, i, color);
+            else buffer.set_color_in_bounds(i, j, color);
+            error += error_delta;
+            if (error > x_delta)
+            {
+                j += error_heading;
+                error -= x_delta * 2;
+            }
+        }
+    }
+
     void draw_wired_ortho(const ax::color& color, const ax::line2& line, ax::basic_buffer& buffer)
     {
         VAL& center = ax::v2(static_cast<float>(buffer.get_width()), static_cast<float>(buffer.get_height())) * 0.5f;
@@ -75,118 +141,1038 @@ namespace ax
         ax::draw_wired_ortho(color, ax::line2(std::get<2>(triangle), std::get<0>(triangle)), buffer);
     }
 
-    void draw_wired_ortho(const ax::color& color, const ax::basic_model& model, ax::basic_buffer& buffer)
+    void draw_wired_ortho(const ax::color& color, const ax::basic_model& model, ax::basic_buffer& buffer, ax::edge_list* edge_list, ax::vertex_cache* vertex_cache)
     {
-        for (VAR i = 0_z; i < model.get_faces().size(); ++i)
+        // run the vertex stage and find the unique edges
+        ax::vertex_cache vertex_cache_local;
+        ax::edge_list edge_list_local;
+        VAL& vertices = (vertex_cache ? *vertex_cache : vertex_cache_local).update(model, buffer.get_width(), buffer.get_height());
+        VAL& edges = (edge_list ? *edge_list : edge_list_local).update(model);
+
+        // draw each edge once
+        for (VAL& edge : edges)
         {
-            VAL& face = model.get_face(i);
-            VAL& triangle = ax::triangle3(model.get_position(face[0]), model.get_position(face[1]), model.get_position(face[2]));
-            VAL& triangle_ortho = ax::get_ortho(triangle);
-            draw_wired_ortho(color, triangle_ortho, buffer);
+            VAL& start = vertices[edge.first].position;
+            VAL& end = vertices[edge.second].position;
+            ax::draw_line_clipped(color, static_cast<int>(start.x), static_cast<int>(start.y), static_cast<int>(end.x), static_cast<int>(end.y), buffer);
         }
     }
 
-    void draw_textured_ortho(const ax::v3& light, const ax::basic_surface& surface, const ax::triangle2& uvs, const ax::triangle3& triangle, ax::basic_buffer& buffer)
+    // A textured triangle with its screen-space and triangle-space terms computed up front so
+    // that it can be rasterized piecewise, such as once per screen tile.
+    struct textured_triangle
+    {
+        ax::triangle3 triangle;
+        ax::triangle2 uvs;
+        ax::triangle2 triangle_screen;
+        ax::triangle_edges edges;
+        float depths[3];
+        ax::v3 triangle_normal;
+        ax::matrix4 triangle_space;
+        ax::box2i bounds_screen;
+        ax::v2 uv_dx;
+        ax::v2 uv_dy;
+    };
+
+    // The terms of a textured triangle that depend only on its model face, not on its transform.
+    struct textured_face
+    {
+        ax::triangle2 uvs;
+        ax::v2 uv_1;
+        ax::v2 uv_2;
+    };
+
+    static ax::textured_face make_textured_face(const ax::triangle2& uvs)
+    {
+        return { uvs, std::get<1>(uvs) - std::get<0>(uvs), std::get<2>(uvs) - std::get<0>(uvs) };
+    }
+
+    static ax::textured_triangle make_textured_triangle(const ax::textured_face& face, const ax::triangle3& triangle, const ax::triangle2& triangle_screen)
     {
         // compute triangle space (aka, tangent-space)
-        VAL& triangle_tangent = (std::get<1>(triangle) - std::get<0>(triangle)).NormalizeSafe();
-        VAL& triangle_tangent_2 = (std::get<2>(triangle) - std::get<0>(triangle)).NormalizeSafe();
-        VAL& triangle_normal = (triangle_tangent ^ triangle_tangent_2).NormalizeSafe();
-        VAL& triangle_binormal = (triangle_tangent ^ triangle_normal).NormalizeSafe();
+        VAL triangle_tangent = (std::get<1>(triangle) - std::get<0>(triangle)).NormalizeSafe();
+        VAL triangle_tangent_2 = (std::get<2>(triangle) - std::get<0>(triangle)).NormalizeSafe();
+        VAL triangle_normal = (triangle_tangent ^ triangle_tangent_2).NormalizeSafe();
+        VAL triangle_binormal = (triangle_tangent ^ triangle_normal).NormalizeSafe();
         VAL& triangle_space = ax::matrix4(
             triangle_tangent.x,     triangle_tangent.y,     triangle_tangent.z,     0.0f,
             triangle_binormal.x,    triangle_binormal.y,    triangle_binormal.z,    0.0f,
             triangle_normal.x,      triangle_normal.y,      triangle_normal.z,      0.0f,
             0.0f,                   0.0f,                   0.0f,                   1.0f);
 
-        // compute triangle in screen-space
-        VAL& center_screen = ax::v2(static_cast<float>(buffer.get_width()), static_cast<float>(buffer.get_height())) * 0.5f;
-        VAL& triangle_ortho = ax::get_ortho(triangle);
+        // compute inclusive pixel bounds in screen-space
+        VAL& bounds = ax::get_bounds(triangle_screen);
+        VAL& bounds_screen = ax::box2i(
+            ax::v2i(static_cast<int>(bounds.first.x), static_cast<int>(bounds.first.y)),
+            ax::v2i(static_cast<int>(bounds.second.x), static_cast<int>(bounds.second.y)));
+
+        // set up edge functions
+        VAL& edges = ax::make_triangle_edges(triangle_screen);
+
+        // compute uv derivatives in screen-space, which are constant across a 2x2 quad, and
+        // indeed the whole triangle, since uvs are interpolated affinely
+        VAL& uv_dx = edges.degenerate ? ax::zero<ax::v2>() : face.uv_1 * edges.steps_x[1] + face.uv_2 * edges.steps_x[2];
+        VAL& uv_dy = edges.degenerate ? ax::zero<ax::v2>() : face.uv_1 * edges.steps_y[1] + face.uv_2 * edges.steps_y[2];
+        return
+            { triangle, face.uvs, triangle_screen, edges,
+              { std::get<0>(triangle).z, std::get<1>(triangle).z, std::get<2>(triangle).z },
+              triangle_normal, triangle_space, bounds_screen, uv_dx, uv_dy };
+    }
+
+    static ax::textured_triangle make_textured_triangle(const ax::triangle2& uvs, const ax::triangle3& triangle, const ax::triangle2& triangle_screen)
+    {
+        return ax::make_textured_triangle(ax::make_textured_face(uvs), triangle, triangle_screen);
+    }
+
+    static inline bool get_depth_passes(const ax::basic_buffer& buffer, int i, int j, float depth)
+    {
+        return depth >= buffer.get_pixel(i, j).depth;
+    }
+
+    static inline bool get_depth_passes(const ax::planar_buffer& buffer, int i, int j, float depth)
+    {
+        return !buffer.has_planes(ax::plane_depth) || depth >= buffer.get_depth_plane()[i + j * buffer.get_width()];
+    }
+
+    static inline bool get_depth_tested(const ax::basic_buffer&)
+    {
+        return true;
+    }
+
+    static inline bool get_depth_tested(const ax::planar_buffer& buffer)
+    {
+        return buffer.has_planes(ax::plane_depth);
+    }
+
+    static inline bool get_shaded(const ax::basic_buffer&)
+    {
+        return true;
+    }
+
+    static inline bool get_shaded(const ax::planar_buffer& buffer)
+    {
+        return buffer.has_planes(ax::plane_color);
+    }
+
+    static inline void write_pixel(int i, int j, float depth, const ax::v3& normal, const ax::color& color, ax::basic_buffer& buffer)
+    {
+        buffer.get_pixel_in_place(i, j) = ax::basic_pixel(depth, normal, color);
+    }
+
+    static inline void write_pixel(int i, int j, float depth, const ax::v3& normal, const ax::color& color, ax::planar_buffer& buffer)
+    {
+        VAL index = i + j * buffer.get_width();
+        if (buffer.has_planes(ax::plane_depth)) buffer.get_depth_plane()[index] = depth;
+        if (buffer.has_planes(ax::plane_normal)) buffer.get_normal_plane()[index] = normal;
+        if (buffer.has_planes(ax::plane_color)) buffer.get_color_plane()[index] = color;
+    }
+
+    static inline float get_depth(const ax::basic_buffer& buffer, int i, int j)
+    {
+        return buffer.get_pixel(i, j).depth;
+    }
+
+    static inline float get_depth(const ax::planar_buffer& buffer, int i, int j)
+    {
+        return buffer.has_planes(ax::plane_depth) ? buffer.get_depth_plane()[i + j * buffer.get_width()] : std::numeric_limits<float>::lowest();
+    }
+
+    static inline int get_tile_alignment(const ax::basic_buffer&)
+    {
+        return ax::basic_buffer::clear_tile_size;
+    }
+
+    static inline int get_tile_alignment(const ax::planar_buffer&)
+    {
+        return 1;
+    }
+
+    static float get_depth_nearest(const ax::textured_triangle& textured, const ax::box2i& bounds)
+    {
+        // depth is affine in screen-space, so its max over the bounds lies on a corner
+        VAL& edges = textured.edges;
+        VAL depth_1 = textured.depths[1] - textured.depths[0];
+        VAL depth_2 = textured.depths[2] - textured.depths[0];
+        VAL depth_dx = depth_1 * edges.steps_x[1] + depth_2 * edges.steps_x[2];
+        VAL depth_dy = depth_1 * edges.steps_y[1] + depth_2 * edges.steps_y[2];
+        VAL x = static_cast<float>(depth_dx >= 0.0f ? bounds.second.x : bounds.first.x) - edges.origin.x;
+        VAL y = static_cast<float>(depth_dy >= 0.0f ? bounds.second.y : bounds.first.y) - edges.origin.y;
+        VAL depth_corner =
+            textured.depths[0] +
+            depth_1 * (edges.steps_x[1] * x + edges.steps_y[1] * y + edges.offsets[1]) +
+            depth_2 * (edges.steps_x[2] * x + edges.steps_y[2] * y + edges.offsets[2]);
+
+        // clamp to the triangle's own nearest depth, padding for rounding in traversal
+        VAL depth_vertex = std::max(textured.depths[0], std::max(textured.depths[1], textured.depths[2]));
+        VAL depth = std::min(depth_corner, depth_vertex);
+        return depth + std::abs(depth) * 1.0e-5f + 1.0e-6f;
+    }
+
+    // The level of detail of each map of a surface for a triangle.
+    struct surface_lods
+    {
+        float specular;
+        float tangent;
+        float diffuse;
+    };
+
+    static ax::surface_lods get_surface_lods(const ax::basic_surface& surface, const ax::textured_triangle& textured)
+    {
+        return
+            { surface.get_specular_map().get_lod(textured.uv_dx, textured.uv_dy),
+              surface.get_tangent_map().get_lod(textured.uv_dx, textured.uv_dy),
+              surface.get_diffuse_map().get_lod(textured.uv_dx, textured.uv_dy) };
+    }
+
+    static ax::color shade_textured(const ax::v3& light, const ax::basic_surface& surface, const ax::textured_triangle& textured, const ax::surface_lods& lods, const ax::v2& uv_screen)
+    {
+        // sample the specular map
+        VAL specular = surface.get_specular_map().sample_specular(uv_screen, lods.specular);
+
+        // sample the tangent map, computing its normal
+        VAL& tangent = surface.get_tangent_map().sample_tangent(uv_screen, lods.tangent);
+        VAR normal = tangent + ax::v3(0.5f);
+        if (normal.x > 1.0f) normal.x -= 1.0f;
+        if (normal.y > 1.0f) normal.y -= 1.0f;
+        if (normal.z > 1.0f) normal.z -= 1.0f;
+
+        // sample the diffuse map
+        VAL& diffuse = surface.get_diffuse_map().sample_diffuse(uv_screen, lods.diffuse);
+
+        // compute the light normal in triangle-space
+        VAL& normal_triangle = textured.triangle_space * normal;
+        VAL light_normal_triangle = std::abs(light * normal_triangle);
+
+        // compute the color in screen-space
+        return ax::color(
+            static_cast<uint8_t>(ax::saturate(diffuse.r * light_normal_triangle + diffuse.r * specular, 255.0f)),
+            static_cast<uint8_t>(ax::saturate(diffuse.g * light_normal_triangle + diffuse.g * specular, 255.0f)),
+            static_cast<uint8_t>(ax::saturate(diffuse.b * light_normal_triangle + diffuse.b * specular, 255.0f)),
+            diffuse.a);
+    }
+
+    static ax::box2i get_clipped_bounds(const ax::textured_triangle& textured, const ax::box2i& clip)
+    {
+        // clip bounds in screen-space, treating clip as exclusive of its far corner
+        return ax::box2i(
+            ax::v2i(std::max(textured.bounds_screen.first.x, clip.first.x), std::max(textured.bounds_screen.first.y, clip.first.y)),
+            ax::v2i(std::min(textured.bounds_screen.second.x, clip.second.x - 1), std::min(textured.bounds_screen.second.y, clip.second.y - 1)));
+    }
+
+    static bool get_offscreen(const ax::box2i& bounds, int width, int height)
+    {
+        return bounds.second.x < 0 || bounds.second.y < 0 || bounds.first.x >= width || bounds.first.y >= height;
+    }
+
+#if defined(AX_RENDER_STATS)
+    static void count_triangle(bool front_facing, const ax::textured_triangle& textured, int width, int height, ax::render_counts& counts)
+    {
+        // count a triangle under the first reason it can't be drawn, if any
+        ++counts.triangles_submitted;
+        VAL& bounds = textured.bounds_screen;
+        if (!front_facing) ++counts.triangles_backfacing;
+        else if (textured.edges.degenerate) ++counts.triangles_degenerate;
+        else if (ax::get_offscreen(bounds, width, height)) ++counts.triangles_offscreen;
+    }
+
+    static uint32_t* get_overdraw_in_place(ax::render_stats* render_stats, int width, int height)
+    {
+        // only count overdraw when the stats were prepared for the target
+        return render_stats && render_stats->get_width() == width && render_stats->get_height() == height ? render_stats->get_overdraw_in_place() : nullptr;
+    }
+
+    static void prepare_render_stats(ax::render_stats* render_stats, int width, int height)
+    {
+        if (render_stats) render_stats->prepare(width, height);
+    }
+
+    static void add_render_counts(ax::render_stats* render_stats, const ax::render_counts& counts)
+    {
+        if (render_stats) render_stats->add(counts);
+    }
+
+    // Times the stages of a draw into the given stats, reading the clock only when there are some.
+    struct stage_clock
+    {
+    public:
+
+        explicit stage_clock(ax::render_stats* stats) :
+            stats(stats),
+            times(),
+            start(stats ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point())
+        { }
+
+        // Charge the time since the last lap to a stage.
+        void lap(uint64_t ax::render_times::* stage)
+        {
+            if (!stats) return;
+            VAL now = std::chrono::steady_clock::now();
+            times.*stage += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - start).count());
+            start = now;
+        }
+
+        void finish()
+        {
+            if (stats) stats->add(times);
+        }
+
+    private:
+
+        ax::render_stats* stats;
+        ax::render_times times;
+        std::chrono::steady_clock::time_point start;
+    };
+#endif
+
+    static inline ax::color get_tinted(const ax::color& color, const ax::color& tint)
+    {
+        return ax::color(
+            static_cast<uint8_t>((color.r * tint.r + 127) / 255),
+            static_cast<uint8_t>((color.g * tint.g + 127) / 255),
+            static_cast<uint8_t>((color.b * tint.b + 127) / 255),
+            static_cast<uint8_t>((color.a * tint.a + 127) / 255));
+    }
+
+    template<typename Buffer>
+    static void draw_textured_triangle(const ax::v3& light, const ax::basic_surface& surface, const ax::textured_triangle& textured, const ax::box2i& clip, Buffer& buffer, ax::hierarchical_depth* hierarchical_depth, [[maybe_unused]] ax::render_stats* render_stats, const ax::color& tint = ax::color(255, 255, 255, 255))
+    {
+        // clip bounds in screen-space
+        VAL& clipped = ax::get_clipped_bounds(textured, clip);
+        if (clipped.first.x > clipped.second.x || clipped.first.y > clipped.second.y) return;
+        VAL shaded = ax::get_shaded(buffer);
+        VAL tinted = tint != ax::color(255, 255, 255, 255);
+        VAL& lods = ax::get_surface_lods(surface, textured);
+        AX_RENDER_STAT(ax::render_counts counts{});
+        AX_RENDER_STAT(VAL overdraw = ax::get_overdraw_in_place(render_stats, buffer.get_width(), buffer.get_height()));
+
+        // render the covered pixels of a block
+        VAR depth_written = std::numeric_limits<float>::lowest();
+        VAL draw_block = [&](const ax::traversal_block& block)
+        {
+            for (VAR mask = block.mask; mask; mask &= mask - 1u)
+            {
+                // ensure write-depth is greater than depth of current pixel
+                VAL lane = ax::get_lowest_bit_index(mask);
+                VAL i = block.x + lane;
+                VAL j = block.y;
+                VAL depth_screen = block.depths[lane];
+                VAL passes = ax::get_depth_passes(buffer, i, j, depth_screen);
+                AX_RENDER_STAT(++counts.pixels_tested; ++(passes ? counts.depth_passes : counts.depth_fails));
+                AX_RENDER_STAT(if (passes && overdraw) ++overdraw[i + j * buffer.get_width()]);
+                if (passes)
+                {
+                    // skip shading when there's no color to write
+                    depth_written = std::max(depth_written, depth_screen);
+                    VAL& color_screen = shaded ? ax::shade_textured(light, surface, textured, lods, ax::v2(block.us[lane], block.vs[lane])) : ax::color();
+                    ax::write_pixel(i, j, depth_screen, textured.triangle_normal, tinted ? ax::get_tinted(color_screen, tint) : color_screen, buffer);
+                }
+            }
+        };
+
+        // without hierarchical depth, traverse the clipped bounds in one go
+        if (!hierarchical_depth || !ax::get_depth_tested(buffer))
+        {
+            ax::traverse_triangle(textured.edges, textured.depths, textured.uvs, clipped, draw_block);
+        }
+
+        // otherwise traverse a depth block at a time, skipping blocks the triangle can't show in
+        else
+        {
+            VAL block_size = ax::hierarchical_depth::block_size;
+            for (VAR y = clipped.first.y / block_size; y <= clipped.second.y / block_size; ++y)
+            {
+                for (VAR x = clipped.first.x / block_size; x <= clipped.second.x / block_size; ++x)
+                {
+                    VAL& block_bounds = ax::box2i(
+                        ax::v2i(std::max(clipped.first.x, x * block_size), std::max(clipped.first.y, y * block_size)),
+                        ax::v2i(std::min(clipped.second.x, x * block_size + block_size - 1), std::min(clipped.second.y, y * block_size + block_size - 1)));
+                    VAL depth_nearest = ax::get_depth_nearest(textured, block_bounds);
+                    if (!hierarchical_depth->get_visible(x, y, depth_nearest, buffer)) continue;
+                    depth_written = std::numeric_limits<float>::lowest();
+                    ax::traverse_triangle(textured.edges, textured.depths, textured.uvs, block_bounds, draw_block);
+                    if (depth_written != std::numeric_limits<float>::lowest()) hierarchical_depth->note_written(x, y, depth_written);
+                }
+            }
+        }
+        AX_RENDER_STAT(ax::add_render_counts(render_stats, counts));
+    }
+
+    static bool get_front_facing(const ax::triangle3& triangle)
+    {
+        VAL& forward = ax::v3(0.0f, 0.0f, 1.0f);
+        VAL& normal = ax::get_normal(triangle);
+        return normal * forward > 0;
+    }
+
+    template<typename Buffer>
+    static void draw_textured_triangle(const ax::v3& light, const ax::basic_surface& surface, const ax::triangle2& uvs, const ax::triangle3& triangle, Buffer& buffer, ax::hierarchical_depth* hierarchical_depth, ax::render_stats* render_stats)
+    {
+        VAL width = buffer.get_width();
+        VAL height = buffer.get_height();
         VAL& triangle_screen = ax::triangle2(
-            (std::get<0>(triangle_ortho) + ax::one<ax::v2>()).SymMul(center_screen),
-            (std::get<1>(triangle_ortho) + ax::one<ax::v2>()).SymMul(center_screen),
-            (std::get<2>(triangle_ortho) + ax::one<ax::v2>()).SymMul(center_screen));
+            ax::get_screen_vertex(std::get<0>(triangle), width, height).position,
+            ax::get_screen_vertex(std::get<1>(triangle), width, height).position,
+            ax::get_screen_vertex(std::get<2>(triangle), width, height).position);
+        VAL& textured = ax::make_textured_triangle(uvs, triangle, triangle_screen);
+        VAL& clip = ax::box2i(ax::zero<ax::v2i>(), ax::v2i(buffer.get_width(), buffer.get_height()));
+        AX_RENDER_STAT(ax::render_counts counts{});
+        AX_RENDER_STAT(ax::count_triangle(true, textured, width, height, counts));
+        AX_RENDER_STAT(ax::prepare_render_stats(render_stats, width, height));
+        AX_RENDER_STAT(ax::add_render_counts(render_stats, counts));
+        ax::draw_textured_triangle(light, surface, textured, clip, buffer, hierarchical_depth, render_stats);
+    }
+
+    static bool try_make_textured_triangle(const ax::basic_model& model, const std::vector<ax::screen_vertex>& vertices, std::size_t face_index, ax::textured_triangle& textured)
+    {
+        // look up the face's vertices, rejecting it when back-facing
+        VAL face = model.get_indices().data() + face_index * 3_z;
+        VAL& model_vertices = model.get_vertices();
+        VAL& vertex_0 = model_vertices[face[0]];
+        VAL& vertex_1 = model_vertices[face[1]];
+        VAL& vertex_2 = model_vertices[face[2]];
+        VAL& triangle = ax::triangle3(vertex_0.position, vertex_1.position, vertex_2.position);
+        if (!ax::get_front_facing(triangle)) return false;
 
-        // compute bounds in screen-space
-        VAL& bounds_screen = ax::get_bounds(triangle_screen);
-        VAL width_screen = static_cast<int>(bounds_screen.second.x);
-        VAL height_screen = static_cast<int>(bounds_screen.second.y);
+        // set up from the post-transform vertices
+        VAL& uvs = ax::triangle2(vertex_0.uv, vertex_1.uv, vertex_2.uv);
+        VAL& triangle_screen = ax::triangle2(vertices[face[0]].position, vertices[face[1]].position, vertices[face[2]].position);
+        textured = ax::make_textured_triangle(uvs, triangle, triangle_screen);
+        return true;
+    }
+
+    template<typename Buffer>
+    static void draw_textured_model(const ax::v3& light, const ax::basic_model& model, const ax::basic_surface& surface, Buffer& buffer, ax::hierarchical_depth* hierarchical_depth, ax::vertex_cache* vertex_cache, ax::render_stats* render_stats)
+    {
+        // run the vertex stage
+        AX_RENDER_STAT(ax::stage_clock clock(render_stats));
+        ax::vertex_cache vertex_cache_local;
+        VAL& vertices = (vertex_cache ? *vertex_cache : vertex_cache_local).update(model, buffer.get_width(), buffer.get_height());
+        AX_RENDER_STAT(clock.lap(&ax::render_times::vertex));
 
-        // render triangle pixels in the screen-space of the computed bounds
-        for (VAR j = static_cast<int>(bounds_screen.first.y); j <= height_screen; ++j)
+        // draw each front-facing face
+        VAL& clip = ax::box2i(ax::zero<ax::v2i>(), ax::v2i(buffer.get_width(), buffer.get_height()));
+        ax::textured_triangle textured;
+        AX_RENDER_STAT(ax::render_counts counts{});
+        AX_RENDER_STAT(ax::prepare_render_stats(render_stats, buffer.get_width(), buffer.get_height()));
+        for (VAR i = 0_z; i < ax::itoz(model.get_face_count()); ++i)
         {
-            for (VAR i = static_cast<int>(bounds_screen.first.x); i <= width_screen; ++i)
+            VAL front_facing = ax::try_make_textured_triangle(model, vertices, i, textured);
+            AX_RENDER_STAT(ax::count_triangle(front_facing, textured, buffer.get_width(), buffer.get_height(), counts));
+            if (front_facing) ax::draw_textured_triangle(light, surface, textured, clip, buffer, hierarchical_depth, render_stats);
+        }
+        AX_RENDER_STAT(ax::add_render_counts(render_stats, counts));
+        AX_RENDER_STAT(clock.lap(&ax::render_times::raster));
+        AX_RENDER_STAT(clock.finish());
+    }
+
+    // A model's front-facing triangles set up and binned into screen tiles. Each contiguous chunk
+    // of faces bins into its own tile bins so that walking the chunks in order preserves
+    // submission order.
+    struct textured_bins
+    {
+        int tile_extent;
+        int tiles_x;
+        int tiles_y;
+        std::vector<ax::textured_triangle> triangles;
+        std::vector<std::vector<std::vector<uint32_t>>> bins;
+    };
+
+    static void bin_textured_triangle(const ax::box2i& bounds, int width, int height, int tile_extent, int tiles_x, uint32_t triangle_index, std::vector<std::vector<uint32_t>>& bins)
+    {
+        // bin into each overlapped tile, skipping offscreen triangles
+        if (ax::get_offscreen(bounds, width, height)) return;
+        VAL tile_left = std::max(0, bounds.first.x) / tile_extent;
+        VAL tile_bottom = std::max(0, bounds.first.y) / tile_extent;
+        VAL tile_right = std::min(width - 1, bounds.second.x) / tile_extent;
+        VAL tile_top = std::min(height - 1, bounds.second.y) / tile_extent;
+        for (VAR ty = tile_bottom; ty <= tile_top; ++ty)
+            for (VAR tx = tile_left; tx <= tile_right; ++tx)
+                bins[ax::itoz(tx + ty * tiles_x)].push_back(triangle_index);
+    }
+
+    static void bin_textured_triangles(const ax::basic_model& model, const std::vector<ax::screen_vertex>& vertices, int width, int height, int tile_extent, ax::worker_pool& pool, ax::textured_bins& binned, [[maybe_unused]] ax::render_stats* render_stats)
+    {
+        // compute the tile grid
+        binned.tile_extent = tile_extent;
+        binned.tiles_x = (width + tile_extent - 1) / tile_extent;
+        binned.tiles_y = (height + tile_extent - 1) / tile_extent;
+        VAL tiles_x = binned.tiles_x;
+        VAL tile_count = ax::itoz(binned.tiles_x * binned.tiles_y);
+
+        // set up and bin triangles in parallel
+        VAL face_count = ax::itoz(model.get_face_count());
+        VAL chunk_count = std::max(1_z, std::min(pool.get_thread_count() + 1_z, face_count / 256_z));
+        binned.triangles.resize(face_count);
+        binned.bins.assign(chunk_count, std::vector<std::vector<uint32_t>>(tile_count));
+        pool.parallel_for(chunk_count, [&](std::size_t chunk)
+        {
+            VAR& chunk_bins = binned.bins[chunk];
+            VAL face_begin = face_count * chunk / chunk_count;
+            VAL face_end = face_count * (chunk + 1_z) / chunk_count;
+            AX_RENDER_STAT(ax::render_counts counts{});
+            for (VAR i = face_begin; i < face_end; ++i)
+            {
+                // set up front-facing triangles
+                VAR& textured = binned.triangles[i];
+                VAL front_facing = ax::try_make_textured_triangle(model, vertices, i, textured);
+                AX_RENDER_STAT(ax::count_triangle(front_facing, textured, width, height, counts));
+                if (front_facing) ax::bin_textured_triangle(textured.bounds_screen, width, height, tile_extent, tiles_x, static_cast<uint32_t>(i), chunk_bins);
+            }
+            AX_RENDER_STAT(ax::add_render_counts(render_stats, counts));
+        });
+    }
+
+    static ax::box2i get_tile_clip(const ax::textured_bins& binned, std::size_t tile, int width, int height)
+    {
+        VAL tx = ax::ztoi(tile) % binned.tiles_x;
+        VAL ty = ax::ztoi(tile) / binned.tiles_x;
+        return ax::box2i(
+            ax::v2i(tx * binned.tile_extent, ty * binned.tile_extent),
+            ax::v2i(std::min(width, (tx + 1) * binned.tile_extent), std::min(height, (ty + 1) * binned.tile_extent)));
+    }
+
+    // Rasterize binned tiles independently on the pool. Tiles share no pixels and bins keep
+    // submission order, so the result matches drawing the triangles in turn.
+    template<typename Buffer>
+    static void draw_textured_model_tiled(const ax::v3& light, const ax::basic_model& model, const ax::basic_surface& surface, Buffer& buffer, int tile_size, ax::worker_pool& pool, ax::hierarchical_depth* hierarchical_depth, ax::vertex_cache* vertex_cache, ax::render_stats* render_stats)
+    {
+        // align tiles to depth blocks and to the buffer's clear tiles so that no two tiles share
+        // either (both being powers of two, the larger is a multiple of both)
+        VAL width = buffer.get_width();
+        VAL height = buffer.get_height();
+        VAL block_size = std::max(hierarchical_depth ? ax::hierarchical_depth::block_size : 1, ax::get_tile_alignment(buffer));
+        VAL tile_extent = (std::max(1, tile_size) + block_size - 1) / block_size * block_size;
+        if (width <= 0 || height <= 0) return;
+
+        // run the vertex stage, then set up and bin triangles
+        AX_RENDER_STAT(ax::stage_clock clock(render_stats));
+        ax::vertex_cache vertex_cache_local;
+        VAL& vertices = (vertex_cache ? *vertex_cache : vertex_cache_local).update(model, width, height, pool);
+        AX_RENDER_STAT(clock.lap(&ax::render_times::vertex));
+        ax::textured_bins binned;
+        AX_RENDER_STAT(ax::prepare_render_stats(render_stats, width, height));
+        ax::bin_textured_triangles(model, vertices, width, height, tile_extent, pool, binned, render_stats);
+        AX_RENDER_STAT(clock.lap(&ax::render_times::setup));
+
+        // rasterize tiles independently
+        pool.parallel_for(ax::itoz(binned.tiles_x * binned.tiles_y), [&](std::size_t tile)
+        {
+            VAL& clip = ax::get_tile_clip(binned, tile, width, height);
+            for (VAL& chunk_bins : binned.bins)
+                for (VAL triangle_index : chunk_bins[tile])
+                    ax::draw_textured_triangle(light, surface, binned.triangles[triangle_index], clip, buffer, hierarchical_depth, render_stats);
+        });
+        AX_RENDER_STAT(clock.lap(&ax::render_times::raster));
+        AX_RENDER_STAT(clock.finish());
+    }
+
+    // One chunk of an instanced draw's set-up triangles, the instance slot of each, and its tile
+    // bins of indices into them.
+    struct instanced_chunk
+    {
+        std::vector<ax::textured_triangle> triangles;
+        std::vector<std::size_t> slots;
+        std::vector<std::vector<uint32_t>> bins;
+    };
+
+    // Draw a model's instances with one vertex stage per visible instance and one binning pass
+    // over all of them. Binning sets up each visible face once, reusing its uv terms across
+    // instances, and bins indices into the set-up triangles of its chunk.
+    template<typename Buffer>
+    static void draw_textured_model_instanced(const ax::basic_model& model, const ax::model_instance* instances, std::size_t instance_count, Buffer& buffer, int tile_size, ax::worker_pool& pool, ax::hierarchical_depth* hierarchical_depth, ax::render_stats* render_stats)
+    {
+        // align tiles as for a tiled draw
+        VAL width = buffer.get_width();
+        VAL height = buffer.get_height();
+        VAL block_size = std::max(hierarchical_depth ? ax::hierarchical_depth::block_size : 1, ax::get_tile_alignment(buffer));
+        VAL tile_extent = (std::max(1, tile_size) + block_size - 1) / block_size * block_size;
+        VAL& model_vertices = model.get_vertices();
+        VAL& indices = model.get_indices();
+        VAL vertex_count = model_vertices.size();
+        VAL face_count = ax::itoz(model.get_face_count());
+        if (width <= 0 || height <= 0 || face_count == 0_z) return;
+
+        // cull instances whose transformed model bounds miss the view
+        AX_RENDER_STAT(ax::stage_clock clock(render_stats));
+        VAL max = std::numeric_limits<float>::max();
+        VAR lower = ax::v3(max, max, max);
+        VAR upper = ax::v3(-max, -max, -max);
+        for (VAL& vertex : model_vertices)
+        {
+            lower = ax::v3(std::min(lower.x, vertex.position.x), std::min(lower.y, vertex.position.y), std::min(lower.z, vertex.position.z));
+            upper = ax::v3(std::max(upper.x, vertex.position.x), std::max(upper.y, vertex.position.y), std::max(upper.z, vertex.position.z));
+        }
+        std::vector<std::size_t> visible;
+        for (VAR i = 0_z; i < instance_count; ++i)
+        {
+            VAR view_lower = ax::v2(max, max);
+            VAR view_upper = ax::v2(-max, -max);
+            for (VAR corner = 0; corner < 8; ++corner)
+            {
+                VAL& position = instances[i].transform * ax::v3(corner & 1 ? upper.x : lower.x, corner & 2 ? upper.y : lower.y, corner & 4 ? upper.z : lower.z);
+                view_lower = ax::v2(std::min(view_lower.x, position.x), std::min(view_lower.y, position.y));
+                view_upper = ax::v2(std::max(view_upper.x, position.x), std::max(view_upper.y, position.y));
+            }
+            if (view_upper.x >= -1.0f && view_upper.y >= -1.0f && view_lower.x <= 1.0f && view_lower.y <= 1.0f) visible.push_back(i);
+        }
+        AX_RENDER_STAT(ax::prepare_render_stats(render_stats, width, height));
+        AX_RENDER_STAT(ax::add_render_counts(render_stats, { (instance_count - visible.size()) * face_count, 0u, 0u, (instance_count - visible.size()) * face_count, 0u, 0u, 0u }));
+
+        // run the vertex stage for each visible instance
+        std::vector<ax::v3> positions(visible.size() * vertex_count);
+        std::vector<ax::screen_vertex> vertices(visible.size() * vertex_count);
+        pool.parallel_for(visible.size(), [&](std::size_t slot)
+        {
+            VAL& transform = instances[visible[slot]].transform;
+            for (VAR i = 0_z; i < vertex_count; ++i)
+            {
+                VAL& position = transform * model_vertices[i].position;
+                positions[slot * vertex_count + i] = position;
+                vertices[slot * vertex_count + i] = ax::get_screen_vertex(position, width, height);
+            }
+        });
+        AX_RENDER_STAT(clock.lap(&ax::render_times::vertex));
+
+        // set up each face's uv terms once for all instances
+        std::vector<ax::textured_face> faces(face_count);
+        for (VAR face = 0_z; face < face_count; ++face)
+        {
+            VAL corners = indices.data() + face * 3_z;
+            faces[face] = ax::make_textured_face(ax::triangle2(model_vertices[corners[0]].uv, model_vertices[corners[1]].uv, model_vertices[corners[2]].uv));
+        }
+
+        // set up and bin every visible instance's front-facing faces in one pass, each chunk of
+        // them into its own triangles and bins to keep submission order
+        VAL tiles_x = (width + tile_extent - 1) / tile_extent;
+        VAL tiles_y = (height + tile_extent - 1) / tile_extent;
+        VAL tile_count = ax::itoz(tiles_x * tiles_y);
+        VAL total = visible.size() * face_count;
+        VAL chunk_count = std::max(1_z, std::min(pool.get_thread_count() + 1_z, total / 256_z));
+        std::vector<ax::instanced_chunk> chunks(chunk_count);
+        pool.parallel_for(chunk_count, [&](std::size_t chunk)
+        {
+            VAR& binned = chunks[chunk];
+            binned.bins.resize(tile_count);
+            ax::textured_triangle textured;
+            AX_RENDER_STAT(ax::render_counts counts{});
+            for (VAR g = total * chunk / chunk_count; g < total * (chunk + 1_z) / chunk_count; ++g)
             {
-                // check that pixel is inside triangle
-                if (ax::get_in_bounds(ax::v2(static_cast<float>(i), static_cast<float>(j)), triangle_screen))
+                // set up front-facing faces from their instance's post-transform vertices
+                VAL slot = g / face_count;
+                VAL face = g % face_count;
+                VAL base = slot * vertex_count;
+                VAL corners = indices.data() + face * 3_z;
+                VAL& triangle = ax::triangle3(positions[base + corners[0]], positions[base + corners[1]], positions[base + corners[2]]);
+                VAL front_facing = ax::get_front_facing(triangle);
+                if (front_facing)
                 {
-                    // get a reference to the current pixel
-                    VAR& pixel_in_place = buffer.get_pixel_in_place(i, j);
-
-                    // compute the write-depth in screen-space
-                    VAL& point_screen = ax::v2(static_cast<float>(i), static_cast<float>(j));
-                    VAL& coords_screen = ax::get_barycentric_coords(point_screen, triangle_screen);
-                    VAL depth_screen =
-                        std::get<0>(triangle).z * coords_screen.x +
-                        std::get<1>(triangle).z * coords_screen.y +
-                        std::get<2>(triangle).z * coords_screen.z;
-
-                    // ensure write-depth is greater than depth of current pixel
-                    if (depth_screen >= pixel_in_place.depth)
+                    VAL& triangle_screen = ax::triangle2(vertices[base + corners[0]].position, vertices[base + corners[1]].position, vertices[base + corners[2]].position);
+                    textured = ax::make_textured_triangle(faces[face], triangle, triangle_screen);
+                }
+                AX_RENDER_STAT(ax::count_triangle(front_facing, textured, width, height, counts));
+                if (!front_facing) continue;
+
+                // keep the triangle only when some tile takes it
+                VAL triangle_index = static_cast<uint32_t>(binned.triangles.size());
+                if (ax::get_offscreen(textured.bounds_screen, width, height)) continue;
+                binned.triangles.push_back(textured);
+                binned.slots.push_back(slot);
+                ax::bin_textured_triangle(textured.bounds_screen, width, height, tile_extent, tiles_x, triangle_index, binned.bins);
+            }
+            AX_RENDER_STAT(ax::add_render_counts(render_stats, counts));
+        });
+        AX_RENDER_STAT(clock.lap(&ax::render_times::setup));
+
+        // rasterize tiles independently, shading each triangle with its instance's light and tint
+        VAL& surface = model.get_surface();
+        pool.parallel_for(tile_count, [&](std::size_t tile)
+        {
+            VAL tx = ax::ztoi(tile) % tiles_x;
+            VAL ty = ax::ztoi(tile) / tiles_x;
+            VAL& clip = ax::box2i(
+                ax::v2i(tx * tile_extent, ty * tile_extent),
+                ax::v2i(std::min(width, (tx + 1) * tile_extent), std::min(height, (ty + 1) * tile_extent)));
+            for (VAL& binned : chunks)
+            {
+                for (VAL triangle_index : binned.bins[tile])
+                {
+                    VAL& instance = instances[visible[binned.slots[triangle_index]]];
+                    ax::draw_textured_triangle(instance.light, surface, binned.triangles[triangle_index], clip, buffer, hierarchical_depth, render_stats, instance.tint);
+                }
+            }
+        });
+        AX_RENDER_STAT(clock.lap(&ax::render_times::raster));
+        AX_RENDER_STAT(clock.finish());
+    }
+
+    static void draw_visibility_triangle(const ax::textured_triangle& textured, uint32_t triangle_index, const ax::box2i& clip, ax::visibility_buffer& visibility, [[maybe_unused]] ax::render_stats* render_stats)
+    {
+        // record the triangle wherever it's nearest, keeping ties with the later one as shading does
+        VAL& clipped = ax::get_clipped_bounds(textured, clip);
+        VAL samples = visibility.get_samples();
+        VAL width = visibility.get_width();
+        AX_RENDER_STAT(ax::render_counts counts{});
+        AX_RENDER_STAT(VAL overdraw = ax::get_overdraw_in_place(render_stats, width, visibility.get_height()));
+        ax::traverse_triangle(textured.edges, textured.depths, textured.uvs, clipped, [&](const ax::traversal_block& block)
+        {
+            VAL row = samples + block.y * width + block.x;
+            for (VAR mask = block.mask; mask; mask &= mask - 1u)
+            {
+                VAL lane = ax::get_lowest_bit_index(mask);
+                VAR& sample = row[lane];
+                VAL passes = block.depths[lane] >= sample.depth;
+                AX_RENDER_STAT(++counts.pixels_tested; ++(passes ? counts.depth_passes : counts.depth_fails));
+                AX_RENDER_STAT(if (passes && overdraw) ++overdraw[block.y * width + block.x + lane]);
+                if (passes) sample = { block.depths[lane], triangle_index, block.coords_1[lane], block.coords_2[lane] };
+            }
+        });
+        AX_RENDER_STAT(ax::add_render_counts(render_stats, counts));
+    }
+
+    // Rasterize binned tiles into a visibility buffer, then shade bands of rows, each covered pixel
+    // once. Uvs are rebuilt from barycentrics with traversal's arithmetic, so the result matches.
+    template<typename Buffer>
+    static void draw_textured_model_deferred(const ax::v3& light, const ax::basic_model& model, Buffer& buffer, int tile_size, ax::worker_pool& pool, ax::visibility_buffer* visibility_buffer, ax::vertex_cache* vertex_cache, ax::render_stats* render_stats)
+    {
+        // align tiles and shading bands to the buffer's clear tiles
+        VAL width = buffer.get_width();
+        VAL height = buffer.get_height();
+        VAL alignment = ax::get_tile_alignment(buffer);
+        VAL tile_extent = (std::max(1, tile_size) + alignment - 1) / alignment * alignment;
+        if (width <= 0 || height <= 0) return;
+
+        // run the vertex stage, then set up and bin triangles
+        AX_RENDER_STAT(ax::stage_clock clock(render_stats));
+        ax::vertex_cache vertex_cache_local;
+        VAL& vertices = (vertex_cache ? *vertex_cache : vertex_cache_local).update(model, width, height, pool);
+        AX_RENDER_STAT(clock.lap(&ax::render_times::vertex));
+        ax::textured_bins binned;
+        AX_RENDER_STAT(ax::prepare_render_stats(render_stats, width, height));
+        ax::bin_textured_triangles(model, vertices, width, height, tile_extent, pool, binned, render_stats);
+        AX_RENDER_STAT(clock.lap(&ax::render_times::setup));
+
+        // rasterize each tile's visibility, starting from the target's depths
+        ax::visibility_buffer visibility_local;
+        VAR& visibility = visibility_buffer ? *visibility_buffer : visibility_local;
+        visibility.resize(width, height);
+        VAL samples = visibility.get_samples();
+        pool.parallel_for(ax::itoz(binned.tiles_x * binned.tiles_y), [&](std::size_t tile)
+        {
+            VAL& clip = ax::get_tile_clip(binned, tile, width, height);
+            for (VAR j = clip.first.y; j < clip.second.y; ++j)
+                for (VAR i = clip.first.x; i < clip.second.x; ++i)
+                    samples[i + j * width] = { ax::get_depth(buffer, i, j), ax::visibility_buffer::no_triangle, 0.0f, 0.0f };
+            for (VAL& chunk_bins : binned.bins)
+                for (VAL triangle_index : chunk_bins[tile])
+                    ax::draw_visibility_triangle(binned.triangles[triangle_index], triangle_index, clip, visibility, render_stats);
+        });
+        AX_RENDER_STAT(clock.lap(&ax::render_times::raster));
+
+        // shade each visible pixel once, in bands of rows
+        VAL& surface = model.get_surface();
+        VAL shaded = ax::get_shaded(buffer);
+        VAL band_height = alignment * 4;
+        pool.parallel_for(ax::itoz((height + band_height - 1) / band_height), [&](std::size_t band)
+        {
+            VAL band_end = std::min(height, (ax::ztoi(band) + 1) * band_height);
+            VAR lods_triangle = ax::visibility_buffer::no_triangle;
+            ax::surface_lods lods{};
+            for (VAR j = ax::ztoi(band) * band_height; j < band_end; ++j)
+            {
+                for (VAR i = 0; i < width; ++i)
+                {
+                    // skip pixels no triangle covers
+                    VAL& sample = samples[i + j * width];
+                    if (sample.triangle == ax::visibility_buffer::no_triangle) continue;
+                    VAL& textured = binned.triangles[sample.triangle];
+                    if (!shaded)
+                    {
+                        ax::write_pixel(i, j, sample.depth, textured.triangle_normal, ax::color(), buffer);
+                        continue;
+                    }
+
+                    // interpolate uvs as traversal does, reusing lods along runs of one triangle
+                    if (sample.triangle != lods_triangle)
                     {
-                        // compute uv coordinate in screen-space
-                        VAL uv_screen =
-                            std::get<0>(uvs) * coords_screen.x +
-                            std::get<1>(uvs) * coords_screen.y +
-                            std::get<2>(uvs) * coords_screen.z;
-
-                        // sample the specular map
-                        VAL specular = surface.get_specular_map().sample_specular(uv_screen);
-
-                        // sample the tangent map, computing its normal
-                        VAL& tangent = surface.get_tangent_map().sample_tangent(uv_screen);
-                        VAR normal = tangent + ax::v3(0.5f);
-                        if (normal.x > 1.0f) normal.x -= 1.0f;
-                        if (normal.y > 1.0f) normal.y -= 1.0f;
-                        if (normal.z > 1.0f) normal.z -= 1.0f;
-
-                        // sample the diffuse map
-                        VAL& diffuse = surface.get_diffuse_map().sample_diffuse(uv_screen);
-
-                        // compute the light normal in triangle-space
-                        VAL& normal_triangle = triangle_space * normal;
-                        VAL light_normal_triangle = std::abs(light * normal_triangle);
-
-                        // compute the color in screen-space
-                        VAL& color_screen = ax::color(
-                            static_cast<uint8_t>(ax::saturate(diffuse.r * light_normal_triangle + diffuse.r * specular, 255.0f)),
-                            static_cast<uint8_t>(ax::saturate(diffuse.g * light_normal_triangle + diffuse.g * specular, 255.0f)),
-                            static_cast<uint8_t>(ax::saturate(diffuse.b * light_normal_triangle + diffuse.b * specular, 255.0f)),
-                            diffuse.a);
-
-                        // update the current pixel
-                        pixel_in_place = ax::basic_pixel(depth_screen, triangle_normal, color_screen);
+                        lods = ax::get_surface_lods(surface, textured);
+                        lods_triangle = sample.triangle;
                     }
+                    VAL& uv_0 = std::get<0>(textured.uvs);
+                    VAL& uv_1 = std::get<1>(textured.uvs) - uv_0;
+                    VAL& uv_2 = std::get<2>(textured.uvs) - uv_0;
+                    VAL& uv_screen = ax::v2(
+                        uv_0.x + (sample.coords_1 * uv_1.x + sample.coords_2 * uv_2.x),
+                        uv_0.y + (sample.coords_1 * uv_1.y + sample.coords_2 * uv_2.y));
+                    ax::write_pixel(i, j, sample.depth, textured.triangle_normal, ax::shade_textured(light, surface, textured, lods, uv_screen), buffer);
                 }
             }
-        }
+        });
+        AX_RENDER_STAT(clock.lap(&ax::render_times::shade));
+        AX_RENDER_STAT(clock.finish());
     }
 
-    void draw_textured_ortho(const ax::v3& light, const ax::basic_model& model, ax::basic_buffer& buffer)
+    void draw_textured_ortho(const ax::v3& light, const ax::basic_surface& surface, const ax::triangle2& uvs, const ax::triangle3& triangle, ax::basic_buffer& buffer, ax::hierarchical_depth* hierarchical_depth, ax::render_stats* render_stats)
     {
-        VAL& forward = ax::v3(0.0f, 0.0f, 1.0f);
+        ax::draw_textured_triangle(light, surface, uvs, triangle, buffer, hierarchical_depth, render_stats);
+    }
+
+    void draw_textured_ortho(const ax::v3& light, const ax::basic_surface& surface, const ax::triangle2& uvs, const ax::triangle3& triangle, ax::planar_buffer& buffer, ax::hierarchical_depth* hierarchical_depth, ax::render_stats* render_stats)
+    {
+        ax::draw_textured_triangle(light, surface, uvs, triangle, buffer, hierarchical_depth, render_stats);
+    }
+
+    void draw_textured_ortho(const ax::v3& light, const ax::basic_model& model, ax::basic_buffer& buffer, ax::hierarchical_depth* hierarchical_depth, ax::vertex_cache* vertex_cache, ax::render_stats* render_stats)
+    {
+        ax::draw_textured_model(light, model, model.get_surface(), buffer, hierarchical_depth, vertex_cache, render_stats);
+    }
+
+    void draw_textured_ortho(const ax::v3& light, const ax::basic_model& model, ax::planar_buffer& buffer, ax::hierarchical_depth* hierarchical_depth, ax::vertex_cache* vertex_cache, ax::render_stats* render_stats)
+    {
+        ax::draw_textured_model(light, model, model.get_surface(), buffer, hierarchical_depth, vertex_cache, render_stats);
+    }
+
+    void draw_textured_ortho_tiled(const ax::v3& light, const ax::basic_model& model, ax::basic_buffer& buffer, int tile_size, ax::hierarchical_depth* hierarchical_depth, ax::vertex_cache* vertex_cache, ax::render_stats* render_stats)
+    {
+        ax::draw_textured_model_tiled(light, model, model.get_surface(), buffer, tile_size, ax::worker_pool::get_default(), hierarchical_depth, vertex_cache, render_stats);
+    }
+
+    void draw_textured_ortho_tiled(const ax::v3& light, const ax::basic_model& model, ax::basic_buffer& buffer, int tile_size, ax::worker_pool& pool, ax::hierarchical_depth* hierarchical_depth, ax::vertex_cache* vertex_cache, ax::render_stats* render_stats)
+    {
+        ax::draw_textured_model_tiled(light, model, model.get_surface(), buffer, tile_size, pool, hierarchical_depth, vertex_cache, render_stats);
+    }
+
+    void draw_textured_ortho_tiled(const ax::v3& light, const ax::basic_model& model, ax::planar_buffer& buffer, int tile_size, ax::hierarchical_depth* hierarchical_depth, ax::vertex_cache* vertex_cache, ax::render_stats* render_stats)
+    {
+        ax::draw_textured_model_tiled(light, model, model.get_surface(), buffer, tile_size, ax::worker_pool::get_default(), hierarchical_depth, vertex_cache, render_stats);
+    }
+
+    void draw_textured_ortho_tiled(const ax::v3& light, const ax::basic_model& model, ax::planar_buffer& buffer, int tile_size, ax::worker_pool& pool, ax::hierarchical_depth* hierarchical_depth, ax::vertex_cache* vertex_cache, ax::render_stats* render_stats)
+    {
+        ax::draw_textured_model_tiled(light, model, model.get_surface(), buffer, tile_size, pool, hierarchical_depth, vertex_cache, render_stats);
+    }
+
+    void draw_textured_ortho(const ax::v3& light, const ax::model_lods& lods, ax::basic_buffer& buffer, ax::hierarchical_depth* hierarchical_depth, ax::vertex_cache* vertex_cache, ax::render_stats* render_stats)
+    {
+        VAL& level = lods.get_level(lods.select_level(buffer.get_width(), buffer.get_height()));
+        ax::draw_textured_model(light, level, lods.get_model().get_surface(), buffer, hierarchical_depth, vertex_cache, render_stats);
+    }
+
+    void draw_textured_ortho(const ax::v3& light, const ax::model_lods& lods, ax::planar_buffer& buffer, ax::hierarchical_depth* hierarchical_depth, ax::vertex_cache* vertex_cache, ax::render_stats* render_stats)
+    {
+        VAL& level = lods.get_level(lods.select_level(buffer.get_width(), buffer.get_height()));
+        ax::draw_textured_model(light, level, lods.get_model().get_surface(), buffer, hierarchical_depth, vertex_cache, render_stats);
+    }
+
+    void draw_textured_ortho_tiled(const ax::v3& light, const ax::model_lods& lods, ax::basic_buffer& buffer, int tile_size, ax::worker_pool& pool, ax::hierarchical_depth* hierarchical_depth, ax::vertex_cache* vertex_cache, ax::render_stats* render_stats)
+    {
+        VAL& level = lods.get_level(lods.select_level(buffer.get_width(), buffer.get_height()));
+        ax::draw_textured_model_tiled(light, level, lods.get_model().get_surface(), buffer, tile_size, pool, hierarchical_depth, vertex_cache, render_stats);
+    }
+
+    void draw_textured_ortho_tiled(const ax::v3& light, const ax::model_lods& lods, ax::planar_buffer& buffer, int tile_size, ax::worker_pool& pool, ax::hierarchical_depth* hierarchical_depth, ax::vertex_cache* vertex_cache, ax::render_stats* render_stats)
+    {
+        VAL& level = lods.get_level(lods.select_level(buffer.get_width(), buffer.get_height()));
+        ax::draw_textured_model_tiled(light, level, lods.get_model().get_surface(), buffer, tile_size, pool, hierarchical_depth, vertex_cache, render_stats);
+    }
+
+    void draw_textured_ortho_instanced(const ax::basic_model& model, const ax::model_instance* instances, std::size_t instance_count, ax::basic_buffer& buffer, int tile_size, ax::hierarchical_depth* hierarchical_depth, ax::render_stats* render_stats)
+    {
+        ax::draw_textured_model_instanced(model, instances, instance_count, buffer, tile_size, ax::worker_pool::get_default(), hierarchical_depth, render_stats);
+    }
+
+    void draw_textured_ortho_instanced(const ax::basic_model& model, const ax::model_instance* instances, std::size_t instance_count, ax::basic_buffer& buffer, int tile_size, ax::worker_pool& pool, ax::hierarchical_depth* hierarchical_depth, ax::render_stats* render_stats)
+    {
+        ax::draw_textured_model_instanced(model, instances, instance_count, buffer, tile_size, pool, hierarchical_depth, render_stats);
+    }
+
+    void draw_textured_ortho_instanced(const ax::basic_model& model, const ax::model_instance* instances, std::size_t instance_count, ax::planar_buffer& buffer, int tile_size, ax::hierarchical_depth* hierarchical_depth, ax::render_stats* render_stats)
+    {
+        ax::draw_textured_model_instanced(model, instances, instance_count, buffer, tile_size, ax::worker_pool::get_default(), hierarchical_depth, render_stats);
+    }
+
+    void draw_textured_ortho_instanced(const ax::basic_model& model, const ax::model_instance* instances, std::size_t instance_count, ax::planar_buffer& buffer, int tile_size, ax::worker_pool& pool, ax::hierarchical_depth* hierarchical_depth, ax::render_stats* render_stats)
+    {
+        ax::draw_textured_model_instanced(model, instances, instance_count, buffer, tile_size, pool, hierarchical_depth, render_stats);
+    }
+
+    void draw_textured_ortho_deferred(const ax::v3& light, const ax::basic_model& model, ax::basic_buffer& buffer, int tile_size, ax::visibility_buffer* visibility_buffer, ax::vertex_cache* vertex_cache, ax::render_stats* render_stats)
+    {
+        ax::draw_textured_model_deferred(light, model, buffer, tile_size, ax::worker_pool::get_default(), visibility_buffer, vertex_cache, render_stats);
+    }
+
+    void draw_textured_ortho_deferred(const ax::v3& light, const ax::basic_model& model, ax::basic_buffer& buffer, int tile_size, ax::worker_pool& pool, ax::visibility_buffer* visibility_buffer, ax::vertex_cache* vertex_cache, ax::render_stats* render_stats)
+    {
+        ax::draw_textured_model_deferred(light, model, buffer, tile_size, pool, visibility_buffer, vertex_cache, render_stats);
+    }
+
+    void draw_textured_ortho_deferred(const ax::v3& light, const ax::basic_model& model, ax::planar_buffer& buffer, int tile_size, ax::visibility_buffer* visibility_buffer, ax::vertex_cache* vertex_cache, ax::render_stats* render_stats)
+    {
+        ax::draw_textured_model_deferred(light, model, buffer, tile_size, ax::worker_pool::get_default(), visibility_buffer, vertex_cache, render_stats);
+    }
+
+    void draw_textured_ortho_deferred(const ax::v3& light, const ax::basic_model& model, ax::planar_buffer& buffer, int tile_size, ax::worker_pool& pool, ax::visibility_buffer* visibility_buffer, ax::vertex_cache* vertex_cache, ax::render_stats* render_stats)
+    {
+        ax::draw_textured_model_deferred(light, model, buffer, tile_size, pool, visibility_buffer, vertex_cache, render_stats);
+    }
+
+    // A band's write to a tga, run by a pool job unless the thread waiting on it gets to it first.
+    using tga_band_write = ax::claimed_jobs<ax::option<std::string>>;
+
+    // Waits on an in-flight band write on every exit path, so that unwinding can't destroy the
+    // band buffer or stream while a pool thread is still writing from it.
+    struct tga_band_write_guard
+    {
+        std::shared_ptr<ax::tga_band_write>& write;
+        ~tga_band_write_guard() { if (write) write->wait(); }
+    };
+
+    ax::option<std::string> try_draw_textured_ortho_to_tga(const ax::v3& light, const ax::basic_model& model, const ax::basic_pixel& clear_pixel, int width, int height, const char* file_path, int band_height, int tile_size, ax::render_stats* render_stats)
+    {
+        return ax::try_draw_textured_ortho_to_tga(light, model, clear_pixel, width, height, file_path, band_height, tile_size, ax::worker_pool::get_default(), render_stats);
+    }
+
+    // Render bands into two alternating band buffers, streaming each to the file bottom-up while
+    // the next renders, so that peak memory is twice a band rather than the whole image.
+    ax::option<std::string> try_draw_textured_ortho_to_tga(const ax::v3& light, const ax::basic_model& model, const ax::basic_pixel& clear_pixel, int width, int height, const char* file_path, int band_height, int tile_size, ax::worker_pool& pool, ax::render_stats* render_stats)
+    {
+        // open the file, writing the header up front and removing a partial file on failure
+        std::ofstream out;
+        out.open(file_path, std::ios::binary);
+        if (!out.is_open()) return ax::some("Can't open tga file "_s + file_path + " for a banded draw.");
+        VAL fail = [&](const ax::option<std::string>& error_opt)
+        {
+            out.close();
+            std::remove(file_path);
+            return error_opt;
+        };
+        VAL& header_error_opt = ax::basic_buffer::try_write_tga_header(width, height, out);
+        if (header_error_opt) return fail(header_error_opt);
+
+        // run the vertex stage for the whole target
+        AX_RENDER_STAT(ax::stage_clock clock(render_stats));
+        ax::vertex_cache vertex_cache;
+        VAL& vertices = vertex_cache.update(model, width, height, pool);
+        AX_RENDER_STAT(clock.lap(&ax::render_times::vertex));
+
+        // bin front-facing faces into the bands their bounds overlap, each chunk of faces into
+        // its own bins to keep submission order
+        VAL band_rows_max = std::max(1, std::min(band_height, height));
+        VAL band_count = (height + band_rows_max - 1) / band_rows_max;
+        VAL& model_vertices = model.get_vertices();
+        VAL& indices = model.get_indices();
+        VAL face_count = ax::itoz(model.get_face_count());
+        VAL chunk_count = std::max(1_z, std::min(pool.get_thread_count() + 1_z, face_count / 256_z));
+        std::vector<std::vector<std::vector<uint32_t>>> bins(chunk_count, std::vector<std::vector<uint32_t>>(ax::itoz(std::max(0, band_count))));
+        pool.parallel_for(band_count > 0 ? chunk_count : 0_z, [&](std::size_t chunk)
+        {
+            VAR& chunk_bins = bins[chunk];
+            AX_RENDER_STAT(ax::render_counts counts{});
+            for (VAR i = face_count * chunk / chunk_count; i < face_count * (chunk + 1_z) / chunk_count; ++i)
+            {
+                // reject back-facing and offscreen faces
+                VAL face = indices.data() + i * 3_z;
+                AX_RENDER_STAT(++counts.triangles_submitted);
+                if (!ax::get_front_facing(ax::triangle3(model_vertices[face[0]].position, model_vertices[face[1]].position, model_vertices[face[2]].position)))
+                {
+                    AX_RENDER_STAT(++counts.triangles_backfacing);
+                    continue;
+                }
+                VAL& bounds = ax::get_bounds(ax::triangle2(vertices[face[0]].position, vertices[face[1]].position, vertices[face[2]].position));
+                VAL left = static_cast<int>(bounds.first.x);
+                VAL bottom = static_cast<int>(bounds.first.y);
+                VAL right = static_cast<int>(bounds.second.x);
+                VAL top = static_cast<int>(bounds.second.y);
+                if (right < 0 || top < 0 || left >= width || bottom >= height)
+                {
+                    AX_RENDER_STAT(++counts.triangles_offscreen);
+                    continue;
+                }
+                for (VAR band = std::max(0, bottom) / band_rows_max; band <= std::min(height - 1, top) / band_rows_max; ++band)
+                    chunk_bins[ax::itoz(band)].push_back(static_cast<uint32_t>(i));
+            }
+            AX_RENDER_STAT(ax::add_render_counts(render_stats, counts));
+        });
+        AX_RENDER_STAT(clock.lap(&ax::render_times::setup));
+
+        // render bands bottom-up, alternating between two band buffers so that each band renders
+        // while the one before it is written on the pool
         VAL& surface = model.get_surface();
-        for (VAR i = 0_z; i < model.get_faces().size(); ++i)
+        ax::basic_buffer band_buffers[2] = { ax::basic_buffer(width, band_rows_max), ax::basic_buffer(width, band_rows_max) };
+        VAL tile_alignment = ax::get_tile_alignment(band_buffers[0]);
+        VAL tile_extent = (std::max(1, tile_size) + tile_alignment - 1) / tile_alignment * tile_alignment;
+        VAL tiles_x = (width + tile_extent - 1) / tile_extent;
+        std::shared_ptr<ax::tga_band_write> write;
+        ax::tga_band_write_guard write_guard{write};
+        std::vector<uint32_t> band_faces;
+        ax::textured_bins band_binned;
+        band_binned.tile_extent = tile_extent;
+        band_binned.tiles_x = tiles_x;
+        for (VAR band = 0; band < band_count; ++band)
         {
-            VAL& face = model.get_face(i);
-            VAL& triangle = ax::triangle3(model.get_position(face[0]), model.get_position(face[1]), model.get_position(face[2]));
-            VAL& normal = ax::get_normal(triangle);
-            VAL not_back_face = normal * forward > 0;
-            if (not_back_face)
+            // gather the band's faces in submission order
+            VAR& buffer = band_buffers[band % 2];
+            VAL band_y = band * band_rows_max;
+            VAL band_rows = std::min(band_rows_max, height - band_y);
+            band_faces.clear();
+            for (VAL& chunk_bins : bins) band_faces.insert(band_faces.end(), chunk_bins[ax::itoz(band)].begin(), chunk_bins[ax::itoz(band)].end());
+
+            // set them up in band space, shifting by whole rows so that they rasterize exactly as
+            // they would in the whole target, and bin them into the band's tiles
+            VAL offset = ax::v2(0.0f, static_cast<float>(band_y));
+            VAL setup_chunk_count = std::max(1_z, std::min(pool.get_thread_count() + 1_z, band_faces.size() / 256_z));
+            band_binned.tiles_y = (band_rows + tile_extent - 1) / tile_extent;
+            band_binned.triangles.resize(band_faces.size());
+            band_binned.bins.assign(setup_chunk_count, std::vector<std::vector<uint32_t>>(ax::itoz(tiles_x * band_binned.tiles_y)));
+            pool.parallel_for(setup_chunk_count, [&](std::size_t chunk)
+            {
+                for (VAR i = band_faces.size() * chunk / setup_chunk_count; i < band_faces.size() * (chunk + 1_z) / setup_chunk_count; ++i)
+                {
+                    VAL face = indices.data() + band_faces[i] * 3_z;
+                    VAL& vertex_0 = model_vertices[face[0]];
+                    VAL& vertex_1 = model_vertices[face[1]];
+                    VAL& vertex_2 = model_vertices[face[2]];
+                    VAR& textured = band_binned.triangles[i];
+                    textured = ax::make_textured_triangle(
+                        ax::triangle2(vertex_0.uv, vertex_1.uv, vertex_2.uv),
+                        ax::triangle3(vertex_0.position, vertex_1.position, vertex_2.position),
+                        ax::triangle2(vertices[face[0]].position - offset, vertices[face[1]].position - offset, vertices[face[2]].position - offset));
+                    ax::bin_textured_triangle(textured.bounds_screen, width, band_rows, tile_extent, tiles_x, static_cast<uint32_t>(i), band_binned.bins[chunk]);
+                }
+            });
+            AX_RENDER_STAT(clock.lap(&ax::render_times::setup));
+
+            // rasterize tiles of the band independently
+            buffer.fast_clear(clear_pixel);
+            pool.parallel_for(ax::itoz(tiles_x * band_binned.tiles_y), [&](std::size_t tile)
             {
-                VAL& uvs = ax::triangle2(model.get_uv(i, 0), model.get_uv(i, 1), model.get_uv(i, 2));
-                draw_textured_ortho(light, surface, uvs, triangle, buffer);
+                VAL& clip = ax::get_tile_clip(band_binned, tile, width, band_rows);
+                for (VAL& chunk_bins : band_binned.bins)
+                    for (VAL triangle_index : chunk_bins[tile])
+                        ax::draw_textured_triangle(light, surface, band_binned.triangles[triangle_index], clip, buffer, nullptr, render_stats);
+            });
+            AX_RENDER_STAT(clock.lap(&ax::render_times::raster));
+
+            // write the band once the band before it is written
+            if (write)
+            {
+                VAL& write_error_opt = write->wait()[0];
+                if (write_error_opt) return fail(write_error_opt);
             }
+            write = std::make_shared<ax::tga_band_write>(std::vector<std::function<ax::option<std::string>()>>{ [&buffer, &out, band_rows]() { return buffer.try_write_tga_rows(0, band_rows, out); } });
+            pool.submit([write]() { write->run(0_z); });
+        }
+
+        // finish writing
+        AX_RENDER_STAT(clock.finish());
+        if (write)
+        {
+            VAL& write_error_opt = write->wait()[0];
+            if (write_error_opt) return fail(write_error_opt);
         }
+        VAL& footer_error_opt = ax::basic_buffer::try_write_tga_footer(out);
+        if (footer_error_opt) return fail(footer_error_opt);
+        out.close();
+        if (!out) return fail(ax::some("Failed to write tga file "_s + file_path + "."));
+        return ax::none<std::string>();
     }
 }
@@ -1,13 +1,65 @@
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <functional>
 #include <iostream>
 #include <fstream>
-#include <sstream>
+#include <thread>
+#include <unordered_map>
+
+#if defined(_WIN32)
+    #include <process.h>
+#else
+    #include <unistd.h>
+#endif
 
 #include "ax/basic_model.hpp"
 
+#include "ax/mapped_file.hpp"
+#include "ax/model_order.hpp"
 #include "ax/string.hpp"
 
 namespace ax
 {
+    // The maps of a load, shared with the jobs loading them.
+    struct surface_load::state
+    {
+        explicit state(std::vector<std::function<ax::option<std::string>()>> loads) : loads(std::move(loads)) { }
+        ax::claimed_jobs<ax::option<std::string>> loads;
+    };
+
+    surface_load::surface_load() : shared() { }
+
+    surface_load::surface_load(surface_load&& that) : shared(std::move(that.shared)) { }
+
+    surface_load::~surface_load()
+    {
+        wait();
+    }
+
+    surface_load& surface_load::operator=(surface_load&& that)
+    {
+        if (this != &that)
+        {
+            wait();
+            shared = std::move(that.shared);
+        }
+        return *this;
+    }
+
+    ax::option<std::string> surface_load::wait()
+    {
+        // load whatever no job has started, then wait on the rest and report the first error
+        if (!shared) return ax::none<std::string>();
+        VAL local = std::move(shared);
+        for (VAL& error_opt : local->loads.wait()) if (error_opt) return error_opt;
+        return ax::none<std::string>();
+    }
+
     basic_surface::basic_surface() :
         diffuse_map(),
         tangent_map(),
@@ -23,33 +75,327 @@ namespace ax
         specular_map.clear();
     }
 
-    void basic_surface::read_from_obj(const char* file_path)
+    ax::surface_load basic_surface::read_from_obj_async(const char* file_path, ax::worker_pool& pool)
+    {
+        // the maps sit next to the obj, named by suffix, since mtl files aren't read
+        struct surface_map { const char* suffix; ax::texture_format format; ax::basic_texture* texture; };
+        const surface_map maps[] =
+        {
+            { "_diffuse.tga", ax::texture_rgba8, &diffuse_map },
+            { "_nm_tangent.tga", ax::texture_normal, &tangent_map },
+            { "_spec.tga", ax::texture_r8, &specular_map }
+        };
+
+        // queue a job per map
+        VAL file_path_str = std::string(file_path);
+        std::vector<std::function<ax::option<std::string>()>> loads;
+        for (VAL& map : maps)
+            loads.push_back([file_path_str, map, &pool]() { return try_read_texture_from_tga(file_path_str, map.suffix, map.format, pool, *map.texture); });
+        ax::surface_load load;
+        load.shared = std::make_shared<ax::surface_load::state>(std::move(loads));
+        for (VAR i = 0_z; i < load.shared->loads.get_count(); ++i)
+        {
+            VAL shared = load.shared;
+            pool.submit([shared, i]() { shared->loads.run(i); });
+        }
+        return load;
+    }
+
+    ax::option<std::string> basic_surface::try_read_from_obj(const char* file_path)
+    {
+        return try_read_from_obj(file_path, ax::worker_pool::get_default());
+    }
+
+    ax::option<std::string> basic_surface::try_read_from_obj(const char* file_path, ax::worker_pool& pool)
     {
-        // TODO: use the map_XX parses instead of hard-coding like this.
-        // https://en.wikipedia.org/wiki/Wavefront_.obj_file#Texture_maps
-        try_read_buffer_from_tga(file_path, "_diffuse.tga", diffuse_map);
-        try_read_buffer_from_tga(file_path, "_nm_tangent.tga", tangent_map);
-        try_read_buffer_from_tga(file_path, "_spec.tga", specular_map);
+        return read_from_obj_async(file_path, pool).wait();
     }
 
-    bool basic_surface::try_read_buffer_from_tga(std::string file_path, const char* suffix, basic_buffer& buffer)
+    ax::option<std::string> basic_surface::try_read_texture_from_tga(const std::string& file_path, const char* suffix, ax::texture_format format, ax::worker_pool& pool, ax::basic_texture& texture)
     {
-        std::string texfile(file_path);
-        size_t dot = texfile.find_last_of(".");
-        if (dot != std::string::npos)
+        // find the map's file, it being fine for there to be none
+        texture.clear();
+        VAL dot = file_path.find_last_of('.');
+        if (dot == std::string::npos) return ax::none<std::string>();
+        VAL& texture_path = file_path.substr(0, dot) + suffix;
+        std::error_code error_code;
+        if (!std::filesystem::exists(texture_path, error_code)) return ax::none<std::string>();
+
+        // load it with its mips
+        VAL& error_opt = texture.try_read_from_tga(texture_path.c_str(), format);
+        if (error_opt) return error_opt;
+        texture.generate_mips(pool);
+        return ax::none<std::string>();
+    }
+
+    // Hashes a position / uv / normal index triple for welding.
+    struct vertex_source_hash
+    {
+        std::size_t operator()(const ax::v3i& source) const
         {
-            texfile = texfile.substr(0, dot) + std::string(suffix);
-            buffer.try_read_from_tga(texfile.c_str());
-            return true;
+            VAL hash = static_cast<uint64_t>(static_cast<uint32_t>(source.x)) * 0x9E3779B97F4A7C15ull ^
+                static_cast<uint64_t>(static_cast<uint32_t>(source.y)) * 0xC2B2AE3D27D4EB4Full ^
+                static_cast<uint64_t>(static_cast<uint32_t>(source.z)) * 0x165667B19E3779F9ull;
+            return static_cast<std::size_t>(hash ^ (hash >> 32));
         }
-        return false;
+    };
+
+    // The attributes and triangulated face corners parsed from one line-aligned chunk of an obj.
+    // Negative (relative) obj indices can reach back before the chunk, so corner components
+    // resolved against the chunk's own attribute counts are flagged for fix-up when merging.
+    struct obj_chunk
+    {
+        std::vector<ax::v3> positions;
+        std::vector<ax::v2> uvs;
+        std::vector<ax::v3> normals;
+        std::vector<ax::v3i> corners;
+        std::vector<uint8_t> corner_relatives;
+        int malformed_line = -1;
+    };
+
+    static const double obj_powers_of_ten[] =
+    {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    static inline bool get_obj_space(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    static inline bool get_obj_digit(char c)
+    {
+        return static_cast<unsigned char>(c - '0') < 10u;
+    }
+
+    static inline const char* skip_obj_spaces(const char* it, const char* end)
+    {
+        while (it != end && ax::get_obj_space(*it)) ++it;
+        return it;
+    }
+
+    // Parse a float in the manner of std::from_chars, returning the position after it, or
+    // nullptr when there's no number. Numbers whose significand and power of ten are both exact
+    // in a double take a fast path, while the rare remainder fall back to strtof.
+    static const char* parse_obj_float(const char* it, const char* end, float& value)
+    {
+        // parse sign
+        VAL start = it;
+        VAR negative = false;
+        if (it != end && (*it == '-' || *it == '+')) negative = *it++ == '-';
+
+        // parse significand, keeping up to 19 significant digits
+        VAR significand = 0ull;
+        VAR significant_digits = 0;
+        VAR exponent = 0;
+        VAR any_digits = false;
+        for (; it != end && ax::get_obj_digit(*it); ++it, any_digits = true)
+        {
+            if (significant_digits < 19) significand = significand * 10ull + static_cast<uint64_t>(*it - '0');
+            else ++exponent;
+            if (significand) ++significant_digits;
+        }
+        if (it != end && *it == '.')
+        {
+            for (++it; it != end && ax::get_obj_digit(*it); ++it, any_digits = true)
+            {
+                if (significant_digits >= 19) continue;
+                significand = significand * 10ull + static_cast<uint64_t>(*it - '0');
+                if (significand) ++significant_digits;
+                --exponent;
+            }
+        }
+        if (!any_digits) return nullptr;
+
+        // parse exponent
+        if (it != end && (*it == 'e' || *it == 'E'))
+        {
+            VAR exponent_it = it + 1;
+            VAR exponent_negative = false;
+            if (exponent_it != end && (*exponent_it == '-' || *exponent_it == '+')) exponent_negative = *exponent_it++ == '-';
+            if (exponent_it != end && ax::get_obj_digit(*exponent_it))
+            {
+                VAR exponent_explicit = 0;
+                for (; exponent_it != end && ax::get_obj_digit(*exponent_it); ++exponent_it)
+                    if (exponent_explicit < 100000) exponent_explicit = exponent_explicit * 10 + (*exponent_it - '0');
+                exponent += exponent_negative ? -exponent_explicit : exponent_explicit;
+                it = exponent_it;
+            }
+        }
+
+        // take the fast path when exact, else fall back
+        if (significand < (1ull << 53) && exponent >= -22 && exponent <= 22)
+        {
+            VAR result = static_cast<double>(significand);
+            result = exponent < 0 ? result / ax::obj_powers_of_ten[-exponent] : result * ax::obj_powers_of_ten[exponent];
+            value = static_cast<float>(negative ? -result : result);
+            return it;
+        }
+        value = std::strtof(std::string(start, it).c_str(), nullptr);
+        return it;
+    }
+
+    // Parse a face corner's v, v/vt, v//vn or v/vt/vn indices, resolving them to zero-based
+    // indices, or return nullptr when malformed. Missing components become -1.
+    static const char* parse_obj_corner(const char* it, const char* end, const ax::obj_chunk& chunk, ax::v3i& corner, uint8_t& relatives)
+    {
+        // parse components
+        int components[] = { 0, 0, 0 };
+        for (VAR k = 0; k < 3; ++k)
+        {
+            if (k > 0)
+            {
+                if (it == end || *it != '/') break;
+                ++it;
+                if (it != end && *it == '/') continue;
+            }
+            VAL& result = std::from_chars(it, end, components[k]);
+            if (result.ec != std::errc() && k == 0) return nullptr;
+            if (result.ec == std::errc() && components[k] == 0) return nullptr;
+            if (result.ec == std::errc()) it = result.ptr;
+        }
+
+        // resolve them
+        const int counts[] = { ax::ztoi(chunk.positions.size()), ax::ztoi(chunk.uvs.size()), ax::ztoi(chunk.normals.size()) };
+        relatives = 0;
+        for (VAR k = 0; k < 3; ++k)
+        {
+            VAL component = components[k];
+            if (component < 0) relatives |= static_cast<uint8_t>(1 << k);
+            corner[k] = component > 0 ? component - 1 : component < 0 ? counts[k] + component : -1;
+        }
+        return it;
+    }
+
+    // Parse a line into the chunk, returning false for a malformed face.
+    static bool parse_obj_line(const char* it, const char* end, ax::obj_chunk& chunk, std::vector<ax::v3i>& polygon, std::vector<uint8_t>& polygon_relatives)
+    {
+        // dispatch on the line's keyword
+        it = ax::skip_obj_spaces(it, end);
+        VAL length = end - it;
+        if (length >= 2 && it[0] == 'v' && ax::get_obj_space(it[1]))
+        {
+            ax::v3 position(0.0f);
+            it += 2;
+            for (VAR k = 0; k < 3 && it; ++k) it = ax::parse_obj_float(ax::skip_obj_spaces(it, end), end, position[k]);
+            chunk.positions.push_back(position);
+        }
+        else if (length >= 3 && it[0] == 'v' && it[1] == 't' && ax::get_obj_space(it[2]))
+        {
+            ax::v2 uv(0.0f);
+            it += 3;
+            for (VAR k = 0; k < 2 && it; ++k) it = ax::parse_obj_float(ax::skip_obj_spaces(it, end), end, uv[k]);
+            chunk.uvs.push_back(uv);
+        }
+        else if (length >= 3 && it[0] == 'v' && it[1] == 'n' && ax::get_obj_space(it[2]))
+        {
+            ax::v3 normal(0.0f);
+            it += 3;
+            for (VAR k = 0; k < 3 && it; ++k) it = ax::parse_obj_float(ax::skip_obj_spaces(it, end), end, normal[k]);
+            chunk.normals.push_back(normal);
+        }
+        else if (length >= 2 && it[0] == 'f' && ax::get_obj_space(it[1]))
+        {
+            // parse the polygon's corners
+            polygon.clear();
+            polygon_relatives.clear();
+            it += 2;
+            while (true)
+            {
+                it = ax::skip_obj_spaces(it, end);
+                if (it == end) break;
+                ax::v3i corner;
+                uint8_t relatives;
+                it = ax::parse_obj_corner(it, end, chunk, corner, relatives);
+                if (!it || (it != end && !ax::get_obj_space(*it))) return false;
+                polygon.push_back(corner);
+                polygon_relatives.push_back(relatives);
+            }
+            if (polygon.size() < 3_z) return false;
+
+            // triangulate it as a fan
+            for (VAR k = 1_z; k + 1_z < polygon.size(); ++k)
+            {
+                for (VAL corner_index : { 0_z, k, k + 1_z })
+                {
+                    chunk.corners.push_back(polygon[corner_index]);
+                    chunk.corner_relatives.push_back(polygon_relatives[corner_index]);
+                }
+            }
+        }
+        return true;
+    }
+
+    // Parse a chunk, noting the first malformed line in it, or, given a corner, parse only as far
+    // as the line that produced it, returning that line.
+    static int parse_obj_chunk(const char* it, const char* end, ax::obj_chunk& chunk, std::size_t corner = SIZE_MAX)
+    {
+        std::vector<ax::v3i> polygon;
+        std::vector<uint8_t> polygon_relatives;
+        for (VAR line = 0; it < end; ++line)
+        {
+            VAL newline = static_cast<const char*>(std::memchr(it, '\n', static_cast<std::size_t>(end - it)));
+            VAL line_end = newline ? newline : end;
+            if (!ax::parse_obj_line(it, line_end, chunk, polygon, polygon_relatives) && chunk.malformed_line < 0) chunk.malformed_line = line;
+            if (chunk.corners.size() > corner) return line;
+            it = line_end + 1;
+        }
+        return -1;
+    }
+
+    // The header of the binary model format. Each array follows at its offset, aligned to
+    // model_binary_alignment, in the writer's native (in practice, little-endian) layout.
+    struct model_binary_header
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t header_size;
+        uint32_t vertex_size;
+        uint64_t source_size;
+        int64_t source_time;
+        uint64_t counts[2];
+        uint64_t offsets[2];
+    };
+
+    static const char model_binary_magic[4] = { 'A', 'X', 'M', 'B' };
+    constexpr uint32_t model_binary_version = 3u;
+    constexpr uint64_t model_binary_alignment = 64ull;
+
+    // The id of this process, telling apart temporaries written by concurrent loaders.
+    static long long get_process_id()
+    {
+#if defined(_WIN32)
+        return static_cast<long long>(_getpid());
+#else
+        return static_cast<long long>(getpid());
+#endif
+    }
+
+    // Stamp an obj by its size and modification time so that a stale cache can be detected.
+    static bool try_get_model_source_stamp(const char* file_path, uint64_t& size, int64_t& time)
+    {
+        std::error_code error;
+        VAL file_size = std::filesystem::file_size(file_path, error);
+        if (error) return false;
+        VAL file_time = std::filesystem::last_write_time(file_path, error);
+        if (error) return false;
+        size = static_cast<uint64_t>(file_size);
+        time = static_cast<int64_t>(file_time.time_since_epoch().count());
+        return true;
+    }
+
+    // Take a geometry version no model has had yet.
+    static uint64_t get_next_geometry_version()
+    {
+        static std::atomic<uint64_t> next_geometry_version{1ull};
+        return next_geometry_version.fetch_add(1ull, std::memory_order_relaxed);
     }
 
     basic_model::basic_model() :
-        faces(),
-        positions(),
-        uvs(),
-        normals(),
+        vertices(),
+        indices(),
+        geometry_version(ax::get_next_geometry_version()),
         surface()
     { }
 
@@ -58,96 +404,387 @@ namespace ax
     std::vector<int> basic_model::get_face(int index) const
     {
         std::vector<int> face;
-        for (int i = 0; i < (int)faces[index].size(); i++) face.push_back(faces[index][i][0]);
+        for (int i = 0; i < 3; i++) face.push_back(static_cast<int>(indices[index * 3 + i]));
         return face;
     }
 
     ax::v3 basic_model::get_position(int face_index, int vertex_index) const
     {
-        return positions[faces[face_index][vertex_index][0]];
+        return vertices[indices[face_index * 3 + vertex_index]].position;
     }
 
     ax::v3 basic_model::get_position(int index) const
     {
-        return positions[index];
+        return vertices[index].position;
     }
 
     ax::v2 basic_model::get_uv(int face_index, int vertex_index) const
     {
-        return uvs[faces[face_index][vertex_index][1]];
+        return vertices[indices[face_index * 3 + vertex_index]].uv;
     }
 
     ax::v2 basic_model::get_uv(int index) const
     {
-        return uvs[index];
+        return vertices[index].uv;
     }
 
     ax::v3 basic_model::get_normal(int face_index, int vertex_index) const
     {
-        int idx = faces[face_index][vertex_index][2];
-        ax::v3 v = normals[idx];
-        return v.NormalizeSafe();
+        return vertices[indices[face_index * 3 + vertex_index]].normal;
     }
 
     ax::v3 basic_model::get_normal(int index) const
     {
-        return normals[index];
+        return vertices[index].normal;
+    }
+
+    std::vector<std::vector<ax::v3i>> basic_model::get_faces() const
+    {
+        std::vector<std::vector<ax::v3i>> faces(indices.size() / 3_z);
+        for (VAR i = 0_z; i < faces.size(); ++i)
+            for (VAR k = 0_z; k < 3_z; ++k)
+                faces[i].push_back(ax::v3i(static_cast<int>(indices[i * 3_z + k])));
+        return faces;
+    }
+
+    std::vector<ax::v3> basic_model::get_positions() const
+    {
+        std::vector<ax::v3> positions(vertices.size());
+        for (VAR i = 0_z; i < vertices.size(); ++i) positions[i] = vertices[i].position;
+        return positions;
+    }
+
+    std::vector<ax::v2> basic_model::get_uvs() const
+    {
+        std::vector<ax::v2> uvs(vertices.size());
+        for (VAR i = 0_z; i < vertices.size(); ++i) uvs[i] = vertices[i].uv;
+        return uvs;
+    }
+
+    std::vector<ax::v3> basic_model::get_normals() const
+    {
+        std::vector<ax::v3> normals(vertices.size());
+        for (VAR i = 0_z; i < vertices.size(); ++i) normals[i] = vertices[i].normal;
+        return normals;
+    }
+
+    ax::option<std::string> basic_model::try_read_from_obj(const char* file_path)
+    {
+        return try_read_from_obj(file_path, ax::worker_pool::get_default());
     }
 
-    ax::option<std::string> basic_model::try_read_from_obj(const char *file_path)
+    ax::option<std::string> basic_model::try_read_from_obj(const char* file_path, ax::worker_pool& pool)
     {
+        // load the surface's maps while parsing the geometry
         clear();
-        std::ifstream in(file_path, std::ifstream::in);
-        if (!in.fail())
+        VAR surface_load = surface.read_from_obj_async(file_path, pool);
+        VAL& error_opt = try_read_geometry_from_obj(file_path, pool);
+        VAL& surface_error_opt = surface_load.wait();
+        if (error_opt) surface.clear();
+        return error_opt ? error_opt : surface_error_opt;
+    }
+
+    ax::option<std::string> basic_model::try_read_geometry_from_obj(const char* file_path, ax::worker_pool& pool)
+    {
+        // map the file
+        clear_geometry();
+        ax::mapped_file file;
+        if (file.try_open(file_path)) return ax::some("Invalid model file '"_s + file_path + "'.");
+        VAL data = file.get_data();
+        VAL size = file.get_size();
+
+        // split it into line-aligned chunks
+        constexpr VAR chunk_size_min = 256_z * 1024_z;
+        VAL chunk_count = std::max(1_z, std::min(size / chunk_size_min, (pool.get_thread_count() + 1_z) * 4_z));
+        std::vector<const char*> chunk_starts(chunk_count + 1_z);
+        chunk_starts[0] = data;
+        chunk_starts[chunk_count] = data + size;
+        for (VAR i = 1_z; i < chunk_count; ++i)
+        {
+            VAL nominal = std::max(chunk_starts[i - 1_z], data + size * i / chunk_count);
+            VAL newline = static_cast<const char*>(std::memchr(nominal, '\n', static_cast<std::size_t>(data + size - nominal)));
+            chunk_starts[i] = newline ? newline + 1 : data + size;
+        }
+
+        // parse chunks in parallel
+        std::vector<ax::obj_chunk> chunks(chunk_count);
+        pool.parallel_for(chunk_count, [&](std::size_t i) { ax::parse_obj_chunk(chunk_starts[i], chunk_starts[i + 1_z], chunks[i]); });
+
+        // compute where each chunk's attributes and corners land when merged
+        std::vector<ax::v3i> attribute_offsets(chunk_count + 1_z, ax::v3i(0));
+        std::vector<std::size_t> corner_offsets(chunk_count + 1_z, 0_z);
+        for (VAR i = 0_z; i < chunk_count; ++i)
         {
-            std::string line;
-            while (!in.eof())
+            VAL& chunk = chunks[i];
+            attribute_offsets[i + 1_z] = attribute_offsets[i] + ax::v3i(ax::ztoi(chunk.positions.size()), ax::ztoi(chunk.uvs.size()), ax::ztoi(chunk.normals.size()));
+            corner_offsets[i + 1_z] = corner_offsets[i] + chunk.corners.size();
+        }
+        std::vector<ax::v3> positions(ax::itoz(attribute_offsets[chunk_count].x));
+        std::vector<ax::v2> uvs(ax::itoz(attribute_offsets[chunk_count].y));
+        std::vector<ax::v3> normals(ax::itoz(attribute_offsets[chunk_count].z));
+        std::vector<ax::v3i> corners(corner_offsets[chunk_count]);
+
+        // merge in parallel, fixing up relative indices and noting the first corner of each chunk
+        // indexing outside the attributes
+        VAL& totals = attribute_offsets[chunk_count];
+        std::vector<std::size_t> invalid_corners(chunk_count, SIZE_MAX);
+        pool.parallel_for(chunk_count, [&](std::size_t i)
+        {
+            VAL& chunk = chunks[i];
+            VAL& offsets = attribute_offsets[i];
+            std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + offsets.x);
+            std::copy(chunk.uvs.begin(), chunk.uvs.end(), uvs.begin() + offsets.y);
+            std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + offsets.z);
+            for (VAR j = 0_z; j < chunk.corners.size(); ++j)
             {
-                std::getline(in, line);
-                std::istringstream iss(line.c_str());
-                char trash;
-                if (!line.compare(0, 2, "v "))
-                {
-                    iss >> trash;
-                    ax::v3 v;
-                    for (int i = 0; i < 3; i++) iss >> v[i];
-                    positions.push_back(v);
-                }
-                else if (!line.compare(0, 3, "vt "))
+                VAR corner = chunk.corners[j];
+                VAL relatives = chunk.corner_relatives[j];
+                for (VAR k = 0; k < 3; ++k)
                 {
-                    iss >> trash >> trash;
-                    ax::v2 uv;
-                    for (int i = 0; i < 2; i++) iss >> uv[i];
-                    uvs.push_back(uv);
-                }
-                else if (!line.compare(0, 3, "vn "))
-                {
-                    iss >> trash >> trash;
-                    ax::v3 n;
-                    for (int i = 0; i < 3; i++) iss >> n[i];
-                    normals.push_back(n);
-                }
-                else if (!line.compare(0, 2, "f "))
-                {
-                    std::vector<ax::v3i> f;
-                    int position, uv, normal;
-                    iss >> trash;
-                    while (iss >> position >> trash >> uv >> trash >> normal) f.push_back(ax::v3i(position - 1, uv - 1, normal - 1));
-                    faces.push_back(f);
+                    if (relatives & (1 << k)) corner[k] += offsets[k];
+                    VAL present = (relatives & (1 << k)) || corner[k] >= 0;
+                    if (present && (corner[k] < 0 || corner[k] >= totals[k]) && invalid_corners[i] == SIZE_MAX) invalid_corners[i] = j;
                 }
+                corners[corner_offsets[i] + j] = corner;
+            }
+        });
+
+        // report the first malformed face
+        for (VAR i = 0_z; i < chunk_count; ++i)
+        {
+            VAR line = chunks[i].malformed_line;
+            if (invalid_corners[i] != SIZE_MAX)
+            {
+                ax::obj_chunk scratch;
+                VAL corner_line = ax::parse_obj_chunk(chunk_starts[i], chunk_starts[i + 1_z], scratch, invalid_corners[i]);
+                line = line < 0 ? corner_line : std::min(line, corner_line);
+            }
+            if (line < 0) continue;
+            clear_geometry();
+            VAL preceding_lines = std::count(data, chunk_starts[i], '\n');
+            return ax::some("Malformed face on line "_s + std::to_string(preceding_lines + line + 1) + " of model file '" + file_path + "'.");
+        }
+
+        // weld, letting the attribute lists go with the chunks
+        chunks.clear();
+        weld(positions, uvs, normals, corners);
+        return ax::none<std::string>();
+    }
+
+    std::string basic_model::get_binary_path(const char* obj_file_path)
+    {
+        std::string binary_path(obj_file_path);
+        VAL dot = binary_path.find_last_of('.');
+        VAL slash = binary_path.find_last_of("/\\");
+        if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) binary_path.resize(dot);
+        return binary_path + ".axmesh";
+    }
+
+    ax::option<std::string> basic_model::try_read_from_obj_cached(const char* file_path)
+    {
+        return try_read_from_obj_cached(file_path, ax::worker_pool::get_default());
+    }
+
+    ax::option<std::string> basic_model::try_read_from_obj_cached(const char* file_path, ax::worker_pool& pool)
+    {
+        // load the surface's maps while reading the geometry
+        clear();
+        VAR surface_load = surface.read_from_obj_async(file_path, pool);
+
+        // use the cache when it was made from the obj as it is now
+        uint64_t source_size = 0ull;
+        int64_t source_time = 0ll;
+        VAL stamped = ax::try_get_model_source_stamp(file_path, source_size, source_time);
+        VAL& binary_path = get_binary_path(file_path);
+        VAL& cache_error_opt = stamped ? try_read_from_binary(binary_path.c_str(), source_size, source_time) : ax::some("Can't stamp "_s + file_path + ".");
+        if (!cache_error_opt) return surface_load.wait();
+
+        // otherwise read the obj, then try to (re)write the cache, writing to a temporary unique
+        // to this process and thread first so that concurrent loaders never see a partial cache
+        VAL& error_opt = try_read_geometry_from_obj(file_path, pool);
+        if (error_opt)
+        {
+            surface_load.wait();
+            surface.clear();
+            return error_opt;
+        }
+        if (stamped)
+        {
+            VAL& temporary_path = binary_path + "." + std::to_string(ax::get_process_id()) + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+            if (!try_write_to_binary(temporary_path.c_str(), source_size, source_time) && std::rename(temporary_path.c_str(), binary_path.c_str()) != 0)
+            {
+                // some platforms won't rename over an existing file
+                std::remove(binary_path.c_str());
+                std::rename(temporary_path.c_str(), binary_path.c_str());
             }
-            surface.read_from_obj(file_path);
-            return ax::none<std::string>();
+            std::remove(temporary_path.c_str());
+        }
+        return surface_load.wait();
+    }
+
+    ax::option<std::string> basic_model::try_read_from_binary(const char* file_path)
+    {
+        surface.clear();
+        return try_read_from_binary(file_path, 0ull, 0ll);
+    }
+
+    ax::option<std::string> basic_model::try_read_from_binary(const char* file_path, uint64_t source_size, int64_t source_time)
+    {
+        // map the file
+        clear_geometry();
+        ax::mapped_file file;
+        if (file.try_open(file_path)) return ax::some("Invalid binary model file '"_s + file_path + "'.");
+        VAL data = file.get_data();
+        VAL size = static_cast<uint64_t>(file.get_size());
+
+        // validate header
+        model_binary_header header;
+        if (size < sizeof(header)) return ax::some("Binary model file '"_s + file_path + "' is truncated.");
+        std::memcpy(&header, data, sizeof(header));
+        if (std::memcmp(header.magic, ax::model_binary_magic, sizeof(header.magic)) != 0) return ax::some("File '"_s + file_path + "' isn't a binary model.");
+        if (header.version != ax::model_binary_version || header.header_size != sizeof(header) || header.vertex_size != sizeof(ax::basic_vertex))
+            return ax::some("Binary model file '"_s + file_path + "' has an unsupported version.");
+        if (source_size != 0ull && (header.source_size != source_size || header.source_time != source_time))
+            return ax::some("Binary model file '"_s + file_path + "' is stale.");
+
+        // validate arrays
+        const uint64_t element_sizes[] = { sizeof(ax::basic_vertex), sizeof(uint32_t) };
+        for (VAR k = 0; k < 2; ++k)
+        {
+            VAL count = header.counts[k];
+            VAL offset = header.offsets[k];
+            if (offset % ax::model_binary_alignment != 0ull || offset > size || count > (size - offset) / element_sizes[k])
+                return ax::some("Binary model file '"_s + file_path + "' is corrupt.");
         }
-        return ax::some("Invalid model file '"_s + file_path + "'.");
+        if (header.counts[1] % 3ull != 0ull) return ax::some("Binary model file '"_s + file_path + "' is corrupt.");
+
+        // copy each array out in bulk
+        VAL copy_array = [&](VAR& target, int k)
+        {
+            target.resize(static_cast<std::size_t>(header.counts[k]));
+            if (!target.empty()) std::memcpy(target.data(), data + header.offsets[k], target.size() * sizeof(target[0]));
+        };
+        copy_array(vertices, 0);
+        copy_array(indices, 1);
+
+        // ensure indices are in range
+        VAL vertex_count = static_cast<uint32_t>(vertices.size());
+        if (std::any_of(indices.begin(), indices.end(), [vertex_count](uint32_t index) { return index >= vertex_count; }))
+        {
+            clear_geometry();
+            return ax::some("Binary model file '"_s + file_path + "' is corrupt.");
+        }
+        geometry_version = ax::get_next_geometry_version();
+        return ax::none<std::string>();
+    }
+
+    ax::option<std::string> basic_model::try_write_to_binary(const char* file_path) const
+    {
+        return try_write_to_binary(file_path, 0ull, 0ll);
+    }
+
+    ax::option<std::string> basic_model::try_write_to_binary(const char* file_path, uint64_t source_size, int64_t source_time) const
+    {
+        // open file for writing
+        std::ofstream out;
+        out.open(file_path, std::ios::binary);
+        if (!out.is_open()) return ax::some("Can't open binary model file "_s + file_path + " for saving an ax::basic_model.");
+
+        // lay out the header and arrays
+        model_binary_header header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, ax::model_binary_magic, sizeof(header.magic));
+        header.version = ax::model_binary_version;
+        header.header_size = sizeof(header);
+        header.vertex_size = sizeof(ax::basic_vertex);
+        header.source_size = source_size;
+        header.source_time = source_time;
+        const char* arrays[] = { reinterpret_cast<const char*>(vertices.data()), reinterpret_cast<const char*>(indices.data()) };
+        const uint64_t array_sizes[] = { vertices.size() * sizeof(ax::basic_vertex), indices.size() * sizeof(uint32_t) };
+        const uint64_t counts[] = { vertices.size(), indices.size() };
+        VAR offset = static_cast<uint64_t>(sizeof(header));
+        for (VAR k = 0; k < 2; ++k)
+        {
+            offset = (offset + ax::model_binary_alignment - 1ull) / ax::model_binary_alignment * ax::model_binary_alignment;
+            header.counts[k] = counts[k];
+            header.offsets[k] = offset;
+            offset += array_sizes[k];
+        }
+
+        // write header and arrays, padding between them
+        const char padding[ax::model_binary_alignment] = {};
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        VAR position = static_cast<uint64_t>(sizeof(header));
+        for (VAR k = 0; k < 2; ++k)
+        {
+            out.write(padding, static_cast<std::streamsize>(header.offsets[k] - position));
+            out.write(arrays[k], static_cast<std::streamsize>(array_sizes[k]));
+            position = header.offsets[k] + array_sizes[k];
+        }
+        if (!out.good()) return ax::some("Failed to write ax::basic_model to "_s + file_path + ".");
+        return ax::none<std::string>();
+    }
+
+    void basic_model::weld(const std::vector<ax::v3>& positions, const std::vector<ax::v2>& uvs, const std::vector<ax::v3>& normals, const std::vector<ax::v3i>& corners)
+    {
+        // add a vertex for each distinct source, indexing it from each corner that uses it
+        std::unordered_map<ax::v3i, uint32_t, ax::vertex_source_hash> welds;
+        welds.reserve(corners.size() / 2_z);
+        indices.reserve(corners.size());
+        for (VAL& corner : corners)
+        {
+            VAL& inserted = welds.emplace(corner, static_cast<uint32_t>(vertices.size()));
+            if (inserted.second)
+            {
+                // look up the attributes, defaulting any that are missing
+                ax::basic_vertex vertex;
+                VAL in_positions = corner.x >= 0 && ax::itoz(corner.x) < positions.size();
+                VAL in_normals = corner.z >= 0 && ax::itoz(corner.z) < normals.size();
+                VAL in_uvs = corner.y >= 0 && ax::itoz(corner.y) < uvs.size();
+                vertex.position = in_positions ? positions[ax::itoz(corner.x)] : ax::zero<ax::v3>();
+                vertex.normal = in_normals ? ax::v3(normals[ax::itoz(corner.z)]).NormalizeSafe() : ax::zero<ax::v3>();
+                vertex.uv = in_uvs ? uvs[ax::itoz(corner.y)] : ax::zero<ax::v2>();
+                vertices.push_back(vertex);
+            }
+            indices.push_back(inserted.first->second);
+        }
+        geometry_version = ax::get_next_geometry_version();
+    }
+
+    void basic_model::set_geometry(const std::vector<ax::v3>& positions, const std::vector<ax::v2>& uvs, const std::vector<ax::v3>& normals, const std::vector<ax::v3i>& corners)
+    {
+        clear_geometry();
+        weld(positions, uvs, normals, corners);
+    }
+
+    void basic_model::optimize_order(bool spatial_sort)
+    {
+        // reorder faces, spatially sorted ones in clusters small enough to keep the sort
+        constexpr VAR spatial_cluster_face_count = 512_z;
+        std::vector<uint32_t> reordered_indices(indices);
+        if (spatial_sort) ax::sort_faces_spatially(vertices, reordered_indices);
+        ax::optimize_face_order(reordered_indices, vertices.size(), 16, spatial_sort ? spatial_cluster_face_count : 0_z);
+
+        // reorder vertices by first use
+        VAL& order = ax::get_first_use_order(reordered_indices, vertices.size());
+        std::vector<ax::basic_vertex> reordered_vertices(vertices.size());
+        for (VAR i = 0_z; i < vertices.size(); ++i) reordered_vertices[order[i]] = vertices[i];
+        for (VAR& index : reordered_indices) index = order[index];
+        vertices = std::move(reordered_vertices);
+        indices = std::move(reordered_indices);
+        geometry_version = ax::get_next_geometry_version();
     }
 
     void basic_model::clear()
     {
-        faces.clear();
-        positions.clear();
-        uvs.clear();
-        normals.clear();
+        clear_geometry();
         surface.clear();
     }
+
+    void basic_model::clear_geometry()
+    {
+        vertices.clear();
+        indices.clear();
+        geometry_version = ax::get_next_geometry_version();
+    }
 }
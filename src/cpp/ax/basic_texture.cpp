@@ -0,0 +1,361 @@
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+#include "ax/basic_texture.hpp"
+
+#include "ax/string.hpp"
+
+namespace ax
+{
+    // Address a coordinate into [0, 1], selecting rather than branching on the address mode.
+    static inline float get_addressed(float coordinate, ax::texture_address address)
+    {
+        VAL wrapped = coordinate - std::floor(coordinate);
+        VAL clamped = std::min(std::max(coordinate, 0.0f), 1.0f);
+        return address == ax::texture_clamp ? clamped : wrapped;
+    }
+
+    // Compute the storage length of a level, which is always made of whole tiles.
+    static inline std::size_t get_level_length(const ax::texture_level& level)
+    {
+        VAL tiles_y = (level.height + ax::basic_texture::tile_size - 1) / ax::basic_texture::tile_size;
+        return ax::itoz(level.tiles_x * tiles_y * ax::basic_texture::tile_size * ax::basic_texture::tile_size);
+    }
+
+    static inline ax::texture_level make_texture_level(int width, int height, std::size_t offset)
+    {
+        return { width, height, (width + ax::basic_texture::tile_size - 1) / ax::basic_texture::tile_size, offset };
+    }
+
+    static inline float get_lerped(float a, float b, float t)
+    {
+        return a + (b - a) * t;
+    }
+
+    basic_texture::basic_texture() :
+        colors(),
+        values(),
+        normals(),
+        levels({ ax::make_texture_level(0, 0, 0_z) }),
+        format(ax::texture_rgba8),
+        address(ax::texture_wrap),
+        width(0),
+        height(0)
+    { }
+
+    basic_texture::basic_texture(const ax::basic_buffer& buffer, ax::texture_format format, ax::texture_address address) :
+        colors(),
+        values(),
+        normals(),
+        levels({ ax::make_texture_level(buffer.get_width(), buffer.get_height(), 0_z) }),
+        format(format),
+        address(address),
+        width(buffer.get_width()),
+        height(buffer.get_height())
+    {
+        // allocate the base level
+        VAL length = ax::get_level_length(levels[0]);
+        switch (format)
+        {
+            case ax::texture_rgba8: colors.resize(length); break;
+            case ax::texture_r8: values.resize(length); break;
+            case ax::texture_normal: normals.resize(length); break;
+        }
+
+        // swizzle texels into place, decoding them for the format
+        for (VAR j = 0; j < height; ++j)
+        {
+            for (VAR i = 0; i < width; ++i)
+            {
+                VAL& color = buffer.get_pixel(i, j).color;
+                VAL index = get_index(i, j);
+                switch (format)
+                {
+                    case ax::texture_rgba8: colors[index] = color; break;
+                    case ax::texture_r8: values[index] = color.r; break;
+                    case ax::texture_normal:
+                    {
+                        ax::v3 normal;
+                        for (VAR k = 0; k < 3; ++k) normal[2 - k] = static_cast<float>(color[k]) / 255.f * 2.0f - 1.0f;
+                        normals[index] = normal;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    int basic_texture::get_bytes_per_texel() const
+    {
+        switch (format)
+        {
+            case ax::texture_rgba8: return static_cast<int>(sizeof(ax::color));
+            case ax::texture_r8: return static_cast<int>(sizeof(uint8_t));
+            case ax::texture_normal: return static_cast<int>(sizeof(ax::v3));
+        }
+        return 0;
+    }
+
+    void basic_texture::generate_mips()
+    {
+        generate_mips(ax::worker_pool::get_default());
+    }
+
+    void basic_texture::generate_mips(ax::worker_pool& pool)
+    {
+        // compute the chain's levels, halving down to 1x1
+        VAL base = levels[0];
+        levels.clear();
+        levels.push_back(base);
+        if (width < 1 || height < 1) return;
+        while (levels.back().width > 1 || levels.back().height > 1)
+        {
+            VAL& last = levels.back();
+            levels.push_back(ax::make_texture_level(std::max(1, last.width / 2), std::max(1, last.height / 2), last.offset + ax::get_level_length(last)));
+        }
+
+        // allocate the chain
+        VAL& smallest = levels.back();
+        VAL length = smallest.offset + ax::get_level_length(smallest);
+        switch (format)
+        {
+            case ax::texture_rgba8: colors.resize(length); break;
+            case ax::texture_r8: values.resize(length); break;
+            case ax::texture_normal: normals.resize(length); break;
+        }
+
+        // generate each level from the one above it, spreading bands of rows of big levels
+        // over the pool
+        constexpr VAR band_height = 32;
+        constexpr VAR parallel_texels = 128 * 128;
+        for (VAR k = 1_z; k < levels.size(); ++k)
+        {
+            VAL& source = levels[k - 1_z];
+            VAL& target = levels[k];
+            if (target.width * target.height < parallel_texels)
+            {
+                generate_level(source, target, 0, target.height);
+                continue;
+            }
+            VAL band_count = (target.height + band_height - 1) / band_height;
+            pool.parallel_for(ax::itoz(band_count), [&](std::size_t band)
+            {
+                VAL row_start = ax::ztoi(band) * band_height;
+                generate_level(source, target, row_start, std::min(row_start + band_height, target.height));
+            });
+        }
+    }
+
+    void basic_texture::generate_level(const ax::texture_level& source, const ax::texture_level& target, int row_start, int row_end)
+    {
+        for (VAR j = row_start; j < row_end; ++j)
+        {
+            // find the source rows, repeating the last of an odd height
+            VAL y_0 = std::min(j * 2, source.height - 1);
+            VAL y_1 = std::min(j * 2 + 1, source.height - 1);
+            for (VAR i = 0; i < target.width; ++i)
+            {
+                // find the source texels
+                VAL x_0 = std::min(i * 2, source.width - 1);
+                VAL x_1 = std::min(i * 2 + 1, source.width - 1);
+                const std::size_t indices[] = { get_index(source, x_0, y_0), get_index(source, x_1, y_0), get_index(source, x_0, y_1), get_index(source, x_1, y_1) };
+                VAL index = get_index(target, i, j);
+
+                // average them
+                switch (format)
+                {
+                    case ax::texture_rgba8:
+                    {
+                        ax::color color;
+                        for (VAR c = 0; c < 4; ++c)
+                        {
+                            VAL sum = colors[indices[0]][c] + colors[indices[1]][c] + colors[indices[2]][c] + colors[indices[3]][c];
+                            color[c] = static_cast<uint8_t>((sum + 2) / 4);
+                        }
+                        colors[index] = color;
+                        break;
+                    }
+                    case ax::texture_r8:
+                    {
+                        VAL sum = values[indices[0]] + values[indices[1]] + values[indices[2]] + values[indices[3]];
+                        values[index] = static_cast<uint8_t>((sum + 2) / 4);
+                        break;
+                    }
+                    case ax::texture_normal:
+                    {
+                        VAL normal = (normals[indices[0]] + normals[indices[1]] + normals[indices[2]] + normals[indices[3]]) * 0.25f;
+                        normals[index] = ax::v3(normal).NormalizeSafe();
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    float basic_texture::get_lod(const ax::v2& uv_dx, const ax::v2& uv_dy) const
+    {
+        // compute the longer texel-space footprint of a pixel
+        VAL extent_x = static_cast<float>(width);
+        VAL extent_y = static_cast<float>(height);
+        VAL texels_dx = ax::v2(uv_dx.x * extent_x, uv_dx.y * extent_y);
+        VAL texels_dy = ax::v2(uv_dy.x * extent_x, uv_dy.y * extent_y);
+        VAL footprint_squared = std::max(texels_dx.x * texels_dx.x + texels_dx.y * texels_dx.y, texels_dy.x * texels_dy.x + texels_dy.y * texels_dy.y);
+
+        // convert to a level, halving the log to take the square root for free
+        if (!(footprint_squared > 1.0f)) return 0.0f;
+        return std::min(0.5f * std::log2(footprint_squared), static_cast<float>(get_level_count() - 1));
+    }
+
+    std::size_t basic_texture::get_index(const ax::v2& position) const
+    {
+        // compute addressed texel coordinates, clamping away rounding up to the far edge
+        VAL u = ax::get_addressed(position.x, address);
+        VAL v = ax::get_addressed(position.y, address);
+        VAL x = std::min(static_cast<int>(u * static_cast<float>(width)), width - 1);
+        VAL y = std::min(static_cast<int>(v * static_cast<float>(height)), height - 1);
+        return get_index(x, y);
+    }
+
+    basic_texture::bilinear_taps basic_texture::get_taps(const ax::texture_level& level, const ax::v2& position) const
+    {
+        // find the texel centers surrounding the position
+        VAL s = ax::get_addressed(position.x, address) * static_cast<float>(level.width) - 0.5f;
+        VAL t = ax::get_addressed(position.y, address) * static_cast<float>(level.height) - 0.5f;
+        VAL s_floor = std::floor(s);
+        VAL t_floor = std::floor(t);
+        VAL x_0 = static_cast<int>(s_floor);
+        VAL y_0 = static_cast<int>(t_floor);
+
+        // address the neighbors, which only ever fall a single texel outside of the level
+        VAL wrapping = address == ax::texture_wrap;
+        VAL x_low = x_0 < 0 ? (wrapping ? level.width - 1 : 0) : x_0;
+        VAL y_low = y_0 < 0 ? (wrapping ? level.height - 1 : 0) : y_0;
+        VAL x_high = x_0 + 1 >= level.width ? (wrapping ? 0 : level.width - 1) : x_0 + 1;
+        VAL y_high = y_0 + 1 >= level.height ? (wrapping ? 0 : level.height - 1) : y_0 + 1;
+        bilinear_taps taps;
+        taps.indices[0] = get_index(level, x_low, y_low);
+        taps.indices[1] = get_index(level, x_high, y_low);
+        taps.indices[2] = get_index(level, x_low, y_high);
+        taps.indices[3] = get_index(level, x_high, y_high);
+        taps.weight_x = s - s_floor;
+        taps.weight_y = t - t_floor;
+        return taps;
+    }
+
+    ax::color basic_texture::sample_diffuse(const ax::v2& position) const
+    {
+        if (colors.empty()) return ax::color(255, 0, 0, 255);
+        return colors[get_index(position)];
+    }
+
+    ax::v3 basic_texture::sample_tangent(const ax::v2& position) const
+    {
+        if (normals.empty()) return ax::v3(0.0f, 0.0f, -1.0f); // as basic_buffer gives for a missing map
+        return normals[get_index(position)];
+    }
+
+    float basic_texture::sample_specular(const ax::v2& position) const
+    {
+        if (values.empty()) return 1.0f;
+        return static_cast<float>(values[get_index(position)]) / 255.0f;
+    }
+
+    ax::color basic_texture::sample_diffuse(const ax::v2& position, float lod) const
+    {
+        // magnify with the nearest texel
+        if (colors.empty() || lod <= 0.0f) return sample_diffuse(position);
+
+        // minify by blending the nearest levels
+        VAL level = std::min(static_cast<int>(lod), get_level_count() - 1);
+        VAL level_next = std::min(level + 1, get_level_count() - 1);
+        VAL fraction = lod - static_cast<float>(level);
+        VAL& taps = get_taps(levels[ax::itoz(level)], position);
+        VAL& taps_next = get_taps(levels[ax::itoz(level_next)], position);
+        ax::color color;
+        for (VAR c = 0; c < 4; ++c)
+        {
+            VAL sample = get_lerped(
+                get_lerped(colors[taps.indices[0]][c], colors[taps.indices[1]][c], taps.weight_x),
+                get_lerped(colors[taps.indices[2]][c], colors[taps.indices[3]][c], taps.weight_x),
+                taps.weight_y);
+            VAL sample_next = get_lerped(
+                get_lerped(colors[taps_next.indices[0]][c], colors[taps_next.indices[1]][c], taps_next.weight_x),
+                get_lerped(colors[taps_next.indices[2]][c], colors[taps_next.indices[3]][c], taps_next.weight_x),
+                taps_next.weight_y);
+            color[c] = static_cast<uint8_t>(get_lerped(sample, sample_next, fraction) + 0.5f);
+        }
+        return color;
+    }
+
+    ax::v3 basic_texture::sample_tangent(const ax::v2& position, float lod) const
+    {
+        // magnify with the nearest texel
+        if (normals.empty() || lod <= 0.0f) return sample_tangent(position);
+
+        // minify by blending the nearest levels
+        VAL level = std::min(static_cast<int>(lod), get_level_count() - 1);
+        VAL level_next = std::min(level + 1, get_level_count() - 1);
+        VAL fraction = lod - static_cast<float>(level);
+        VAL& taps = get_taps(levels[ax::itoz(level)], position);
+        VAL& taps_next = get_taps(levels[ax::itoz(level_next)], position);
+        ax::v3 normal;
+        for (VAR c = 0; c < 3; ++c)
+        {
+            VAL sample = get_lerped(
+                get_lerped(normals[taps.indices[0]][c], normals[taps.indices[1]][c], taps.weight_x),
+                get_lerped(normals[taps.indices[2]][c], normals[taps.indices[3]][c], taps.weight_x),
+                taps.weight_y);
+            VAL sample_next = get_lerped(
+                get_lerped(normals[taps_next.indices[0]][c], normals[taps_next.indices[1]][c], taps_next.weight_x),
+                get_lerped(normals[taps_next.indices[2]][c], normals[taps_next.indices[3]][c], taps_next.weight_x),
+                taps_next.weight_y);
+            normal[c] = get_lerped(sample, sample_next, fraction);
+        }
+        return normal;
+    }
+
+    float basic_texture::sample_specular(const ax::v2& position, float lod) const
+    {
+        // magnify with the nearest texel
+        if (values.empty() || lod <= 0.0f) return sample_specular(position);
+
+        // minify by blending the nearest levels
+        VAL level = std::min(static_cast<int>(lod), get_level_count() - 1);
+        VAL level_next = std::min(level + 1, get_level_count() - 1);
+        VAL fraction = lod - static_cast<float>(level);
+        VAL& taps = get_taps(levels[ax::itoz(level)], position);
+        VAL& taps_next = get_taps(levels[ax::itoz(level_next)], position);
+        VAL sample = get_lerped(
+            get_lerped(values[taps.indices[0]], values[taps.indices[1]], taps.weight_x),
+            get_lerped(values[taps.indices[2]], values[taps.indices[3]], taps.weight_x),
+            taps.weight_y);
+        VAL sample_next = get_lerped(
+            get_lerped(values[taps_next.indices[0]], values[taps_next.indices[1]], taps_next.weight_x),
+            get_lerped(values[taps_next.indices[2]], values[taps_next.indices[3]], taps_next.weight_x),
+            taps_next.weight_y);
+        return get_lerped(sample, sample_next, fraction) / 255.0f;
+    }
+
+    ax::option<std::string> basic_texture::try_read_from_tga(const char* file_path, ax::texture_format format, ax::texture_address address)
+    {
+        // read through a temporary buffer
+        ax::basic_buffer buffer;
+        VAL& error_opt = buffer.try_read_from_tga(file_path);
+        if (error_opt) return error_opt;
+
+        // convert
+        *this = ax::basic_texture(buffer, format, address);
+        return ax::none<std::string>();
+    }
+
+    void basic_texture::clear()
+    {
+        colors.clear();
+        values.clear();
+        normals.clear();
+        levels.assign(1_z, ax::make_texture_level(0, 0, 0_z));
+        width = 0;
+        height = 0;
+    }
+}
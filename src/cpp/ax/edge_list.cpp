@@ -0,0 +1,75 @@
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+#include "ax/edge_list.hpp"
+
+namespace ax
+{
+    edge_list::edge_list() :
+        edges(),
+        model_geometry_version(0ull)
+    { }
+
+    bool edge_list::get_current(const ax::basic_model& model) const
+    {
+        return model_geometry_version == model.get_geometry_version();
+    }
+
+    const std::vector<std::pair<uint32_t, uint32_t>>& edge_list::update(const ax::basic_model& model)
+    {
+        // an edge keyed by its ordered endpoint positions
+        struct keyed_edge
+        {
+            uint64_t key;
+            uint32_t vertex_a;
+            uint32_t vertex_b;
+        };
+
+        // key each vertex by its position, numbering the distinct positions in sorted order
+        if (get_current(model)) return edges;
+        VAL& vertices = model.get_vertices();
+        VAL& indices = model.get_indices();
+        VAL position_less = [&](uint32_t a, uint32_t b) { return std::memcmp(&vertices[a].position.x, &vertices[b].position.x, sizeof(float) * 3_z) < 0; };
+        std::vector<uint32_t> by_position(vertices.size());
+        std::iota(by_position.begin(), by_position.end(), 0u);
+        std::sort(by_position.begin(), by_position.end(), position_less);
+        std::vector<uint64_t> position_keys(vertices.size());
+        VAR key = 0ull;
+        for (VAR i = 0_z; i < by_position.size(); ++i)
+        {
+            if (i > 0_z && position_less(by_position[i - 1_z], by_position[i])) ++key;
+            position_keys[by_position[i]] = key;
+        }
+
+        // collect the edges of every face, then sort and drop duplicates
+        std::vector<keyed_edge> keyed;
+        keyed.reserve(indices.size());
+        for (VAR i = 0_z; i + 2_z < indices.size(); i += 3_z)
+        {
+            for (VAR k = 0_z; k < 3_z; ++k)
+            {
+                VAL vertex_a = indices[i + k];
+                VAL vertex_b = indices[i + (k + 1_z) % 3_z];
+                VAL key_a = position_keys[vertex_a];
+                VAL key_b = position_keys[vertex_b];
+                if (key_a == key_b) continue;
+                keyed.push_back({ std::min(key_a, key_b) << 32 | std::max(key_a, key_b), vertex_a, vertex_b });
+            }
+        }
+        std::sort(keyed.begin(), keyed.end(), [](const keyed_edge& a, const keyed_edge& b) { return a.key < b.key; });
+        VAL end = std::unique(keyed.begin(), keyed.end(), [](const keyed_edge& a, const keyed_edge& b) { return a.key == b.key; });
+
+        // keep the unique edges' vertices
+        edges.clear();
+        edges.reserve(static_cast<std::size_t>(end - keyed.begin()));
+        for (VAR it = keyed.begin(); it != end; ++it) edges.emplace_back(it->vertex_a, it->vertex_b);
+        model_geometry_version = model.get_geometry_version();
+        return edges;
+    }
+
+    void edge_list::invalidate()
+    {
+        model_geometry_version = 0ull;
+    }
+}
@@ -0,0 +1,116 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "ax/frame_pipeline.hpp"
+
+#include "ax/string.hpp"
+
+namespace ax
+{
+    frame_pipeline::frame_pipeline(int width, int height, std::size_t buffer_count) :
+        width(width),
+        height(height),
+        buffers(),
+        queue(),
+        next(0_z),
+        in_flight(0_z),
+        acquired(false),
+        stopping(false),
+        error_opt(),
+        mutex(),
+        condition(),
+        writer_thread()
+    {
+        buffer_count = std::max(2_z, buffer_count);
+        buffers.reserve(buffer_count);
+        for (VAR i = 0_z; i < buffer_count; ++i) buffers.push_back(std::make_unique<ax::basic_buffer>(width, height));
+        writer_thread = std::thread([this]() { run(); });
+    }
+
+    frame_pipeline::~frame_pipeline()
+    {
+        // write what's queued, dropping any error, then stop the writer
+        flush();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        condition.notify_all();
+        writer_thread.join();
+    }
+
+    ax::basic_buffer& frame_pipeline::acquire()
+    {
+        // since frames are written in ring order, the next buffer is free once fewer than all
+        // buffers are in flight, and it stays acquired until submitted
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [this]() { return acquired || in_flight < buffers.size(); });
+        acquired = true;
+        return *buffers[next];
+    }
+
+    void frame_pipeline::submit(const std::string& file_path)
+    {
+        submit([file_path](const ax::basic_buffer& buffer) { return buffer.try_write_to_tga(file_path.c_str()); });
+    }
+
+    void frame_pipeline::submit(ax::frame_pipeline::frame_writer writer)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!acquired) throw std::logic_error("Cannot submit a frame to an ax::frame_pipeline without first acquiring its buffer.");
+            queue.emplace_back(next, std::move(writer));
+            next = (next + 1_z) % buffers.size();
+            ++in_flight;
+            acquired = false;
+        }
+        condition.notify_all();
+    }
+
+    ax::option<std::string> frame_pipeline::flush()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [this]() { return in_flight == 0_z; });
+        VAL result = error_opt;
+        error_opt = ax::none<std::string>();
+        return result;
+    }
+
+    void frame_pipeline::run()
+    {
+        while (true)
+        {
+            // take the oldest frame
+            std::pair<std::size_t, ax::frame_pipeline::frame_writer> frame;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                condition.wait(lock, [this]() { return stopping || !queue.empty(); });
+                if (stopping && queue.empty()) return;
+                frame = std::move(queue.front());
+                queue.pop_front();
+            }
+
+            // write it unlocked, reporting a throwing writer like a failing one, then free its
+            // buffer
+            ax::option<std::string> write_error_opt;
+            try
+            {
+                write_error_opt = frame.second(*buffers[frame.first]);
+            }
+            catch (const std::exception& exn)
+            {
+                write_error_opt = ax::some("Frame writer threw: "_s + exn.what());
+            }
+            catch (...)
+            {
+                write_error_opt = ax::some("Frame writer threw a non-standard exception."_s);
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (write_error_opt && !error_opt) error_opt = write_error_opt;
+                --in_flight;
+            }
+            condition.notify_all();
+        }
+    }
+}
@@ -0,0 +1,117 @@
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+#include "ax/hierarchical_depth.hpp"
+
+namespace ax
+{
+    hierarchical_depth::hierarchical_depth() : hierarchical_depth(0, 0) { }
+
+    hierarchical_depth::hierarchical_depth(int pixel_width, int pixel_height) :
+        mins(),
+        maxes(),
+        stales(),
+        pixel_width(pixel_width),
+        pixel_height(pixel_height),
+        width((pixel_width + block_size - 1) / block_size),
+        height((pixel_height + block_size - 1) / block_size)
+    {
+        VAL length = ax::itoz(width * height);
+        mins.resize(length, std::numeric_limits<float>::lowest());
+        maxes.resize(length, std::numeric_limits<float>::lowest());
+        stales.resize(length, 0);
+    }
+
+    void hierarchical_depth::fill(float depth)
+    {
+        std::fill(mins.begin(), mins.end(), depth);
+        std::fill(maxes.begin(), maxes.end(), depth);
+        std::fill(stales.begin(), stales.end(), static_cast<uint8_t>(0));
+    }
+
+    void hierarchical_depth::rebuild(const ax::basic_buffer& buffer)
+    {
+        validate(buffer);
+        for (VAR y = 0; y < height; ++y)
+            for (VAR x = 0; x < width; ++x)
+                refresh(x, y, [&](int i, int j) { return buffer.get_pixel(i, j).depth; });
+    }
+
+    void hierarchical_depth::rebuild(const ax::planar_buffer& buffer)
+    {
+        validate(buffer);
+        VAL depths = buffer.get_depth_plane();
+        for (VAR y = 0; y < height; ++y)
+            for (VAR x = 0; x < width; ++x)
+                refresh(x, y, [&](int i, int j) { return depths[i + j * pixel_width]; });
+    }
+
+    bool hierarchical_depth::get_visible(int x, int y, float depth_nearest, const ax::basic_buffer& buffer)
+    {
+        validate(buffer);
+        VAL index = ax::itoz(x + y * width);
+        if (depth_nearest >= mins[index]) return true;
+        if (!stales[index]) return false;
+        refresh(x, y, [&](int i, int j) { return buffer.get_pixel(i, j).depth; });
+        return depth_nearest >= mins[index];
+    }
+
+    bool hierarchical_depth::get_visible(int x, int y, float depth_nearest, const ax::planar_buffer& buffer)
+    {
+        validate(buffer);
+        VAL index = ax::itoz(x + y * width);
+        if (depth_nearest >= mins[index]) return true;
+        if (!stales[index]) return false;
+        VAL depths = buffer.get_depth_plane();
+        refresh(x, y, [&](int i, int j) { return depths[i + j * pixel_width]; });
+        return depth_nearest >= mins[index];
+    }
+
+    // Raise the block's max right away but only mark its min stale, since a stale min is still a
+    // conservative lower bound and is refreshed only when a test against it would fail.
+    void hierarchical_depth::note_written(int x, int y, float depth_max)
+    {
+        VAL index = ax::itoz(x + y * width);
+        maxes[index] = std::max(maxes[index], depth_max);
+        stales[index] = 1;
+    }
+
+    void hierarchical_depth::validate(const ax::basic_buffer& buffer) const
+    {
+        if (buffer.get_width() != pixel_width || buffer.get_height() != pixel_height) throw std::invalid_argument("ax::hierarchical_depth size doesn't match its buffer.");
+    }
+
+    void hierarchical_depth::validate(const ax::planar_buffer& buffer) const
+    {
+        if (buffer.get_width() != pixel_width || buffer.get_height() != pixel_height) throw std::invalid_argument("ax::hierarchical_depth size doesn't match its buffer.");
+        if (!buffer.has_planes(ax::plane_depth)) throw std::invalid_argument("ax::hierarchical_depth buffer has no depth plane.");
+    }
+
+    template<typename Fn>
+    void hierarchical_depth::refresh(int x, int y, Fn get_depth)
+    {
+        // compute the block's exact min and max
+        VAL left = x * block_size;
+        VAL bottom = y * block_size;
+        VAL right = std::min(left + block_size, pixel_width);
+        VAL top = std::min(bottom + block_size, pixel_height);
+        VAR depth_min = std::numeric_limits<float>::max();
+        VAR depth_max = std::numeric_limits<float>::lowest();
+        for (VAR j = bottom; j < top; ++j)
+        {
+            for (VAR i = left; i < right; ++i)
+            {
+                VAL depth = get_depth(i, j);
+                depth_min = std::min(depth_min, depth);
+                depth_max = std::max(depth_max, depth);
+            }
+        }
+
+        // update block
+        VAL index = ax::itoz(x + y * width);
+        mins[index] = depth_min;
+        maxes[index] = depth_max;
+        stales[index] = 0;
+    }
+}
@@ -0,0 +1,133 @@
+#include <utility>
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#include "ax/mapped_file.hpp"
+
+#include "ax/string.hpp"
+
+namespace ax
+{
+    mapped_file::mapped_file() :
+        data(nullptr),
+        size(0_z),
+        open(false)
+#if defined(_WIN32)
+        , file_handle(nullptr),
+        mapping_handle(nullptr)
+#endif
+    { }
+
+    mapped_file::~mapped_file()
+    {
+        close();
+    }
+
+    mapped_file::mapped_file(mapped_file&& that) : mapped_file()
+    {
+        *this = std::move(that);
+    }
+
+    mapped_file& mapped_file::operator=(mapped_file&& that)
+    {
+        if (this != &that)
+        {
+            close();
+            std::swap(data, that.data);
+            std::swap(size, that.size);
+            std::swap(open, that.open);
+#if defined(_WIN32)
+            std::swap(file_handle, that.file_handle);
+            std::swap(mapping_handle, that.mapping_handle);
+#endif
+        }
+        return *this;
+    }
+
+    ax::option<std::string> mapped_file::try_open(const char* file_path)
+    {
+        close();
+
+#if defined(_WIN32)
+        // open file
+        VAL file = CreateFileA(file_path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return ax::some("Can't open file "_s + file_path + " for mapping.");
+        LARGE_INTEGER file_size;
+        if (!GetFileSizeEx(file, &file_size))
+        {
+            CloseHandle(file);
+            return ax::some("Can't get the size of file "_s + file_path + ".");
+        }
+
+        // map it, leaving empty files unmapped since they can't be
+        if (file_size.QuadPart > 0)
+        {
+            VAL mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            VAL view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+            if (!view)
+            {
+                if (mapping) CloseHandle(mapping);
+                CloseHandle(file);
+                return ax::some("Can't map file "_s + file_path + ".");
+            }
+            mapping_handle = mapping;
+            data = static_cast<const char*>(view);
+        }
+        file_handle = file;
+        size = static_cast<std::size_t>(file_size.QuadPart);
+#else
+        // open file
+        VAL file = ::open(file_path, O_RDONLY);
+        if (file < 0) return ax::some("Can't open file "_s + file_path + " for mapping.");
+        struct stat file_stat;
+        if (fstat(file, &file_stat) != 0)
+        {
+            ::close(file);
+            return ax::some("Can't get the size of file "_s + file_path + ".");
+        }
+
+        // map it, leaving empty files unmapped since they can't be
+        if (file_stat.st_size > 0)
+        {
+            VAL view = mmap(nullptr, static_cast<std::size_t>(file_stat.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+            if (view == MAP_FAILED)
+            {
+                ::close(file);
+                return ax::some("Can't map file "_s + file_path + ".");
+            }
+            madvise(view, static_cast<std::size_t>(file_stat.st_size), MADV_SEQUENTIAL);
+            data = static_cast<const char*>(view);
+        }
+        ::close(file);
+        size = static_cast<std::size_t>(file_stat.st_size);
+#endif
+
+        open = true;
+        return ax::none<std::string>();
+    }
+
+    void mapped_file::close()
+    {
+#if defined(_WIN32)
+        if (data) UnmapViewOfFile(data);
+        if (mapping_handle) CloseHandle(mapping_handle);
+        if (file_handle) CloseHandle(file_handle);
+        mapping_handle = nullptr;
+        file_handle = nullptr;
+#else
+        if (data) munmap(const_cast<char*>(data), size);
+#endif
+        data = nullptr;
+        size = 0_z;
+        open = false;
+    }
+}
@@ -0,0 +1,493 @@
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <utility>
+
+#include "ax/model_bvh.hpp"
+
+namespace ax
+{
+    constexpr std::size_t bvh_bin_count = 16_z;
+    constexpr std::size_t bvh_leaf_size_max = 8_z;
+    constexpr std::size_t bvh_parallel_face_count_min = 65536_z;
+    constexpr std::size_t bvh_chunk_size = 16384_z;
+
+    // Past this depth nodes are split at their median, which halves them, so that traversal
+    // stacks of bvh_stack_size can't overflow on any mesh.
+    constexpr int bvh_sah_depth_max = 64;
+    constexpr std::size_t bvh_stack_size = 128_z;
+
+    static ax::box3 get_empty_box()
+    {
+        VAL max = std::numeric_limits<float>::max();
+        return ax::box3(ax::v3(max, max, max), ax::v3(-max, -max, -max));
+    }
+
+    static void grow_box(const ax::v3& point, ax::box3& box)
+    {
+        box.first = ax::v3(std::min(box.first.x, point.x), std::min(box.first.y, point.y), std::min(box.first.z, point.z));
+        box.second = ax::v3(std::max(box.second.x, point.x), std::max(box.second.y, point.y), std::max(box.second.z, point.z));
+    }
+
+    static void grow_box(const ax::box3& source, ax::box3& box)
+    {
+        ax::grow_box(source.first, box);
+        ax::grow_box(source.second, box);
+    }
+
+    static float get_half_area(const ax::box3& box)
+    {
+        VAL extent = box.second - box.first;
+        if (extent.x < 0.0f || extent.y < 0.0f || extent.z < 0.0f) return 0.0f;
+        return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+    }
+
+    // Find where a ray enters a node's box within max_distance, or infinity when it misses.
+    static float get_ray_entry(const ax::v3& origin, const ax::v3& direction, const ax::v3& inverse_direction, const ax::bvh_node& node, float max_distance)
+    {
+        VAR entry_distance = 0.0f;
+        VAR exit_distance = max_distance;
+        for (VAR axis = 0u; axis < 3u; ++axis)
+        {
+            if (direction[axis] == 0.0f)
+            {
+                if (origin[axis] < node.lower[axis] || origin[axis] > node.upper[axis]) return std::numeric_limits<float>::infinity();
+                continue;
+            }
+            VAR entry = (node.lower[axis] - origin[axis]) * inverse_direction[axis];
+            VAR exit = (node.upper[axis] - origin[axis]) * inverse_direction[axis];
+            if (entry > exit) std::swap(entry, exit);
+            entry_distance = std::max(entry_distance, entry);
+            exit_distance = std::min(exit_distance, exit);
+        }
+        return entry_distance <= exit_distance ? entry_distance : std::numeric_limits<float>::infinity();
+    }
+
+    // Intersect a ray with a triangle from either side, per Moller and Trumbore.
+    static bool try_intersect_triangle(const ax::v3& origin, const ax::v3& direction, const ax::v3* corners, float& distance, float& u, float& v)
+    {
+        VAL edge_b = corners[1] - corners[0];
+        VAL edge_c = corners[2] - corners[0];
+        VAL p = direction ^ edge_c;
+        VAL determinant = edge_b * p;
+        if (determinant == 0.0f) return false;
+        VAL inverse_determinant = 1.0f / determinant;
+        VAL s = origin - corners[0];
+        u = (s * p) * inverse_determinant;
+        if (u < 0.0f || u > 1.0f) return false;
+        VAL q = s ^ edge_b;
+        v = (direction * q) * inverse_determinant;
+        if (v < 0.0f || u + v > 1.0f) return false;
+        distance = (edge_c * q) * inverse_determinant;
+        return true;
+    }
+
+    // Test a triangle given relative to a box's center against the box's half extents on the
+    // separating axes of the box's faces, the triangle's face, and their edges' cross products.
+    static bool get_triangle_box_overlap(const ax::v3& a, const ax::v3& b, const ax::v3& c, const ax::v3& half)
+    {
+        // test the box's axes
+        for (VAR axis = 0u; axis < 3u; ++axis)
+        {
+            if (std::min(a[axis], std::min(b[axis], c[axis])) > half[axis]) return false;
+            if (std::max(a[axis], std::max(b[axis], c[axis])) < -half[axis]) return false;
+        }
+
+        // test the triangle's normal and the edge axes
+        VAL get_separated = [&](const ax::v3& axis)
+        {
+            VAL radius = half.x * std::abs(axis.x) + half.y * std::abs(axis.y) + half.z * std::abs(axis.z);
+            VAL pa = a * axis;
+            VAL pb = b * axis;
+            VAL pc = c * axis;
+            return std::min(pa, std::min(pb, pc)) > radius || std::max(pa, std::max(pb, pc)) < -radius;
+        };
+        if (get_separated((b - a) ^ (c - a))) return false;
+        const ax::v3 edges[3] = { b - a, c - b, a - c };
+        const ax::v3 units[3] = { ax::v3(1.0f, 0.0f, 0.0f), ax::v3(0.0f, 1.0f, 0.0f), ax::v3(0.0f, 0.0f, 1.0f) };
+        for (VAL& edge : edges)
+            for (VAL& unit : units)
+                if (get_separated(unit ^ edge)) return false;
+        return true;
+    }
+
+    // Find the barycentric weights of the point of a triangle closest to a point, per Ericson.
+    static ax::v3 get_closest_barycentric(const ax::v3& point, const ax::v3& a, const ax::v3& b, const ax::v3& c)
+    {
+        // compute against the corner regions and edge regions in turn
+        VAL ab = b - a;
+        VAL ac = c - a;
+        VAL ap = point - a;
+        VAL d1 = ab * ap;
+        VAL d2 = ac * ap;
+        if (d1 <= 0.0f && d2 <= 0.0f) return ax::v3(1.0f, 0.0f, 0.0f);
+        VAL bp = point - b;
+        VAL d3 = ab * bp;
+        VAL d4 = ac * bp;
+        if (d3 >= 0.0f && d4 <= d3) return ax::v3(0.0f, 1.0f, 0.0f);
+        VAL vc = d1 * d4 - d3 * d2;
+        if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+        {
+            VAL v = d1 / (d1 - d3);
+            return ax::v3(1.0f - v, v, 0.0f);
+        }
+        VAL cp = point - c;
+        VAL d5 = ab * cp;
+        VAL d6 = ac * cp;
+        if (d6 >= 0.0f && d5 <= d6) return ax::v3(0.0f, 0.0f, 1.0f);
+        VAL vb = d5 * d2 - d1 * d6;
+        if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+        {
+            VAL w = d2 / (d2 - d6);
+            return ax::v3(1.0f - w, 0.0f, w);
+        }
+        VAL va = d3 * d6 - d5 * d4;
+        if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f)
+        {
+            VAL w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+            return ax::v3(0.0f, 1.0f - w, w);
+        }
+
+        // else it's inside the face
+        VAL sum = va + vb + vc;
+        if (sum == 0.0f) return ax::v3(1.0f, 0.0f, 0.0f);
+        VAL v = vb / sum;
+        VAL w = vc / sum;
+        return ax::v3(1.0f - v - w, v, w);
+    }
+
+    // Builds the nodes over ranges of face references, partitioning them in place.
+    struct bvh_builder
+    {
+        std::vector<uint32_t>& references;
+        const std::vector<ax::box3>& face_bounds;
+        const std::vector<ax::v3>& centroids;
+
+        // Compute a range's bounds, and unless it should be a leaf, partition it at middle.
+        bool try_split(std::size_t begin, std::size_t end, int depth, ax::box3& bounds, std::size_t& middle) const
+        {
+            // compute the bounds of the faces and their centroids
+            bounds = ax::get_empty_box();
+            VAR centroid_bounds = ax::get_empty_box();
+            for (VAR i = begin; i < end; ++i)
+            {
+                ax::grow_box(face_bounds[references[i]], bounds);
+                ax::grow_box(centroids[references[i]], centroid_bounds);
+            }
+            VAL count = end - begin;
+            if (count <= 1_z) return false;
+
+            // find the cheapest split between centroid bins on any axis
+            VAR best_cost = std::numeric_limits<float>::max();
+            VAR best_axis = 3u;
+            VAR best_bin = 0_z;
+            for (VAR axis = 0u; axis < 3u && depth < ax::bvh_sah_depth_max; ++axis)
+            {
+                // bin the centroids
+                VAL lower = centroid_bounds.first[axis];
+                VAL extent = centroid_bounds.second[axis] - lower;
+                if (!(extent > 0.0f)) continue;
+                VAL scale = static_cast<float>(ax::bvh_bin_count) / extent;
+                ax::box3 bin_bounds[ax::bvh_bin_count];
+                std::size_t bin_counts[ax::bvh_bin_count] = {};
+                std::fill(std::begin(bin_bounds), std::end(bin_bounds), ax::get_empty_box());
+                for (VAR i = begin; i < end; ++i)
+                {
+                    VAL bin = std::min(ax::bvh_bin_count - 1_z, static_cast<std::size_t>((centroids[references[i]][axis] - lower) * scale));
+                    ax::grow_box(face_bounds[references[i]], bin_bounds[bin]);
+                    ++bin_counts[bin];
+                }
+
+                // sweep from the right, then from the left costing each split
+                float right_costs[ax::bvh_bin_count];
+                VAR right_bounds = ax::get_empty_box();
+                VAR right_count = 0_z;
+                for (VAR bin = ax::bvh_bin_count - 1_z; bin > 0_z; --bin)
+                {
+                    ax::grow_box(bin_bounds[bin], right_bounds);
+                    right_count += bin_counts[bin];
+                    right_costs[bin] = right_count > 0_z ? ax::get_half_area(right_bounds) * static_cast<float>(right_count) : -1.0f;
+                }
+                VAR left_bounds = ax::get_empty_box();
+                VAR left_count = 0_z;
+                for (VAR bin = 0_z; bin + 1_z < ax::bvh_bin_count; ++bin)
+                {
+                    ax::grow_box(bin_bounds[bin], left_bounds);
+                    left_count += bin_counts[bin];
+                    if (left_count == 0_z || right_costs[bin + 1_z] < 0.0f) continue;
+                    VAL cost = ax::get_half_area(left_bounds) * static_cast<float>(left_count) + right_costs[bin + 1_z];
+                    if (cost < best_cost)
+                    {
+                        best_cost = cost;
+                        best_axis = axis;
+                        best_bin = bin;
+                    }
+                }
+            }
+
+            // keep small ranges as leaves when splitting them costs more than intersecting them
+            VAL area = ax::get_half_area(bounds);
+            if (count <= ax::bvh_leaf_size_max && (best_axis == 3u || area * static_cast<float>(count) <= area + best_cost)) return false;
+
+            // partition at the best split
+            if (best_axis != 3u)
+            {
+                VAL lower = centroid_bounds.first[best_axis];
+                VAL scale = static_cast<float>(ax::bvh_bin_count) / (centroid_bounds.second[best_axis] - lower);
+                VAL split = std::partition(references.begin() + begin, references.begin() + end, [&](uint32_t reference)
+                {
+                    return std::min(ax::bvh_bin_count - 1_z, static_cast<std::size_t>((centroids[reference][best_axis] - lower) * scale)) <= best_bin;
+                });
+                middle = static_cast<std::size_t>(split - references.begin());
+                if (middle > begin && middle < end) return true;
+            }
+
+            // else split at the median along the widest axis
+            VAL extent = centroid_bounds.second - centroid_bounds.first;
+            VAL axis = extent.x >= extent.y && extent.x >= extent.z ? 0u : extent.y >= extent.z ? 1u : 2u;
+            middle = begin + count / 2_z;
+            std::nth_element(references.begin() + begin, references.begin() + middle, references.begin() + end, [&](uint32_t a, uint32_t b)
+            {
+                return centroids[a][axis] < centroids[b][axis];
+            });
+            return true;
+        }
+
+        // Build the subtree over a range into a node, appending its descendants.
+        void build(std::vector<ax::bvh_node>& nodes, std::size_t node_index, std::size_t begin, std::size_t end, int depth) const
+        {
+            ax::box3 bounds;
+            VAR middle = 0_z;
+            VAL split = try_split(begin, end, depth, bounds, middle);
+            nodes[node_index].lower = bounds.first;
+            nodes[node_index].upper = bounds.second;
+            if (!split)
+            {
+                nodes[node_index].index = static_cast<uint32_t>(begin);
+                nodes[node_index].count = static_cast<uint32_t>(end - begin);
+                return;
+            }
+            VAL children = nodes.size();
+            nodes.resize(children + 2_z);
+            nodes[node_index].index = static_cast<uint32_t>(children);
+            nodes[node_index].count = 0u;
+            build(nodes, children, begin, middle, depth + 1);
+            build(nodes, children + 1_z, middle, end, depth + 1);
+        }
+    };
+
+    model_bvh::model_bvh() :
+        nodes(),
+        faces(),
+        corners()
+    { }
+
+    ax::box3 model_bvh::get_bounds() const
+    {
+        return nodes.empty() ? ax::box3() : ax::box3(nodes[0].lower, nodes[0].upper);
+    }
+
+    void model_bvh::build(const ax::basic_model& model)
+    {
+        build(model, ax::worker_pool::get_default());
+    }
+
+    // Build top-down, binning face centroids and splitting where the surface area heuristic is
+    // lowest, the subtrees of big models in parallel, then copy the corners out in leaf order.
+    void model_bvh::build(const ax::basic_model& model, ax::worker_pool& pool)
+    {
+        // compute each face's bounds and centroid in parallel chunks
+        clear();
+        VAL& vertices = model.get_vertices();
+        VAL& indices = model.get_indices();
+        VAL face_count = indices.size() / 3_z;
+        if (face_count == 0_z) return;
+        std::vector<ax::box3> face_bounds(face_count);
+        std::vector<ax::v3> centroids(face_count);
+        VAL chunk_count = (face_count + ax::bvh_chunk_size - 1_z) / ax::bvh_chunk_size;
+        pool.parallel_for(chunk_count, [&](std::size_t chunk)
+        {
+            VAL end = std::min(face_count, (chunk + 1_z) * ax::bvh_chunk_size);
+            for (VAR i = chunk * ax::bvh_chunk_size; i < end; ++i)
+            {
+                VAR bounds = ax::get_empty_box();
+                for (VAR k = 0_z; k < 3_z; ++k) ax::grow_box(vertices[indices[i * 3_z + k]].position, bounds);
+                face_bounds[i] = bounds;
+                centroids[i] = (bounds.first + bounds.second) * 0.5f;
+            }
+        });
+
+        // build small models serially
+        std::vector<uint32_t> references(face_count);
+        std::iota(references.begin(), references.end(), 0u);
+        const ax::bvh_builder builder{ references, face_bounds, centroids };
+        nodes.resize(1_z);
+        if (face_count < ax::bvh_parallel_face_count_min) builder.build(nodes, 0_z, 0_z, face_count, 0);
+        else
+        {
+            // a range left to build as its own subtree
+            struct subtree
+            {
+                std::size_t node_index;
+                std::size_t begin;
+                std::size_t end;
+                int depth;
+                std::vector<ax::bvh_node> nodes;
+            };
+
+            // split the top levels serially until ranges are small enough to share out
+            VAL subtree_face_count = std::max(4096_z, face_count / ((pool.get_thread_count() + 1_z) * 8_z));
+            std::vector<subtree> subtrees;
+            std::vector<subtree> pending;
+            pending.push_back({ 0_z, 0_z, face_count, 0, {} });
+            while (!pending.empty())
+            {
+                VAR range = std::move(pending.back());
+                pending.pop_back();
+                if (range.end - range.begin <= subtree_face_count)
+                {
+                    subtrees.push_back(std::move(range));
+                    continue;
+                }
+                ax::box3 bounds;
+                VAR middle = 0_z;
+                VAL split = builder.try_split(range.begin, range.end, range.depth, bounds, middle);
+                VAR& node = nodes[range.node_index];
+                node.lower = bounds.first;
+                node.upper = bounds.second;
+                node.index = split ? static_cast<uint32_t>(nodes.size()) : static_cast<uint32_t>(range.begin);
+                node.count = split ? 0u : static_cast<uint32_t>(range.end - range.begin);
+                if (!split) continue;
+                VAL children = nodes.size();
+                nodes.resize(children + 2_z);
+                pending.push_back({ children, range.begin, middle, range.depth + 1, {} });
+                pending.push_back({ children + 1_z, middle, range.end, range.depth + 1, {} });
+            }
+
+            // build the subtrees in parallel
+            pool.parallel_for(subtrees.size(), [&](std::size_t i)
+            {
+                VAR& tree = subtrees[i];
+                tree.nodes.resize(1_z);
+                builder.build(tree.nodes, 0_z, tree.begin, tree.end, tree.depth);
+            });
+
+            // stitch them in, each root replacing its placeholder and the rest appended
+            for (VAR& tree : subtrees)
+            {
+                VAL base = static_cast<uint32_t>(nodes.size()) - 1u;
+                for (VAR& node : tree.nodes) if (node.count == 0u) node.index += base;
+                nodes[tree.node_index] = tree.nodes[0];
+                nodes.insert(nodes.end(), tree.nodes.begin() + 1, tree.nodes.end());
+            }
+        }
+
+        // copy out the faces' corners in leaf order
+        faces = std::move(references);
+        corners.resize(face_count * 3_z);
+        pool.parallel_for(chunk_count, [&](std::size_t chunk)
+        {
+            VAL end = std::min(face_count, (chunk + 1_z) * ax::bvh_chunk_size);
+            for (VAR i = chunk * ax::bvh_chunk_size; i < end; ++i)
+                for (VAR k = 0_z; k < 3_z; ++k)
+                    corners[i * 3_z + k] = vertices[indices[faces[i] * 3_z + k]].position;
+        });
+    }
+
+    void model_bvh::clear()
+    {
+        nodes.clear();
+        faces.clear();
+        corners.clear();
+    }
+
+    bool model_bvh::try_intersect(const ax::v3& origin, const ax::v3& direction, ax::face_hit& hit, float max_distance) const
+    {
+        return try_intersect(origin, direction, max_distance, false, hit);
+    }
+
+    bool model_bvh::try_intersect_any(const ax::v3& origin, const ax::v3& direction, ax::face_hit& hit, float max_distance) const
+    {
+        return try_intersect(origin, direction, max_distance, true, hit);
+    }
+
+    // Hit distances are in multiples of the direction's length.
+    bool model_bvh::try_intersect(const ax::v3& origin, const ax::v3& direction, float max_distance, bool any, ax::face_hit& hit) const
+    {
+        // visit nodes nearest first, skipping any entered beyond the closest hit so far
+        if (nodes.empty()) return false;
+        VAL inverse_direction = ax::v3(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+        VAL infinity = std::numeric_limits<float>::infinity();
+        uint32_t stack[ax::bvh_stack_size];
+        VAR stack_size = 0_z;
+        VAR closest = max_distance;
+        VAR found = false;
+        if (ax::get_ray_entry(origin, direction, inverse_direction, nodes[0], closest) != infinity) stack[stack_size++] = 0u;
+        while (stack_size > 0_z)
+        {
+            VAL& node = nodes[stack[--stack_size]];
+            if (ax::get_ray_entry(origin, direction, inverse_direction, node, closest) == infinity) continue;
+
+            // intersect a leaf's faces
+            if (node.count > 0u)
+            {
+                for (VAR slot = node.index; slot < node.index + node.count; ++slot)
+                {
+                    VAR distance = 0.0f;
+                    VAR u = 0.0f;
+                    VAR v = 0.0f;
+                    if (!ax::try_intersect_triangle(origin, direction, corners.data() + slot * 3_z, distance, u, v) || distance < 0.0f || distance > closest) continue;
+                    closest = distance;
+                    hit = { static_cast<int>(faces[slot]), distance, ax::v3(1.0f - u - v, u, v) };
+                    found = true;
+                    if (any) return true;
+                }
+                continue;
+            }
+
+            // push the children, the nearer last
+            VAL near_entry = ax::get_ray_entry(origin, direction, inverse_direction, nodes[node.index], closest);
+            VAL far_entry = ax::get_ray_entry(origin, direction, inverse_direction, nodes[node.index + 1u], closest);
+            VAL near_first = near_entry <= far_entry;
+            VAL first = near_first ? node.index : node.index + 1u;
+            VAL second = near_first ? node.index + 1u : node.index;
+            if ((near_first ? far_entry : near_entry) != infinity) stack[stack_size++] = second;
+            if ((near_first ? near_entry : far_entry) != infinity) stack[stack_size++] = first;
+        }
+        return found;
+    }
+
+    void model_bvh::get_overlaps(const ax::box3& box, std::vector<ax::face_hit>& hits) const
+    {
+        // visit every node overlapping the box
+        if (nodes.empty()) return;
+        VAL center = (box.first + box.second) * 0.5f;
+        VAL half = (box.second - box.first) * 0.5f;
+        uint32_t stack[ax::bvh_stack_size];
+        VAR stack_size = 0_z;
+        stack[stack_size++] = 0u;
+        while (stack_size > 0_z)
+        {
+            VAL& node = nodes[stack[--stack_size]];
+            if (node.lower.x > box.second.x || node.lower.y > box.second.y || node.lower.z > box.second.z ||
+                node.upper.x < box.first.x || node.upper.y < box.first.y || node.upper.z < box.first.z)
+                continue;
+            if (node.count == 0u)
+            {
+                stack[stack_size++] = node.index + 1u;
+                stack[stack_size++] = node.index;
+                continue;
+            }
+
+            // test a leaf's faces exactly, finding the point of each nearest the box's center
+            for (VAR slot = node.index; slot < node.index + node.count; ++slot)
+            {
+                VAL face_corners = corners.data() + slot * 3_z;
+                if (!ax::get_triangle_box_overlap(face_corners[0] - center, face_corners[1] - center, face_corners[2] - center, half)) continue;
+                VAL barycentric = ax::get_closest_barycentric(center, face_corners[0], face_corners[1], face_corners[2]);
+                VAL closest = face_corners[0] * barycentric.x + face_corners[1] * barycentric.y + face_corners[2] * barycentric.z;
+                hits.push_back({ static_cast<int>(faces[slot]), (closest - center).Length(), barycentric });
+            }
+        }
+    }
+}
@@ -0,0 +1,432 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <queue>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "ax/model_lods.hpp"
+
+namespace ax
+{
+    // A symmetric quadric measuring the weighted sum of squared distances to a set of planes.
+    struct quadric
+    {
+        double a00, a01, a02, a11, a12, a22, b0, b1, b2, c;
+    };
+
+    static void add_plane(const ax::v3& normal, const ax::v3& point, double weight, ax::quadric& q)
+    {
+        VAL x = static_cast<double>(normal.x);
+        VAL y = static_cast<double>(normal.y);
+        VAL z = static_cast<double>(normal.z);
+        VAL d = -(x * point.x + y * point.y + z * point.z);
+        q.a00 += weight * x * x; q.a01 += weight * x * y; q.a02 += weight * x * z;
+        q.a11 += weight * y * y; q.a12 += weight * y * z; q.a22 += weight * z * z;
+        q.b0 += weight * x * d; q.b1 += weight * y * d; q.b2 += weight * z * d;
+        q.c += weight * d * d;
+    }
+
+    static void add_quadric(const ax::quadric& source, ax::quadric& target)
+    {
+        target.a00 += source.a00; target.a01 += source.a01; target.a02 += source.a02;
+        target.a11 += source.a11; target.a12 += source.a12; target.a22 += source.a22;
+        target.b0 += source.b0; target.b1 += source.b1; target.b2 += source.b2;
+        target.c += source.c;
+    }
+
+    static double get_error(const ax::quadric& q, const ax::v3& point)
+    {
+        VAL x = static_cast<double>(point.x);
+        VAL y = static_cast<double>(point.y);
+        VAL z = static_cast<double>(point.z);
+        return
+            q.a00 * x * x + 2.0 * q.a01 * x * y + 2.0 * q.a02 * x * z +
+            q.a11 * y * y + 2.0 * q.a12 * y * z + q.a22 * z * z +
+            2.0 * (q.b0 * x + q.b1 * y + q.b2 * z) + q.c;
+    }
+
+    static ax::v3 get_face_cross(const ax::v3& a, const ax::v3& b, const ax::v3& c)
+    {
+        return (b - a) ^ (c - a);
+    }
+
+    // Hashes a position's bits for grouping the vertices that share it.
+    struct position_hash
+    {
+        std::size_t operator()(const ax::v3& position) const
+        {
+            uint32_t bits[3];
+            std::memcpy(bits, &position.x, sizeof(bits));
+            return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+        }
+    };
+
+    struct position_equal
+    {
+        bool operator()(const ax::v3& a, const ax::v3& b) const { return std::memcmp(&a.x, &b.x, sizeof(float) * 3_z) == 0; }
+    };
+
+    // The state of a simplification - faces over welded vertices, grouped by the positions they
+    // share, each position carrying its quadric and the faces around it.
+    struct simplifier
+    {
+        std::vector<uint32_t> faces;
+        std::vector<uint8_t> faces_alive;
+        std::vector<uint32_t> vertex_positions;
+        std::vector<ax::v3> positions;
+        std::vector<ax::quadric> quadrics;
+        std::vector<std::vector<uint32_t>> position_faces;
+        std::vector<uint8_t> positions_alive;
+        std::vector<uint8_t> positions_border;
+        std::vector<uint32_t> versions;
+        int face_count;
+
+        // Find whether the position u can collapse onto its neighbor v, filling in which of v's
+        // vertices each of u's vertices becomes.
+        bool try_map_collapse(uint32_t u, uint32_t v, std::vector<std::pair<uint32_t, uint32_t>>& mapping) const
+        {
+            // map each of u's vertices to the one vertex of v it shares faces with
+            mapping.clear();
+            VAR shared = 0;
+            for (VAL f : position_faces[u])
+            {
+                VAL face = faces.data() + f * 3_z;
+                VAR u_vertex = ~0u;
+                VAR v_vertex = ~0u;
+                for (VAR k = 0_z; k < 3_z; ++k)
+                {
+                    if (vertex_positions[face[k]] == u) u_vertex = face[k];
+                    else if (vertex_positions[face[k]] == v) v_vertex = face[k];
+                }
+                if (v_vertex == ~0u) continue;
+                ++shared;
+                VAL found = std::find_if(mapping.begin(), mapping.end(), [&](VAL& entry) { return entry.first == u_vertex; });
+                if (found == mapping.end()) mapping.push_back({ u_vertex, v_vertex });
+                else if (found->second != v_vertex) return false;
+            }
+
+            // borders may only collapse along themselves, and interior edges must be manifold
+            if (shared == 0 || shared > 2 || (positions_border[u] && shared != 1) || (!positions_border[u] && shared != 2)) return false;
+
+            // every vertex of u needs somewhere to go, which fails when collapsing across a seam
+            for (VAL f : position_faces[u])
+                for (VAR k = 0_z; k < 3_z; ++k)
+                {
+                    VAL vertex = faces[f * 3_z + k];
+                    if (vertex_positions[vertex] == u && std::none_of(mapping.begin(), mapping.end(), [&](VAL& entry) { return entry.first == vertex; })) return false;
+                }
+
+            // u and v must share exactly the neighbors of the faces between them
+            std::vector<uint32_t> neighbors_u;
+            std::vector<uint32_t> neighbors_v;
+            gather_neighbors(u, neighbors_u);
+            gather_neighbors(v, neighbors_v);
+            std::vector<uint32_t> common;
+            std::set_intersection(neighbors_u.begin(), neighbors_u.end(), neighbors_v.begin(), neighbors_v.end(), std::back_inserter(common));
+            if (ax::ztoi(common.size()) != shared) return false;
+
+            // no face that remains may fold over or collapse to nothing
+            for (VAL f : position_faces[u])
+            {
+                VAL face = faces.data() + f * 3_z;
+                if (std::any_of(face, face + 3, [&](uint32_t vertex) { return vertex_positions[vertex] == v; })) continue;
+                ax::v3 corners[3];
+                for (VAR k = 0_z; k < 3_z; ++k) corners[k] = positions[vertex_positions[face[k]]];
+                VAL& before = ax::get_face_cross(corners[0], corners[1], corners[2]);
+                for (VAR k = 0_z; k < 3_z; ++k) if (vertex_positions[face[k]] == u) corners[k] = positions[v];
+                VAL& after = ax::get_face_cross(corners[0], corners[1], corners[2]);
+                if (after * before <= 0.0f || after.SquareLength() <= before.SquareLength() * 1e-6f) return false;
+            }
+            return true;
+        }
+
+        void gather_neighbors(uint32_t p, std::vector<uint32_t>& neighbors) const
+        {
+            neighbors.clear();
+            for (VAL f : position_faces[p])
+                for (VAR k = 0_z; k < 3_z; ++k)
+                {
+                    VAL position = vertex_positions[faces[f * 3_z + k]];
+                    if (position != p) neighbors.push_back(position);
+                }
+            std::sort(neighbors.begin(), neighbors.end());
+            neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+        }
+
+        // Find u's cheapest valid collapse, if it has any.
+        bool try_get_best_collapse(uint32_t u, uint32_t& target, double& cost) const
+        {
+            std::vector<uint32_t> neighbors;
+            std::vector<std::pair<uint32_t, uint32_t>> mapping;
+            gather_neighbors(u, neighbors);
+            VAR found = false;
+            for (VAL v : neighbors)
+            {
+                ax::quadric q = quadrics[u];
+                ax::add_quadric(quadrics[v], q);
+                VAL error = ax::get_error(q, positions[v]);
+                if ((!found || error < cost) && try_map_collapse(u, v, mapping))
+                {
+                    target = v;
+                    cost = error;
+                    found = true;
+                }
+            }
+            return found;
+        }
+    };
+
+    // Vertices only collapse onto existing neighbors, so uvs and normals carry over unchanged.
+    // Seam and border vertices only collapse along the seam or border so neither is torn open, and
+    // collapses that would fold a face or break manifoldness are skipped, so the target may not be
+    // reached. The surface isn't copied.
+    void simplify_model(const ax::basic_model& model, int target_face_count, ax::basic_model& simplified)
+    {
+        // group vertices by the positions they share
+        ax::simplifier state;
+        VAL& vertices = model.get_vertices();
+        VAL& indices = model.get_indices();
+        std::unordered_map<ax::v3, uint32_t, ax::position_hash, ax::position_equal> position_ids;
+        position_ids.reserve(vertices.size());
+        state.vertex_positions.resize(vertices.size());
+        for (VAR i = 0_z; i < vertices.size(); ++i)
+        {
+            VAL& inserted = position_ids.emplace(vertices[i].position, static_cast<uint32_t>(state.positions.size()));
+            if (inserted.second) state.positions.push_back(vertices[i].position);
+            state.vertex_positions[i] = inserted.first->second;
+        }
+        VAL position_count = state.positions.size();
+        state.faces = indices;
+        state.face_count = model.get_face_count();
+        state.faces_alive.assign(ax::itoz(state.face_count), static_cast<uint8_t>(1));
+        state.quadrics.assign(position_count, ax::quadric{});
+        state.position_faces.resize(position_count);
+        state.positions_alive.assign(position_count, static_cast<uint8_t>(1));
+        state.positions_border.assign(position_count, static_cast<uint8_t>(0));
+        state.versions.assign(position_count, 0u);
+
+        // find each position's faces, and each edge's first face and face count
+        std::unordered_map<uint64_t, std::pair<uint32_t, int>> edges;
+        edges.reserve(indices.size());
+        for (VAR f = 0_z; f < ax::itoz(state.face_count); ++f)
+        {
+            VAL face = indices.data() + f * 3_z;
+            for (VAR k = 0_z; k < 3_z; ++k)
+            {
+                VAL a = state.vertex_positions[face[k]];
+                VAL b = state.vertex_positions[face[(k + 1_z) % 3_z]];
+                state.position_faces[a].push_back(static_cast<uint32_t>(f));
+                VAL key = static_cast<uint64_t>(std::min(a, b)) << 32 | std::max(a, b);
+                VAR& edge = edges[key];
+                if (edge.second == 0) edge.first = static_cast<uint32_t>(f);
+                ++edge.second;
+            }
+        }
+        for (VAR f = 0_z; f < ax::itoz(state.face_count); ++f)
+        {
+            // accumulate the face's plane, weighted by its area
+            VAL face = indices.data() + f * 3_z;
+            VAL& cross = ax::get_face_cross(vertices[face[0]].position, vertices[face[1]].position, vertices[face[2]].position);
+            VAL area = cross.Length();
+            if (area <= 0.0f) continue;
+            VAL& normal = cross / area;
+            for (VAR k = 0_z; k < 3_z; ++k) ax::add_plane(normal, vertices[face[0]].position, area * 0.5, state.quadrics[state.vertex_positions[face[k]]]);
+
+            // hold borders, and seams where the face on the other side reaches the edge through
+            // different vertices, in place with planes through them perpendicular to the face
+            for (VAR k = 0_z; k < 3_z; ++k)
+            {
+                VAL vertex_a = face[k];
+                VAL vertex_b = face[(k + 1_z) % 3_z];
+                VAL a = state.vertex_positions[vertex_a];
+                VAL b = state.vertex_positions[vertex_b];
+                VAL& edge = edges[static_cast<uint64_t>(std::min(a, b)) << 32 | std::max(a, b)];
+                VAR constrained = edge.second == 1;
+                if (edge.second == 2 && edge.first != f)
+                {
+                    VAL other = indices.data() + edge.first * 3_z;
+                    VAL other_a = std::find_if(other, other + 3, [&](uint32_t vertex) { return state.vertex_positions[vertex] == a; });
+                    VAL other_b = std::find_if(other, other + 3, [&](uint32_t vertex) { return state.vertex_positions[vertex] == b; });
+                    constrained = *other_a != vertex_a || *other_b != vertex_b;
+                }
+                if (edge.second == 1)
+                {
+                    state.positions_border[a] = 1;
+                    state.positions_border[b] = 1;
+                }
+                if (!constrained) continue;
+                VAL& along = vertices[vertex_b].position - vertices[vertex_a].position;
+                VAL& perpendicular = along ^ normal;
+                VAL length = perpendicular.Length();
+                if (length <= 0.0f) continue;
+                VAL weight = static_cast<double>(along.SquareLength()) * 10.0;
+                ax::add_plane(perpendicular / length, vertices[vertex_a].position, weight, state.quadrics[a]);
+                ax::add_plane(perpendicular / length, vertices[vertex_a].position, weight, state.quadrics[b]);
+            }
+        }
+
+        // queue each position's cheapest collapse
+        struct candidate
+        {
+            double cost;
+            uint32_t position;
+            uint32_t target;
+            uint32_t version;
+            bool operator>(const candidate& that) const { return cost > that.cost; }
+        };
+        std::priority_queue<candidate, std::vector<candidate>, std::greater<candidate>> queue;
+        VAL push_best = [&](uint32_t u)
+        {
+            uint32_t target;
+            double cost;
+            if (state.try_get_best_collapse(u, target, cost)) queue.push({ cost, u, target, state.versions[u] });
+        };
+        for (VAR u = 0_z; u < position_count; ++u) push_best(static_cast<uint32_t>(u));
+
+        // collapse the cheapest until reaching the target
+        std::vector<std::pair<uint32_t, uint32_t>> mapping;
+        std::vector<uint32_t> neighbors;
+        while (state.face_count > target_face_count && !queue.empty())
+        {
+            // skip stale candidates, retrying those whose collapse became invalid
+            VAL next = queue.top();
+            queue.pop();
+            VAL u = next.position;
+            VAL v = next.target;
+            if (!state.positions_alive[u] || next.version != state.versions[u]) continue;
+            if (!state.positions_alive[v] || !state.try_map_collapse(u, v, mapping))
+            {
+                ++state.versions[u];
+                push_best(u);
+                continue;
+            }
+
+            // remove the faces between u and v, moving u's other faces onto v's vertices
+            for (VAL f : state.position_faces[u])
+            {
+                VAL face = state.faces.data() + f * 3_z;
+                if (std::any_of(face, face + 3, [&](uint32_t vertex) { return state.vertex_positions[vertex] == v; }))
+                {
+                    state.faces_alive[f] = 0;
+                    --state.face_count;
+                    for (VAR k = 0_z; k < 3_z; ++k)
+                    {
+                        VAL p = state.vertex_positions[face[k]];
+                        if (p == u || p == v) continue;
+                        VAR& faces_p = state.position_faces[p];
+                        faces_p.erase(std::remove(faces_p.begin(), faces_p.end(), f), faces_p.end());
+                    }
+                    continue;
+                }
+                for (VAR k = 0_z; k < 3_z; ++k)
+                    if (state.vertex_positions[face[k]] == u)
+                        face[k] = std::find_if(mapping.begin(), mapping.end(), [&](VAL& entry) { return entry.first == face[k]; })->second;
+                state.position_faces[v].push_back(f);
+            }
+            VAR& faces_v = state.position_faces[v];
+            faces_v.erase(std::remove_if(faces_v.begin(), faces_v.end(), [&](uint32_t f) { return !state.faces_alive[f]; }), faces_v.end());
+            state.position_faces[u].clear();
+            state.positions_alive[u] = 0;
+            ax::add_quadric(state.quadrics[u], state.quadrics[v]);
+
+            // requeue v and its neighbors, whose collapses have all changed
+            state.gather_neighbors(v, neighbors);
+            neighbors.push_back(v);
+            for (VAL p : neighbors)
+            {
+                ++state.versions[p];
+                push_best(p);
+            }
+        }
+
+        // gather the remaining faces' corners, compacting the vertices they refer to
+        std::vector<int> vertex_remap(vertices.size(), -1);
+        std::vector<ax::v3> positions;
+        std::vector<ax::v2> uvs;
+        std::vector<ax::v3> normals;
+        std::vector<ax::v3i> corners;
+        corners.reserve(ax::itoz(state.face_count) * 3_z);
+        for (VAR f = 0_z; f < state.faces_alive.size(); ++f)
+        {
+            if (!state.faces_alive[f]) continue;
+            for (VAR k = 0_z; k < 3_z; ++k)
+            {
+                VAL vertex = state.faces[f * 3_z + k];
+                VAR& mapped = vertex_remap[vertex];
+                if (mapped < 0)
+                {
+                    mapped = ax::ztoi(positions.size());
+                    positions.push_back(vertices[vertex].position);
+                    uvs.push_back(vertices[vertex].uv);
+                    normals.push_back(vertices[vertex].normal);
+                }
+                corners.push_back(ax::v3i(mapped));
+            }
+        }
+        simplified.set_geometry(positions, uvs, normals, corners);
+    }
+
+    model_lods::model_lods() :
+        model(nullptr),
+        levels(),
+        bounds()
+    { }
+
+    const ax::basic_model& model_lods::get_level(std::size_t index) const
+    {
+        if (!model || index > levels.size()) throw std::out_of_range("ax::model_lods level index out of range.");
+        return index == 0_z ? *model : levels[index - 1_z];
+    }
+
+    void model_lods::build(const ax::basic_model& model, int min_face_count)
+    {
+        // compute the model's screen-space bounds
+        clear();
+        this->model = &model;
+        VAL& vertices = model.get_vertices();
+        VAL max = std::numeric_limits<float>::max();
+        bounds = ax::box2(ax::v2(max, max), ax::v2(-max, -max));
+        for (VAL& vertex : vertices)
+        {
+            bounds.first = ax::v2(std::min(bounds.first.x, vertex.position.x), std::min(bounds.first.y, vertex.position.y));
+            bounds.second = ax::v2(std::max(bounds.second.x, vertex.position.x), std::max(bounds.second.y, vertex.position.y));
+        }
+
+        // halve each level until too small, or until simplification stalls
+        VAR face_count = model.get_face_count();
+        while (face_count / 2 >= min_face_count)
+        {
+            ax::basic_model level;
+            ax::simplify_model(levels.empty() ? model : levels.back(), face_count / 2, level);
+            if (level.get_face_count() * 10 > face_count * 9) break;
+            face_count = level.get_face_count();
+            levels.push_back(std::move(level));
+        }
+    }
+
+    void model_lods::clear()
+    {
+        model = nullptr;
+        levels.clear();
+        bounds = ax::box2();
+    }
+
+    std::size_t model_lods::select_level(int width, int height, float pixels_per_face) const
+    {
+        // estimate the model's coverage from its bounds, which the ortho projection maps from
+        // [-1, 1] onto the target
+        if (levels.empty()) return 0_z;
+        VAL covered_width = std::max(0.0f, bounds.second.x - bounds.first.x) * 0.5f * static_cast<float>(width);
+        VAL covered_height = std::max(0.0f, bounds.second.y - bounds.first.y) * 0.5f * static_cast<float>(height);
+        VAL face_budget = covered_width * covered_height / std::max(pixels_per_face, 1e-6f);
+
+        // take the coarsest level meeting the budget
+        for (VAR i = levels.size(); i > 0_z; --i)
+            if (static_cast<float>(levels[i - 1_z].get_face_count()) >= face_budget) return i;
+        return 0_z;
+    }
+}
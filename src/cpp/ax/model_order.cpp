@@ -0,0 +1,195 @@
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+#include "ax/model_order.hpp"
+
+namespace ax
+{
+    // Spread the low 10 bits of a value out to every third bit.
+    static uint32_t spread_morton_bits(uint32_t value)
+    {
+        value &= 0x3FFu;
+        value = (value | value << 16) & 0x030000FFu;
+        value = (value | value << 8) & 0x0300F00Fu;
+        value = (value | value << 4) & 0x030C30C3u;
+        value = (value | value << 2) & 0x09249249u;
+        return value;
+    }
+
+    // Reorder the faces of one cluster with Tipsify, writing them to out. Vertices are given
+    // cluster-local ids first so that the scratch space stays proportional to the cluster.
+    static void tipsify_faces(const uint32_t* indices, std::size_t face_count, int cache_size, std::vector<uint32_t>& local_ids, uint32_t* out)
+    {
+        // compute cluster-local vertex ids
+        std::vector<uint32_t> globals;
+        std::vector<uint32_t> locals(face_count * 3_z);
+        for (VAR i = 0_z; i < face_count * 3_z; ++i)
+        {
+            VAR& local_id = local_ids[indices[i]];
+            if (local_id == std::numeric_limits<uint32_t>::max())
+            {
+                local_id = static_cast<uint32_t>(globals.size());
+                globals.push_back(indices[i]);
+            }
+            locals[i] = local_id;
+        }
+        VAL vertex_count = globals.size();
+
+        // compute each vertex's faces
+        std::vector<uint32_t> live(vertex_count, 0u);
+        for (VAL local : locals) ++live[local];
+        std::vector<uint32_t> offsets(vertex_count + 1_z, 0u);
+        std::partial_sum(live.begin(), live.end(), offsets.begin() + 1);
+        std::vector<uint32_t> vertex_faces(locals.size());
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (VAR i = 0_z; i < locals.size(); ++i) vertex_faces[fill[locals[i]]++] = static_cast<uint32_t>(i / 3_z);
+
+        // fan around each vertex in turn, emitting its unemitted faces, then move on to the
+        // candidate most recently cached that's likely to stay cached through its own fan
+        std::vector<int> cache_times(vertex_count, 0);
+        std::vector<uint8_t> emitted(face_count, 0);
+        std::vector<uint32_t> dead_ends;
+        std::vector<uint32_t> candidates;
+        VAR time = cache_size + 1;
+        VAR cursor = 0_z;
+        VAR written = 0_z;
+        VAR fan = vertex_count > 0_z ? 0 : -1;
+        while (fan >= 0)
+        {
+            // emit the fan
+            candidates.clear();
+            for (VAR j = offsets[fan]; j < offsets[fan + 1]; ++j)
+            {
+                VAL face = vertex_faces[j];
+                if (emitted[face]) continue;
+                emitted[face] = 1;
+                for (VAR k = 0_z; k < 3_z; ++k)
+                {
+                    VAL local = locals[face * 3_z + k];
+                    out[written++] = globals[local];
+                    dead_ends.push_back(local);
+                    candidates.push_back(local);
+                    --live[local];
+                    if (time - cache_times[local] > cache_size) cache_times[local] = time++;
+                }
+            }
+
+            // pick the next fan among the fan's vertices
+            fan = -1;
+            VAR best_priority = -1;
+            for (VAL candidate : candidates)
+            {
+                if (live[candidate] == 0u) continue;
+                VAL age = time - cache_times[candidate];
+                VAL priority = age + 2 * static_cast<int>(live[candidate]) <= cache_size ? age : 0;
+                if (priority > best_priority)
+                {
+                    best_priority = priority;
+                    fan = static_cast<int>(candidate);
+                }
+            }
+
+            // else back up through recently used vertices, else take the next vertex in order
+            while (fan < 0 && !dead_ends.empty())
+            {
+                VAL dead_end = dead_ends.back();
+                dead_ends.pop_back();
+                if (live[dead_end] > 0u) fan = static_cast<int>(dead_end);
+            }
+            for (; fan < 0 && cursor < vertex_count; ++cursor)
+                if (live[cursor] > 0u) fan = static_cast<int>(cursor);
+        }
+
+        // reset the shared scratch space
+        for (VAL global : globals) local_ids[global] = std::numeric_limits<uint32_t>::max();
+    }
+
+    float get_vertex_cache_miss_ratio(const std::vector<uint32_t>& indices, std::size_t vertex_count, int cache_size)
+    {
+        // a vertex is cached while fewer than cache_size misses have happened since its own
+        VAL face_count = indices.size() / 3_z;
+        if (face_count == 0_z) return 0.0f;
+        std::vector<int64_t> miss_times(vertex_count, std::numeric_limits<int64_t>::min() / 2);
+        VAR misses = 0ll;
+        for (VAR i = 0_z; i < face_count * 3_z; ++i)
+        {
+            VAR& miss_time = miss_times[indices[i]];
+            if (misses - miss_time < static_cast<int64_t>(cache_size)) continue;
+            miss_time = misses++;
+        }
+        return static_cast<float>(misses) / static_cast<float>(face_count);
+    }
+
+    void optimize_face_order(std::vector<uint32_t>& indices, std::size_t vertex_count, int cache_size, std::size_t cluster_face_count)
+    {
+        // reorder each cluster
+        VAL face_count = indices.size() / 3_z;
+        VAL cluster_size = cluster_face_count > 0_z ? cluster_face_count : std::max(face_count, 1_z);
+        std::vector<uint32_t> local_ids(vertex_count, std::numeric_limits<uint32_t>::max());
+        std::vector<uint32_t> reordered(indices.size());
+        for (VAR begin = 0_z; begin < face_count; begin += cluster_size)
+        {
+            VAL count = std::min(cluster_size, face_count - begin);
+            ax::tipsify_faces(indices.data() + begin * 3_z, count, std::max(cache_size, 3), local_ids, reordered.data() + begin * 3_z);
+        }
+        std::copy(indices.begin() + face_count * 3_z, indices.end(), reordered.begin() + face_count * 3_z);
+        indices.swap(reordered);
+    }
+
+    void sort_faces_spatially(const std::vector<ax::basic_vertex>& vertices, std::vector<uint32_t>& indices)
+    {
+        // compute the bounds of the vertices
+        VAL face_count = indices.size() / 3_z;
+        if (face_count < 2_z) return;
+        VAL max = std::numeric_limits<float>::max();
+        VAR lower = ax::v3(max, max, max);
+        VAR upper = ax::v3(-max, -max, -max);
+        for (VAL& vertex : vertices)
+        {
+            VAL& position = vertex.position;
+            lower = ax::v3(std::min(lower.x, position.x), std::min(lower.y, position.y), std::min(lower.z, position.z));
+            upper = ax::v3(std::max(upper.x, position.x), std::max(upper.y, position.y), std::max(upper.z, position.z));
+        }
+
+        // key each face by the Morton code of its centroid quantized to 10 bits per axis
+        VAL quantize = [](float value, float lower, float upper)
+        {
+            VAL extent = upper - lower;
+            VAL unit = extent > 0.0f ? (value - lower) / extent : 0.0f;
+            return static_cast<uint32_t>(std::min(std::max(unit, 0.0f), 1.0f) * 1023.0f);
+        };
+        std::vector<std::pair<uint32_t, uint32_t>> keys(face_count);
+        for (VAR i = 0_z; i < face_count; ++i)
+        {
+            VAL face = indices.data() + i * 3_z;
+            VAL centroid = (vertices[face[0]].position + vertices[face[1]].position + vertices[face[2]].position) / 3.0f;
+            keys[i].first =
+                ax::spread_morton_bits(quantize(centroid.x, lower.x, upper.x)) |
+                ax::spread_morton_bits(quantize(centroid.y, lower.y, upper.y)) << 1 |
+                ax::spread_morton_bits(quantize(centroid.z, lower.z, upper.z)) << 2;
+            keys[i].second = static_cast<uint32_t>(i);
+        }
+
+        // sort, keeping faces with equal keys in their order
+        std::stable_sort(keys.begin(), keys.end(), [](const std::pair<uint32_t, uint32_t>& a, const std::pair<uint32_t, uint32_t>& b) { return a.first < b.first; });
+        std::vector<uint32_t> sorted(indices.size());
+        for (VAR i = 0_z; i < face_count; ++i) std::copy_n(indices.data() + keys[i].second * 3_z, 3_z, sorted.data() + i * 3_z);
+        std::copy(indices.begin() + face_count * 3_z, indices.end(), sorted.begin() + face_count * 3_z);
+        indices.swap(sorted);
+    }
+
+    std::vector<uint32_t> get_first_use_order(const std::vector<uint32_t>& indices, std::size_t vertex_count)
+    {
+        // number vertices as they're first used, then number the unused ones
+        std::vector<uint32_t> order(vertex_count, std::numeric_limits<uint32_t>::max());
+        VAR next = 0u;
+        for (VAL index : indices)
+            if (order[index] == std::numeric_limits<uint32_t>::max())
+                order[index] = next++;
+        for (VAR& position : order)
+            if (position == std::numeric_limits<uint32_t>::max())
+                position = next++;
+        return order;
+    }
+}
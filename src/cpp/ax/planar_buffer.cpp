@@ -0,0 +1,85 @@
+#include <algorithm>
+#include <fstream>
+#include <string>
+
+#include "ax/planar_buffer.hpp"
+
+#include "ax/string.hpp"
+
+namespace ax
+{
+    planar_buffer::planar_buffer() : planar_buffer(0, 0, ax::plane_all) { }
+
+    planar_buffer::planar_buffer(int w, int h, int planes) :
+        depths(),
+        normals(),
+        colors(),
+        planes(planes),
+        width(w),
+        height(h)
+    {
+        VAL length = ax::itoz(width * height);
+        if (has_planes(ax::plane_depth)) depths.resize(length);
+        if (has_planes(ax::plane_normal)) normals.resize(length);
+        if (has_planes(ax::plane_color)) colors.resize(length);
+    }
+
+    int planar_buffer::get_bytes_per_pixel() const
+    {
+        VAR bytes_per_pixel = 0;
+        if (has_planes(ax::plane_depth)) bytes_per_pixel += static_cast<int>(sizeof(float));
+        if (has_planes(ax::plane_normal)) bytes_per_pixel += static_cast<int>(sizeof(ax::v3));
+        if (has_planes(ax::plane_color)) bytes_per_pixel += static_cast<int>(sizeof(ax::color));
+        return bytes_per_pixel;
+    }
+
+    void planar_buffer::fill_depth(float depth)
+    {
+        std::fill(depths.begin(), depths.end(), depth);
+    }
+
+    void planar_buffer::fill_normal(const ax::v3& normal)
+    {
+        std::fill(normals.begin(), normals.end(), normal);
+    }
+
+    void planar_buffer::fill_color(const ax::color& color)
+    {
+        std::fill(colors.begin(), colors.end(), color);
+    }
+
+    void planar_buffer::fill(const ax::basic_pixel& pixel)
+    {
+        fill_depth(pixel.depth);
+        fill_normal(pixel.normal);
+        fill_color(pixel.color);
+    }
+
+    void planar_buffer::clear()
+    {
+        depths.clear();
+        normals.clear();
+        colors.clear();
+        width = 0;
+        height = 0;
+    }
+
+    ax::option<std::string> planar_buffer::try_write_to_tga(const char* file_path) const
+    {
+        // ensure there's something to write
+        if (!has_planes(ax::plane_color)) return ax::some("Can't write an ax::planar_buffer without a color plane to tga."_s);
+
+        // open file for writing
+        std::ofstream out;
+        out.open(file_path, std::ios::binary);
+        if (!out.is_open()) return ax::some("Can't open tga file "_s + file_path + " for saving an ax::planar_buffer.");
+
+        // write header, the color plane swizzled to bgra, and footer
+        VAL& header_error_opt = ax::basic_buffer::try_write_tga_header(width, height, out);
+        if (header_error_opt) return header_error_opt;
+        if (ax::basic_buffer::try_write_tga_colors(colors.data(), colors.size(), out) || ax::basic_buffer::try_write_tga_footer(out)) return ax::some("Failed to write to ax::planar_buffer to "_s + file_path + ".");
+
+        // success
+        return ax::none<std::string>();
+    }
+}
@@ -0,0 +1,124 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "ax/render_stats.hpp"
+
+#include "ax/math.hpp"
+
+namespace ax
+{
+    render_stats::render_stats() :
+        triangles_submitted(0ull),
+        triangles_backfacing(0ull),
+        triangles_degenerate(0ull),
+        triangles_offscreen(0ull),
+        pixels_tested(0ull),
+        depth_passes(0ull),
+        depth_fails(0ull),
+        vertex_time(0ull),
+        setup_time(0ull),
+        raster_time(0ull),
+        shade_time(0ull),
+        overdraw(),
+        width(0),
+        height(0)
+    { }
+
+    ax::render_counts render_stats::get_counts() const
+    {
+        return
+            { triangles_submitted.load(), triangles_backfacing.load(), triangles_degenerate.load(), triangles_offscreen.load(),
+              pixels_tested.load(), depth_passes.load(), depth_fails.load() };
+    }
+
+    ax::render_times render_stats::get_times() const
+    {
+        return { vertex_time.load(), setup_time.load(), raster_time.load(), shade_time.load() };
+    }
+
+    uint32_t render_stats::get_overdraw(int x, int y) const
+    {
+        if (x < 0 || y < 0 || x >= width || y >= height) throw std::out_of_range("ax::render_stats overdraw index out of range.");
+        return overdraw[ax::itoz(x + y * width)];
+    }
+
+    void render_stats::add(const ax::render_counts& counts)
+    {
+        triangles_submitted.fetch_add(counts.triangles_submitted, std::memory_order_relaxed);
+        triangles_backfacing.fetch_add(counts.triangles_backfacing, std::memory_order_relaxed);
+        triangles_degenerate.fetch_add(counts.triangles_degenerate, std::memory_order_relaxed);
+        triangles_offscreen.fetch_add(counts.triangles_offscreen, std::memory_order_relaxed);
+        pixels_tested.fetch_add(counts.pixels_tested, std::memory_order_relaxed);
+        depth_passes.fetch_add(counts.depth_passes, std::memory_order_relaxed);
+        depth_fails.fetch_add(counts.depth_fails, std::memory_order_relaxed);
+    }
+
+    void render_stats::add(const ax::render_times& times)
+    {
+        vertex_time.fetch_add(times.vertex, std::memory_order_relaxed);
+        setup_time.fetch_add(times.setup, std::memory_order_relaxed);
+        raster_time.fetch_add(times.raster, std::memory_order_relaxed);
+        shade_time.fetch_add(times.shade, std::memory_order_relaxed);
+    }
+
+    void render_stats::prepare(int width, int height)
+    {
+        if (width == this->width && height == this->height) return;
+        this->width = width;
+        this->height = height;
+        overdraw.assign(ax::itoz(width * height), 0u);
+    }
+
+    void render_stats::reset()
+    {
+        triangles_submitted = 0ull;
+        triangles_backfacing = 0ull;
+        triangles_degenerate = 0ull;
+        triangles_offscreen = 0ull;
+        pixels_tested = 0ull;
+        depth_passes = 0ull;
+        depth_fails = 0ull;
+        vertex_time = 0ull;
+        setup_time = 0ull;
+        raster_time = 0ull;
+        shade_time = 0ull;
+        std::fill(overdraw.begin(), overdraw.end(), 0u);
+    }
+
+    ax::basic_buffer render_stats::get_overdraw_heatmap() const
+    {
+        // ramp through blue, cyan, green, yellow and red
+        const ax::color ramp[] = { { 0, 0, 255, 255 }, { 0, 255, 255, 255 }, { 0, 255, 0, 255 }, { 255, 255, 0, 255 }, { 255, 0, 0, 255 } };
+        VAL count_max = overdraw.empty() ? 0u : *std::max_element(overdraw.begin(), overdraw.end());
+        ax::basic_buffer heatmap(width, height);
+        for (VAR j = 0; j < height; ++j)
+        {
+            for (VAR i = 0; i < width; ++i)
+            {
+                // place counts of one to the max along the ramp
+                VAL count = overdraw[ax::itoz(i + j * width)];
+                ax::color color(0, 0, 0, 255);
+                if (count > 0u)
+                {
+                    VAL position = count_max > 1u ? static_cast<float>(count - 1u) / static_cast<float>(count_max - 1u) * 4.0f : 0.0f;
+                    VAL index = std::min(3, static_cast<int>(position));
+                    VAL t = position - static_cast<float>(index);
+                    VAL& from = ramp[index];
+                    VAL& to = ramp[index + 1];
+                    color = ax::color(
+                        static_cast<uint8_t>(from.r + (to.r - from.r) * t),
+                        static_cast<uint8_t>(from.g + (to.g - from.g) * t),
+                        static_cast<uint8_t>(from.b + (to.b - from.b) * t),
+                        255);
+                }
+                heatmap.get_pixel_in_place(i, j).color = color;
+            }
+        }
+        return heatmap;
+    }
+
+    ax::option<std::string> render_stats::try_write_overdraw_to_tga(const char* file_path) const
+    {
+        return get_overdraw_heatmap().try_write_to_tga(file_path);
+    }
+}
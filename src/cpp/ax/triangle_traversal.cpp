@@ -0,0 +1,34 @@
+#include <cmath>
+
+#include "ax/triangle_traversal.hpp"
+
+namespace ax
+{
+    ax::triangle_edges make_triangle_edges(const ax::triangle2& triangle_screen)
+    {
+        // compute the signed area, rejecting only zero-area triangles
+        VAL& origin = std::get<0>(triangle_screen);
+        const ax::v2 vertices[] = { std::get<0>(triangle_screen), std::get<1>(triangle_screen), std::get<2>(triangle_screen) };
+        VAL& a = std::get<1>(triangle_screen) - origin;
+        VAL& b = std::get<2>(triangle_screen) - origin;
+        VAL area = a.x * b.y - a.y * b.x;
+        ax::triangle_edges edges{};
+        edges.origin = origin;
+        edges.degenerate = area == 0.0f || !std::isfinite(area);
+        if (edges.degenerate) return edges;
+
+        // set up each edge function to evaluate the weight of the vertex opposite it
+        VAL area_inverse = 1.0f / area;
+        for (VAR k = 0; k < 3; ++k)
+        {
+            VAL& start = vertices[(k + 1) % 3];
+            VAL& end = vertices[(k + 2) % 3];
+            VAL& delta = end - start;
+            VAL& start_relative = start - origin;
+            edges.steps_x[k] = -delta.y * area_inverse;
+            edges.steps_y[k] = delta.x * area_inverse;
+            edges.offsets[k] = (delta.y * start_relative.x - delta.x * start_relative.y) * area_inverse;
+        }
+        return edges;
+    }
+}
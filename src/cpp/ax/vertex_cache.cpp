@@ -0,0 +1,67 @@
+#include <algorithm>
+
+#include "ax/vertex_cache.hpp"
+
+namespace ax
+{
+    ax::screen_vertex get_screen_vertex(const ax::v3& position, int width, int height)
+    {
+        VAL& center_screen = ax::v2(static_cast<float>(width), static_cast<float>(height)) * 0.5f;
+        VAL& position_screen = (ax::get_ortho(position) + ax::one<ax::v2>()).SymMul(center_screen);
+        return { position_screen, position.z };
+    }
+
+    vertex_cache::vertex_cache() :
+        vertices(),
+        model_geometry_version(0ull),
+        width(0),
+        height(0)
+    { }
+
+    bool vertex_cache::get_current(const ax::basic_model& model, int width, int height) const
+    {
+        return
+            model_geometry_version == model.get_geometry_version() &&
+            this->width == width &&
+            this->height == height;
+    }
+
+    const std::vector<ax::screen_vertex>& vertex_cache::update(const ax::basic_model& model, int width, int height)
+    {
+        if (get_current(model, width, height)) return vertices;
+        this->width = width;
+        this->height = height;
+        vertices.resize(model.get_vertices().size());
+        transform(model, 0_z, vertices.size());
+        model_geometry_version = model.get_geometry_version();
+        return vertices;
+    }
+
+    const std::vector<ax::screen_vertex>& vertex_cache::update(const ax::basic_model& model, int width, int height, ax::worker_pool& pool)
+    {
+        // transform in chunks spread over the pool
+        constexpr VAR chunk_size = 4096_z;
+        if (get_current(model, width, height)) return vertices;
+        this->width = width;
+        this->height = height;
+        vertices.resize(model.get_vertices().size());
+        VAL chunk_count = (vertices.size() + chunk_size - 1_z) / chunk_size;
+        pool.parallel_for(chunk_count, [&](std::size_t chunk)
+        {
+            transform(model, chunk * chunk_size, std::min(vertices.size(), (chunk + 1_z) * chunk_size));
+        });
+        model_geometry_version = model.get_geometry_version();
+        return vertices;
+    }
+
+    void vertex_cache::invalidate()
+    {
+        model_geometry_version = 0ull;
+    }
+
+    void vertex_cache::transform(const ax::basic_model& model, std::size_t begin, std::size_t end)
+    {
+        VAL& model_vertices = model.get_vertices();
+        for (VAR i = begin; i < end; ++i) vertices[i] = ax::get_screen_vertex(model_vertices[i].position, width, height);
+    }
+}
@@ -0,0 +1,42 @@
+#include <stdexcept>
+
+#include "ax/visibility_buffer.hpp"
+
+namespace ax
+{
+    visibility_buffer::visibility_buffer() : visibility_buffer(0, 0) { }
+
+    visibility_buffer::visibility_buffer(int w, int h) :
+        samples(),
+        width(0),
+        height(0)
+    {
+        resize(w, h);
+    }
+
+    ax::visibility_sample& visibility_buffer::get_sample_in_place(int x, int y)
+    {
+        if (x < 0 || y < 0 || x >= width || y >= height) throw std::out_of_range("ax::visibility_buffer sample index out of range.");
+        return samples[ax::itoz(x + y * width)];
+    }
+
+    const ax::visibility_sample& visibility_buffer::get_sample(int x, int y) const
+    {
+        return const_cast<visibility_buffer*>(this)->get_sample_in_place(x, y);
+    }
+
+    void visibility_buffer::resize(int w, int h)
+    {
+        if (w == width && h == height) return;
+        width = w;
+        height = h;
+        samples.resize(ax::itoz(width * height));
+    }
+
+    void visibility_buffer::clear()
+    {
+        samples.clear();
+        width = 0;
+        height = 0;
+    }
+}
@@ -0,0 +1,115 @@
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+#include "ax/worker_pool.hpp"
+
+namespace ax
+{
+    worker_pool::worker_pool(std::size_t thread_count) :
+        threads(),
+        jobs(),
+        jobs_mutex(),
+        jobs_condition(),
+        stopping(false)
+    {
+        if (thread_count == 0_z) thread_count = std::max(1_z, static_cast<std::size_t>(std::thread::hardware_concurrency()));
+        threads.reserve(thread_count);
+        for (VAR i = 0_z; i < thread_count; ++i) threads.emplace_back([this]() { run(); });
+    }
+
+    worker_pool::~worker_pool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(jobs_mutex);
+            stopping = true;
+        }
+        jobs_condition.notify_all();
+        for (VAR& thread : threads) thread.join();
+    }
+
+    void worker_pool::parallel_for(std::size_t count, const std::function<void(std::size_t)>& fn)
+    {
+        // state shared with helper jobs that may only get to run after we've returned
+        struct state
+        {
+            std::atomic<std::size_t> next{0_z};
+            std::atomic<std::size_t> completed{0_z};
+            std::exception_ptr exception;
+            std::mutex mutex;
+            std::condition_variable condition;
+        };
+
+        // claim and run indices until none are left
+        VAL shared = std::make_shared<state>();
+        VAL fn_ptr = &fn;
+        VAL drain = [shared, fn_ptr, count]()
+        {
+            for (VAR i = shared->next++; i < count; i = shared->next++)
+            {
+                VAR retired = 1_z;
+                try
+                {
+                    (*fn_ptr)(i);
+                }
+                catch (...)
+                {
+                    // keep the first exception, then retire every index not yet handed out
+                    {
+                        std::lock_guard<std::mutex> lock(shared->mutex);
+                        if (!shared->exception) shared->exception = std::current_exception();
+                    }
+                    retired += count - std::min(shared->next.exchange(count), count);
+                }
+                if ((shared->completed += retired) == count)
+                {
+                    std::lock_guard<std::mutex> lock(shared->mutex);
+                    shared->condition.notify_all();
+                }
+            }
+        };
+
+        // enlist helpers and drain on this thread too
+        VAL helper_count = std::min(threads.size(), count > 0_z ? count - 1_z : 0_z);
+        for (VAR i = 0_z; i < helper_count; ++i) enqueue(drain);
+        drain();
+
+        // wait on indices claimed by helpers, then rethrow the first exception
+        std::unique_lock<std::mutex> lock(shared->mutex);
+        shared->condition.wait(lock, [&]() { return shared->completed.load() >= count; });
+        VAL exception = shared->exception;
+        lock.unlock();
+        if (exception) std::rethrow_exception(exception);
+    }
+
+    ax::worker_pool& worker_pool::get_default()
+    {
+        static ax::worker_pool pool;
+        return pool;
+    }
+
+    void worker_pool::enqueue(std::function<void()> job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(jobs_mutex);
+            jobs.push_back(std::move(job));
+        }
+        jobs_condition.notify_one();
+    }
+
+    void worker_pool::run()
+    {
+        while (true)
+        {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(jobs_mutex);
+                jobs_condition.wait(lock, [this]() { return stopping || !jobs.empty(); });
+                if (stopping && jobs.empty()) return;
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            job();
+        }
+    }
+}
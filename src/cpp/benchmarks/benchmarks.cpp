@@ -0,0 +1,363 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "ax/ax.hpp"
+
+#if !defined(AX_RENDER_STATS)
+    #error "The benchmarks time draw stages with render stats, so they need AX_RENDER_STATS defined."
+#endif
+
+namespace ax
+{
+    // The stages each run is timed over, in pipeline order. Load is the obj read (or for
+    // procedural scenes, reading the generated obj), write is the tga write, and the stages in
+    // between come from the render stats of a deferred draw.
+    static const char* const stage_names[] = { "load", "vertex", "setup", "raster", "shade", "write" };
+    constexpr std::size_t stage_count = sizeof(stage_names) / sizeof(stage_names[0]);
+
+    // A scene to render from an obj, either given or generated.
+    struct benchmark_scene
+    {
+        std::string name;
+        std::string file_path;
+    };
+
+    // The milliseconds each stage took on each run of a scene at one resolution.
+    struct benchmark_result
+    {
+        std::string scene_name;
+        int width;
+        int height;
+        int face_count;
+        std::array<std::vector<double>, ax::stage_count + 1_z> samples;
+    };
+
+    struct benchmark_summary
+    {
+        double mean;
+        double median;
+        double p99;
+    };
+
+    struct benchmark_options
+    {
+        int runs = 10;
+        int max_size = 7680;
+        int face_count = 1 << 20;
+        std::string model_file_path = "../../data/model.obj";
+        std::string json_file_path = "benchmarks.json";
+    };
+
+    static double get_milliseconds(std::chrono::steady_clock::duration duration)
+    {
+        return std::chrono::duration<double, std::milli>(duration).count();
+    }
+
+    static double get_milliseconds(uint64_t nanoseconds)
+    {
+        return static_cast<double>(nanoseconds) / 1000000.0;
+    }
+
+    static ax::benchmark_summary summarize(std::vector<double> samples)
+    {
+        // take the median and 99th percentile by nearest rank
+        if (samples.empty()) return { 0.0, 0.0, 0.0 };
+        std::sort(samples.begin(), samples.end());
+        VAR sum = 0.0;
+        for (VAL sample : samples) sum += sample;
+        VAL count = samples.size();
+        VAL median = count % 2_z ? samples[count / 2_z] : (samples[count / 2_z - 1_z] + samples[count / 2_z]) * 0.5;
+        VAL p99_rank = static_cast<std::size_t>(std::ceil(0.99 * static_cast<double>(count)));
+        return { sum / static_cast<double>(count), median, samples[std::max(1_z, p99_rank) - 1_z] };
+    }
+
+    // Write a mesh to an obj, winding each face so that its normal agrees with get_facing of its
+    // center - the draw functions cull faces whose normal points away from the viewer.
+    template<typename GetFacing>
+    static ax::option<std::string> try_write_obj(const char* file_path, const std::vector<ax::v3>& positions, const std::vector<ax::v2>& uvs, const std::vector<ax::v3>& normals, const std::vector<ax::v3i>& faces, GetFacing get_facing)
+    {
+        std::ofstream file(file_path);
+        if (!file) return ax::some("Could not open file "_s + file_path + " for writing.");
+        for (VAL& position : positions) file << "v " << position.x << " " << position.y << " " << position.z << "\n";
+        for (VAL& uv : uvs) file << "vt " << uv.x << " " << uv.y << "\n";
+        for (VAL& normal : normals) file << "vn " << normal.x << " " << normal.y << " " << normal.z << "\n";
+        for (VAL& face : faces)
+        {
+            VAL a = face.x + 1;
+            VAR b = face.y + 1;
+            VAR c = face.z + 1;
+            VAL& triangle = ax::triangle3(positions[ax::itoz(face.x)], positions[ax::itoz(face.y)], positions[ax::itoz(face.z)]);
+            VAL& center = (std::get<0>(triangle) + std::get<1>(triangle) + std::get<2>(triangle)) * (1.0f / 3.0f);
+            if (ax::get_normal(triangle) * get_facing(center) < 0.0f) std::swap(b, c);
+            file << "f " << a << "/" << a << "/" << a << " " << b << "/" << b << "/" << b << " " << c << "/" << c << "/" << c << "\n";
+        }
+        if (!file) return ax::some("Could not write file "_s + file_path + ".");
+        return ax::none<std::string>();
+    }
+
+    // Generate a finely tessellated sphere of about face_count faces. Half of its faces are
+    // culled, while the rest are mostly sub-pixel at small resolutions.
+    static ax::option<std::string> try_write_sphere_obj(const char* file_path, int face_count)
+    {
+        // compute a grid of twice as many segments as rings
+        VAL rings = std::max(2, static_cast<int>(std::sqrt(static_cast<float>(face_count) / 4.0f)));
+        VAL segments = rings * 2;
+        std::vector<ax::v3> positions;
+        std::vector<ax::v2> uvs;
+        std::vector<ax::v3> normals;
+        std::vector<ax::v3i> faces;
+        for (VAR r = 0; r <= rings; ++r)
+        {
+            for (VAR s = 0; s <= segments; ++s)
+            {
+                VAL u = static_cast<float>(s) / static_cast<float>(segments);
+                VAL v = static_cast<float>(r) / static_cast<float>(rings);
+                VAL theta = v * 3.14159265f;
+                VAL phi = u * 6.28318531f;
+                VAL& normal = ax::v3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+                positions.push_back(normal * 0.9f);
+                uvs.push_back(ax::v2(u, v));
+                normals.push_back(normal);
+            }
+        }
+        for (VAR r = 0; r < rings; ++r)
+        {
+            for (VAR s = 0; s < segments; ++s)
+            {
+                VAL a = r * (segments + 1) + s;
+                VAL b = a + segments + 1;
+                if (r > 0) faces.push_back(ax::v3i(a, b, a + 1));
+                if (r < rings - 1) faces.push_back(ax::v3i(a + 1, b, b + 1));
+            }
+        }
+        return ax::try_write_obj(file_path, positions, uvs, normals, faces, [](const ax::v3& center) { return center; });
+    }
+
+    // Generate eight stacked, rippled sheets of about face_count faces in total, all facing the
+    // viewer, so that every pixel is covered several times over.
+    static ax::option<std::string> try_write_layers_obj(const char* file_path, int face_count)
+    {
+        constexpr VAR layers = 8;
+        VAL cells = std::max(1, static_cast<int>(std::sqrt(static_cast<float>(face_count) / static_cast<float>(layers * 2))));
+        std::vector<ax::v3> positions;
+        std::vector<ax::v2> uvs;
+        std::vector<ax::v3> normals;
+        std::vector<ax::v3i> faces;
+        for (VAR l = 0; l < layers; ++l)
+        {
+            VAL first = ax::itoz(positions.size());
+            VAL depth = -0.8f + 1.6f * static_cast<float>(l) / static_cast<float>(layers - 1);
+            for (VAR j = 0; j <= cells; ++j)
+            {
+                for (VAR i = 0; i <= cells; ++i)
+                {
+                    VAL u = static_cast<float>(i) / static_cast<float>(cells);
+                    VAL v = static_cast<float>(j) / static_cast<float>(cells);
+                    VAL ripple = 0.05f * std::sin(u * 25.0f + static_cast<float>(l)) * std::cos(v * 25.0f);
+                    positions.push_back(ax::v3(u * 1.9f - 0.95f, v * 1.9f - 0.95f, depth + ripple));
+                    uvs.push_back(ax::v2(u, v));
+                    normals.push_back(ax::v3(0.0f, 0.0f, 1.0f));
+                }
+            }
+            for (VAR j = 0; j < cells; ++j)
+            {
+                for (VAR i = 0; i < cells; ++i)
+                {
+                    VAL a = ax::ztoi(first) + j * (cells + 1) + i;
+                    VAL c = a + cells + 1;
+                    faces.push_back(ax::v3i(a, a + 1, c + 1));
+                    faces.push_back(ax::v3i(a, c + 1, c));
+                }
+            }
+        }
+
+        return ax::try_write_obj(file_path, positions, uvs, normals, faces, [](const ax::v3&) { return ax::v3(0.0f, 0.0f, 1.0f); });
+    }
+
+    static ax::option<std::string> try_run_benchmark(const ax::benchmark_scene& scene, int width, int height, int runs, ax::worker_pool& pool, ax::benchmark_result& result)
+    {
+        // time each stage of each run, the draw's own stages coming from its stats
+        VAL& clear_pixel = ax::basic_pixel(std::numeric_limits<float>::lowest(), ax::zero<ax::v3>(), { 0, 0, 0, 255 });
+        VAL& light = ax::v3(0.0f, 0.0f, 1.0f);
+        VAL image_file_path = "benchmark.tga";
+        ax::basic_model model;
+        ax::basic_buffer target(width, height);
+        ax::render_stats stats;
+        result.scene_name = scene.name;
+        result.width = width;
+        result.height = height;
+        for (VAR& samples : result.samples) samples.clear();
+        for (VAR run = 0; run < runs; ++run)
+        {
+            // load
+            VAL load_start = std::chrono::steady_clock::now();
+            VAL read_error_opt = model.try_read_from_obj(scene.file_path.c_str(), pool);
+            if (read_error_opt) return ax::some("Could not load scene "_s + scene.name + " due to: " + *read_error_opt);
+            VAL load_time = ax::get_milliseconds(std::chrono::steady_clock::now() - load_start);
+
+            // render
+            target.fast_clear(clear_pixel);
+            stats.reset();
+            VAL render_start = std::chrono::steady_clock::now();
+            ax::draw_textured_ortho_deferred(light, model, target, 64, pool, nullptr, nullptr, &stats);
+            VAL render_time = ax::get_milliseconds(std::chrono::steady_clock::now() - render_start);
+            VAL& times = stats.get_times();
+            if (model.get_face_count() > 0 && stats.get_counts().triangles_submitted == 0ull)
+                return ax::some("Render stats are compiled out of the linked library; build it with AX_RENDER_STATS."_s);
+
+            // write
+            VAL write_start = std::chrono::steady_clock::now();
+            VAL write_error_opt = target.try_write_to_tga(image_file_path);
+            if (write_error_opt) return ax::some("Could not write scene "_s + scene.name + " due to: " + *write_error_opt);
+            VAL write_time = ax::get_milliseconds(std::chrono::steady_clock::now() - write_start);
+
+            // record the stages and their total
+            const double stage_times[] =
+                { load_time, ax::get_milliseconds(times.vertex), ax::get_milliseconds(times.setup),
+                  ax::get_milliseconds(times.raster), ax::get_milliseconds(times.shade), write_time };
+            for (VAR i = 0_z; i < ax::stage_count; ++i) result.samples[i].push_back(stage_times[i]);
+            result.samples[ax::stage_count].push_back(load_time + render_time + write_time);
+        }
+        result.face_count = model.get_face_count();
+        std::remove(image_file_path);
+        return ax::none<std::string>();
+    }
+
+    static void write_summary_json(std::ostream& stream, const ax::benchmark_summary& summary)
+    {
+        char text[128];
+        std::snprintf(text, sizeof(text), "{ \"mean_ms\": %.4f, \"median_ms\": %.4f, \"p99_ms\": %.4f }", summary.mean, summary.median, summary.p99);
+        stream << text;
+    }
+
+    static void write_json(std::ostream& stream, const ax::benchmark_options& options, std::size_t thread_count, const std::vector<ax::benchmark_result>& results)
+    {
+        stream << "{\n";
+        stream << "  \"runs\": " << options.runs << ",\n";
+        stream << "  \"threads\": " << thread_count << ",\n";
+        stream << "  \"results\": [\n";
+        for (VAR i = 0_z; i < results.size(); ++i)
+        {
+            VAL& result = results[i];
+            stream << "    {\n";
+            stream << "      \"scene\": \"" << result.scene_name << "\",\n";
+            stream << "      \"width\": " << result.width << ",\n";
+            stream << "      \"height\": " << result.height << ",\n";
+            stream << "      \"faces\": " << result.face_count << ",\n";
+            stream << "      \"stages\": {\n";
+            for (VAR j = 0_z; j < ax::stage_count; ++j)
+            {
+                stream << "        \"" << ax::stage_names[j] << "\": ";
+                ax::write_summary_json(stream, ax::summarize(result.samples[j]));
+                stream << (j + 1_z < ax::stage_count ? ",\n" : "\n");
+            }
+            stream << "      },\n";
+            stream << "      \"total\": ";
+            ax::write_summary_json(stream, ax::summarize(result.samples[ax::stage_count]));
+            stream << "\n    }" << (i + 1_z < results.size() ? ",\n" : "\n");
+        }
+        stream << "  ]\n";
+        stream << "}\n";
+    }
+
+    static void write_table_row(std::ostream& stream, const ax::benchmark_result& result)
+    {
+        // print the median of each stage
+        char text[256];
+        VAR length = std::snprintf(text, sizeof(text), "%-8s %5dx%-5d %9d", result.scene_name.c_str(), result.width, result.height, result.face_count);
+        for (VAL& samples : result.samples)
+            length += std::snprintf(text + length, sizeof(text) - ax::itoz(length), " %9.2f", ax::summarize(samples).median);
+        stream << text << std::endl;
+    }
+
+    static bool try_parse_options(int argc, char* argv[], ax::benchmark_options& options)
+    {
+        for (VAR i = 1; i < argc; ++i)
+        {
+            VAL has_value = i + 1 < argc;
+            if (std::strcmp(argv[i], "--runs") == 0 && has_value) options.runs = std::max(1, std::atoi(argv[++i]));
+            else if (std::strcmp(argv[i], "--max-size") == 0 && has_value) options.max_size = std::max(1, std::atoi(argv[++i]));
+            else if (std::strcmp(argv[i], "--faces") == 0 && has_value) options.face_count = std::max(2, std::atoi(argv[++i]));
+            else if (std::strcmp(argv[i], "--model") == 0 && has_value) options.model_file_path = argv[++i];
+            else if (std::strcmp(argv[i], "--json") == 0 && has_value) options.json_file_path = argv[++i];
+            else return false;
+        }
+        return true;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    // parse options
+    ax::benchmark_options options;
+    if (!ax::try_parse_options(argc, argv, options))
+    {
+        std::cerr << "usage: ax_benchmarks [--runs n] [--max-size pixels] [--faces n] [--model obj] [--json path]" << std::endl;
+        return 1;
+    }
+
+    // generate the procedural scenes
+    VAL sphere_file_path = "benchmark_sphere.obj";
+    VAL layers_file_path = "benchmark_layers.obj";
+    VAL sphere_error_opt = ax::try_write_sphere_obj(sphere_file_path, options.face_count);
+    VAL layers_error_opt = ax::try_write_layers_obj(layers_file_path, options.face_count);
+    if (sphere_error_opt || layers_error_opt)
+    {
+        std::cerr << (sphere_error_opt ? *sphere_error_opt : *layers_error_opt) << std::endl;
+        return 1;
+    }
+    const ax::benchmark_scene scenes[] =
+    {
+        { "model", options.model_file_path },
+        { "sphere", sphere_file_path },
+        { "layers", layers_file_path }
+    };
+
+    // run each scene at each resolution up to the max size
+    const ax::v2i sizes[] = { { 512, 512 }, { 1024, 1024 }, { 2048, 2048 }, { 4096, 4096 }, { 7680, 4320 } };
+    VAR& pool = ax::worker_pool::get_default();
+    std::vector<ax::benchmark_result> results;
+    std::cout << "scene    resolution       faces";
+    for (VAL stage_name : ax::stage_names) std::printf(" %9s", stage_name);
+    std::cout << "     total (median ms)" << std::endl;
+    VAR succeeded = true;
+    for (VAL& scene : scenes)
+    {
+        for (VAL& size : sizes)
+        {
+            if (std::max(size.x, size.y) > options.max_size) continue;
+            ax::benchmark_result result;
+            VAL error_opt = ax::try_run_benchmark(scene, size.x, size.y, options.runs, pool, result);
+            if (error_opt)
+            {
+                std::cerr << *error_opt << std::endl;
+                succeeded = false;
+                break;
+            }
+            ax::write_table_row(std::cout, result);
+            results.push_back(std::move(result));
+        }
+    }
+    std::remove(sphere_file_path);
+    std::remove(layers_file_path);
+
+    // write the results
+    std::ofstream json_file(options.json_file_path);
+    ax::write_json(json_file, options, pool.get_thread_count(), results);
+    if (!json_file)
+    {
+        std::cerr << "Could not write file " << options.json_file_path << "." << std::endl;
+        return 1;
+    }
+    return succeeded ? 0 : 1;
+}
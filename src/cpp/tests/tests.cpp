@@ -1,4 +1,8 @@
+#include <atomic>
+#include <cstdio>
+#include <fstream>
 #include <iostream>
+#include <stdexcept>
 
 #include "tom/tom.hpp"
 
@@ -278,6 +282,1317 @@ namespace ax
         std::cout << std::to_string(sizeof(ax::address)) << std::endl;
     }
 
+    TEST("parallel for stops on and rethrows the first exception")
+    {
+        // throw from one index, wherever it runs
+        ax::worker_pool pool(4_z);
+        std::atomic<std::size_t> invoked{0_z};
+        VAR threw = false;
+        try
+        {
+            pool.parallel_for(100000_z, [&](std::size_t i)
+            {
+                ++invoked;
+                if (i == 10_z) throw std::runtime_error("index 10");
+            });
+        }
+        catch (const std::runtime_error& error)
+        {
+            threw = std::string(error.what()) == "index 10";
+        }
+        CHECK(threw);
+        CHECK(invoked.load() < 100000_z);
+
+        // no invocation outlives the call, and the pool keeps working
+        VAL invoked_after = invoked.load();
+        std::atomic<std::size_t> sum{0_z};
+        pool.parallel_for(1000_z, [&](std::size_t i) { sum += i; });
+        CHECK(invoked.load() == invoked_after);
+        CHECK(sum.load() == 999_z * 1000_z / 2_z);
+    }
+
+    TEST("triangle traversal matches barycentric coverage")
+    {
+        // traverse a triangle's bounds
+        VAL& triangle = ax::triangle2(ax::v2(3.0f, 2.0f), ax::v2(27.5f, 9.0f), ax::v2(11.0f, 21.25f));
+        VAL& edges = ax::make_triangle_edges(triangle);
+        const float depths[] = { 0.0f, 1.0f, 2.0f };
+        VAL& bounds = ax::box2i(ax::v2i(0, 0), ax::v2i(31, 23));
+        VAR covered = std::vector<bool>(32 * 24, false);
+        VAR depths_match = true;
+        ax::traverse_triangle(edges, depths, ax::triangle2(), bounds, [&](const ax::traversal_block& block)
+        {
+            for (VAR lane = 0; lane < ax::traversal_width; ++lane)
+            {
+                if (block.mask & (1u << lane))
+                {
+                    VAL& point = ax::v2(static_cast<float>(block.x + lane), static_cast<float>(block.y));
+                    covered[ax::itoz(block.x + lane + block.y * 32)] = true;
+                    depths_match = depths_match && std::abs(block.depths[lane] - ax::get_depth(point, ax::triangle3(ax::v3(3.0f, 2.0f, 0.0f), ax::v3(27.5f, 9.0f, 1.0f), ax::v3(11.0f, 21.25f, 2.0f)))) < 0.001f;
+                }
+            }
+        });
+
+        // compare coverage against per-pixel barycentric tests
+        VAR coverage_matches = true;
+        for (VAR j = 0; j < 24; ++j)
+            for (VAR i = 0; i < 32; ++i)
+                coverage_matches = coverage_matches && covered[ax::itoz(i + j * 32)] == ax::get_in_bounds(ax::v2(static_cast<float>(i), static_cast<float>(j)), triangle);
+        CHECK(coverage_matches);
+        CHECK(depths_match);
+
+        // ensure small but non-degenerate triangles are still rasterized
+        VAR small_covered = false;
+        VAL& small_edges = ax::make_triangle_edges(ax::triangle2(ax::v2(4.0f, 4.0f), ax::v2(4.5f, 4.0f), ax::v2(4.0f, 4.5f)));
+        ax::traverse_triangle(small_edges, depths, ax::triangle2(), ax::box2i(ax::v2i(4, 4), ax::v2i(4, 4)), [&](const ax::traversal_block&) { small_covered = true; });
+        CHECK(!small_edges.degenerate);
+        CHECK(small_covered);
+    }
+
+    TEST("tiled rendering matches serial rendering")
+    {
+        // open model
+        ax::basic_model model;
+        model.try_read_from_obj("../../data/model.obj");
+
+        // render model serially and tiled
+        VAL& clear_pixel = ax::basic_pixel(std::numeric_limits<float>::lowest(), ax::zero<ax::v3>(), { 0, 0, 0, 255 });
+        VAL& light = ax::v3(0.0f, 0.0f, 1.0f);
+        ax::basic_buffer serial_target(200, 200);
+        ax::basic_buffer tiled_target(200, 200);
+        serial_target.fill(clear_pixel);
+        tiled_target.fill(clear_pixel);
+        ax::draw_textured_ortho(light, model, serial_target);
+        ax::draw_textured_ortho_tiled(light, model, tiled_target, 32);
+
+        // compare
+        VAR same = true;
+        for (VAR j = 0; j < 200; ++j)
+            for (VAR i = 0; i < 200; ++i)
+                same = same &&
+                    serial_target.get_pixel(i, j).depth == tiled_target.get_pixel(i, j).depth &&
+                    serial_target.get_pixel(i, j).color == tiled_target.get_pixel(i, j).color;
+        CHECK(same);
+    }
+
+    TEST("fast clears resolve lazily and match filling")
+    {
+        // open model
+        ax::basic_model model;
+        model.try_read_from_obj("../../data/model.obj");
+
+        // render over a filled target and fast-cleared ones, serially, tiled and with hierarchical depth
+        VAL& clear_pixel = ax::basic_pixel(std::numeric_limits<float>::lowest(), ax::zero<ax::v3>(), { 10, 20, 30, 255 });
+        VAL& light = ax::v3(0.0f, 0.0f, 1.0f);
+        ax::basic_buffer filled_target(203, 197);
+        ax::basic_buffer cleared_target(203, 197);
+        ax::basic_buffer tiled_target(203, 197);
+        filled_target.fill(clear_pixel);
+        cleared_target.fast_clear(clear_pixel);
+        tiled_target.fast_clear(clear_pixel);
+        CHECK(cleared_target.get_tile_cleared(0, 0));
+        CHECK(cleared_target.get_pixel(202, 196).color == clear_pixel.color);
+        ax::hierarchical_depth hierarchical_depth(203, 197);
+        hierarchical_depth.fill(clear_pixel.depth);
+        ax::draw_textured_ortho(light, model, filled_target);
+        ax::draw_textured_ortho(light, model, cleared_target);
+        ax::draw_textured_ortho_tiled(light, model, tiled_target, 20, &hierarchical_depth);
+
+        // corners are untouched while the middle got drawn
+        CHECK(cleared_target.get_tile_cleared(0, 0));
+        CHECK(!cleared_target.get_tile_cleared(12, 12));
+        CHECK(tiled_target.get_tile_cleared(25, 24));
+
+        // compare reads, then tga exports
+        VAR same = true;
+        for (VAR j = 0; j < 197; ++j)
+            for (VAR i = 0; i < 203; ++i)
+                same = same &&
+                    filled_target.get_pixel(i, j).depth == cleared_target.get_pixel(i, j).depth &&
+                    filled_target.get_pixel(i, j).color == cleared_target.get_pixel(i, j).color &&
+                    filled_target.get_pixel(i, j).color == tiled_target.get_pixel(i, j).color;
+        CHECK(same);
+        CHECK(!cleared_target.try_write_to_tga("clear_test.tga"));
+        ax::basic_buffer exported;
+        CHECK(!exported.try_read_from_tga("clear_test.tga"));
+        std::remove("clear_test.tga");
+        same = true;
+        for (VAR j = 0; j < 197; ++j)
+            for (VAR i = 0; i < 203; ++i)
+                same = same && exported.get_pixel(i, j).color == filled_target.get_pixel(i, j).color;
+        CHECK(same);
+
+        // resolving leaves nothing pending
+        cleared_target.resolve_clear();
+        CHECK(!cleared_target.get_clear_pending());
+        CHECK(!cleared_target.get_tile_cleared(0, 0));
+        CHECK(cleared_target.get_pixel(0, 0).color == clear_pixel.color);
+    }
+
+    TEST("deferred rendering matches forward rendering")
+    {
+        // open model
+        ax::basic_model model;
+        model.try_read_from_obj("../../data/model.obj");
+
+        // render model forward and deferred, reusing the visibility buffer over two frames
+        VAL& clear_pixel = ax::basic_pixel(std::numeric_limits<float>::lowest(), ax::zero<ax::v3>(), { 0, 0, 0, 255 });
+        VAL& light = ax::v3(0.0f, 0.0f, 1.0f);
+        ax::basic_buffer forward_target(203, 197);
+        ax::basic_buffer deferred_target(203, 197);
+        ax::planar_buffer planar_target(203, 197);
+        forward_target.fill(clear_pixel);
+        ax::draw_textured_ortho(light, model, forward_target);
+        ax::visibility_buffer visibility;
+        for (VAR frame = 0; frame < 2; ++frame)
+        {
+            deferred_target.fast_clear(clear_pixel);
+            ax::draw_textured_ortho_deferred(light, model, deferred_target, 24, &visibility);
+        }
+        planar_target.fill(clear_pixel);
+        ax::draw_textured_ortho_deferred(light, model, planar_target);
+        CHECK(visibility.get_width() == 203 && visibility.get_height() == 197);
+        CHECK(visibility.get_sample(0, 0).triangle == ax::visibility_buffer::no_triangle);
+        CHECK(visibility.get_sample(101, 98).triangle < ax::itoz(model.get_face_count()));
+
+        // compare
+        VAR depths_same = true;
+        VAR colors_same = true;
+        for (VAR j = 0; j < 197; ++j)
+        {
+            for (VAR i = 0; i < 203; ++i)
+            {
+                VAL& forward = forward_target.get_pixel(i, j);
+                VAL& deferred = deferred_target.get_pixel(i, j);
+                depths_same = depths_same && forward.depth == deferred.depth && forward.depth == planar_target.get_depth_plane()[i + j * 203];
+                colors_same = colors_same && forward.color == deferred.color && forward.color == planar_target.get_color_plane()[i + j * 203];
+            }
+        }
+        CHECK(depths_same);
+        CHECK(colors_same);
+    }
+
+    TEST("clipped lines and deduplicated wireframes match unclipped drawing")
+    {
+        // draw lines running on and off a small buffer both ways, comparing colors
+        VAL& clear_pixel = ax::basic_pixel(0.0f, ax::zero<ax::v3>(), { 0, 0, 0, 255 });
+        VAL& white = ax::color(255, 255, 255, 255);
+        VAR same = true;
+        VAR seed = 12345u;
+        VAL next = [&](int range) { seed = seed * 1103515245u + 12345u; return static_cast<int>((seed >> 16) % static_cast<unsigned int>(range)) - range / 3; };
+        for (VAR line = 0; line < 400; ++line)
+        {
+            ax::basic_buffer plain(50, 40);
+            ax::basic_buffer clipped(50, 40);
+            plain.fill(clear_pixel);
+            clipped.fast_clear(clear_pixel);
+            VAL x = next(150), y = next(120), x2 = next(150), y2 = next(120);
+            ax::draw_line(white, x, y, x2, y2, plain);
+            ax::draw_line_clipped(white, x, y, x2, y2, clipped);
+            for (VAR j = 0; j < 40; ++j)
+                for (VAR i = 0; i < 50; ++i)
+                    same = same && plain.get_pixel(i, j).color == clipped.get_pixel(i, j).color;
+        }
+        CHECK(same);
+
+        // draw a model's wireframe a face at a time and deduplicated
+        ax::basic_model model;
+        model.try_read_from_obj("../../data/model.obj");
+        ax::basic_buffer faces_target(300, 300);
+        ax::basic_buffer edges_target(300, 300);
+        faces_target.fill(clear_pixel);
+        edges_target.fill(clear_pixel);
+        for (VAR i = 0; i < model.get_face_count(); ++i)
+            ax::draw_wired_ortho(white, ax::get_ortho(ax::triangle3(model.get_position(i, 0), model.get_position(i, 1), model.get_position(i, 2))), faces_target);
+        ax::edge_list edges;
+        ax::draw_wired_ortho(white, model, edges_target, &edges);
+        CHECK(edges.get_current(model));
+        CHECK(edges.get_edges().size() < ax::itoz(model.get_face_count()) * 2_z);
+        same = true;
+        for (VAR j = 0; j < 300; ++j)
+            for (VAR i = 0; i < 300; ++i)
+                same = same && faces_target.get_pixel(i, j).color == edges_target.get_pixel(i, j).color;
+        CHECK(same);
+    }
+
+    TEST("render stats count draws only when enabled")
+    {
+        // open model
+        ax::basic_model model;
+        model.try_read_from_obj("../../data/model.obj");
+
+        // render serially, tiled and deferred, each into its own stats
+        VAL& clear_pixel = ax::basic_pixel(std::numeric_limits<float>::lowest(), ax::zero<ax::v3>(), { 0, 0, 0, 255 });
+        VAL& light = ax::v3(0.0f, 0.0f, 1.0f);
+        ax::basic_buffer target(200, 200);
+        ax::render_stats serial_stats;
+        ax::render_stats tiled_stats;
+        ax::render_stats deferred_stats;
+        target.fill(clear_pixel);
+        ax::draw_textured_ortho(light, model, target, nullptr, nullptr, &serial_stats);
+        target.fill(clear_pixel);
+        ax::draw_textured_ortho_tiled(light, model, target, 32, nullptr, nullptr, &tiled_stats);
+        target.fill(clear_pixel);
+        ax::draw_textured_ortho_deferred(light, model, target, 64, nullptr, nullptr, &deferred_stats);
+
+        // compare stage times and counts
+        VAL& serial = serial_stats.get_counts();
+        VAL& tiled = tiled_stats.get_counts();
+        VAL& deferred = deferred_stats.get_counts();
+#if defined(AX_RENDER_STATS)
+        VAL& deferred_times = deferred_stats.get_times();
+        CHECK(deferred_times.setup > 0ull && deferred_times.raster > 0ull && deferred_times.shade > 0ull);
+        CHECK(serial_stats.get_times().raster > 0ull && serial_stats.get_times().shade == 0ull);
+        CHECK(serial.triangles_submitted == ax::itoz(model.get_face_count()));
+        CHECK(serial.triangles_backfacing > 0ull && serial.triangles_backfacing < serial.triangles_submitted);
+        CHECK(serial.pixels_tested == serial.depth_passes + serial.depth_fails);
+        CHECK(serial.depth_fails > 0ull);
+        CHECK(tiled.triangles_backfacing == serial.triangles_backfacing && tiled.pixels_tested == serial.pixels_tested && tiled.depth_passes == serial.depth_passes);
+        CHECK(deferred.pixels_tested == serial.pixels_tested && deferred.depth_passes == serial.depth_passes);
+
+        // check overdraw sums to the depth passes, then export its heatmap
+        VAR overdraw_total = 0ull;
+        for (VAR j = 0; j < 200; ++j)
+            for (VAR i = 0; i < 200; ++i)
+                overdraw_total += serial_stats.get_overdraw(i, j);
+        CHECK(overdraw_total == serial.depth_passes);
+        CHECK(serial_stats.get_overdraw_heatmap().get_pixel(0, 0).color == ax::color(0, 0, 0, 255));
+        CHECK(!serial_stats.try_write_overdraw_to_tga("overdraw_test.tga"));
+        std::remove("overdraw_test.tga");
+        serial_stats.reset();
+        CHECK(serial_stats.get_counts().pixels_tested == 0ull && serial_stats.get_overdraw(100, 100) == 0u);
+#else
+        CHECK(serial.triangles_submitted == 0ull && tiled.pixels_tested == 0ull && deferred.depth_passes == 0ull);
+        CHECK(deferred_stats.get_times().raster == 0ull && serial_stats.get_width() == 0);
+#endif
+    }
+
+    TEST("frame pipelines write frames in order behind rendering")
+    {
+        // render frames faster than a slow writer can keep up with, checking that no buffer is
+        // reused before its frame is written
+        ax::frame_pipeline pipeline(16, 16, 2);
+        std::vector<int> written;
+        for (VAR i = 0; i < 6; ++i)
+        {
+            VAR& buffer = pipeline.acquire();
+            CHECK(&pipeline.acquire() == &buffer);
+            buffer.fill(ax::basic_pixel(0.0f, ax::zero<ax::v3>(), ax::color(static_cast<uint8_t>(i), 0, 0, 255)));
+            pipeline.submit([&written](const ax::basic_buffer& frame)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                written.push_back(frame.get_pixel(15, 15).color.r);
+                return ax::none<std::string>();
+            });
+        }
+        CHECK(!pipeline.flush());
+        CHECK(written == std::vector<int>({ 0, 1, 2, 3, 4, 5 }));
+
+        // write a frame as a tga
+        VAR& buffer = pipeline.acquire();
+        buffer.fill(ax::basic_pixel(0.0f, ax::zero<ax::v3>(), ax::color(10, 20, 30, 255)));
+        pipeline.submit(std::string("frame_pipeline_test.tga"));
+        CHECK(!pipeline.flush());
+        ax::basic_buffer read;
+        CHECK(!read.try_read_from_tga("frame_pipeline_test.tga"));
+        CHECK(read.get_width() == 16 && read.get_pixel(3, 7).color == ax::color(10, 20, 30, 255));
+        std::remove("frame_pipeline_test.tga");
+
+        // report the first error once
+        pipeline.acquire();
+        pipeline.submit([](const ax::basic_buffer&) { return ax::some<std::string>("first"); });
+        pipeline.acquire();
+        pipeline.submit([](const ax::basic_buffer&) { return ax::some<std::string>("second"); });
+        VAL& error_opt = pipeline.flush();
+        CHECK(error_opt && *error_opt == "first");
+        CHECK(!pipeline.flush());
+
+        // and report a throwing writer without losing the pipeline
+        pipeline.acquire();
+        pipeline.submit([](const ax::basic_buffer&) -> ax::option<std::string> { throw std::runtime_error("disk full"); });
+        VAL& thrown_error_opt = pipeline.flush();
+        CHECK(thrown_error_opt && (*thrown_error_opt).find("disk full") != std::string::npos);
+        pipeline.acquire();
+        pipeline.submit([](const ax::basic_buffer&) { return ax::none<std::string>(); });
+        CHECK(!pipeline.flush());
+    }
+
+    TEST("planar rendering matches basic rendering")
+    {
+        // open model
+        ax::basic_model model;
+        model.try_read_from_obj("../../data/model.obj");
+
+        // render model to a basic target, a full planar target, and a depth and color planar target
+        VAL& clear_pixel = ax::basic_pixel(std::numeric_limits<float>::lowest(), ax::zero<ax::v3>(), { 0, 0, 0, 255 });
+        VAL& light = ax::v3(0.0f, 0.0f, 1.0f);
+        ax::basic_buffer basic_target(200, 200);
+        ax::planar_buffer planar_target(200, 200);
+        ax::planar_buffer depth_color_target(200, 200, ax::plane_depth | ax::plane_color);
+        basic_target.fill(clear_pixel);
+        planar_target.fill(clear_pixel);
+        depth_color_target.fill(clear_pixel);
+        ax::draw_textured_ortho(light, model, basic_target);
+        ax::draw_textured_ortho(light, model, planar_target);
+        ax::draw_textured_ortho_tiled(light, model, depth_color_target, 32);
+
+        // compare
+        VAR same = true;
+        for (VAR j = 0; j < 200; ++j)
+        {
+            for (VAR i = 0; i < 200; ++i)
+            {
+                VAL& pixel = basic_target.get_pixel(i, j);
+                VAL index = i + j * 200;
+                same = same &&
+                    pixel.depth == planar_target.get_depth_plane()[index] &&
+                    pixel.normal == planar_target.get_normal_plane()[index] &&
+                    pixel.color == planar_target.get_color_plane()[index] &&
+                    pixel.color == depth_color_target.get_color_plane()[index];
+            }
+        }
+        CHECK(same);
+        CHECK(depth_color_target.get_bytes_per_pixel() == 8);
+        CHECK(!depth_color_target.has_planes(ax::plane_normal));
+
+        // write the color plane to tga, reading back what the basic target would write, up to
+        // the largest size a tga can hold
+        ax::basic_buffer read;
+        CHECK(!depth_color_target.try_write_to_tga("planar_test.tga"));
+        CHECK(!read.try_read_from_tga("planar_test.tga"));
+        VAR read_same = read.get_width() == 200 && read.get_height() == 200;
+        for (VAR j = 0; read_same && j < 200; ++j)
+            for (VAR i = 0; i < 200; ++i)
+                read_same = read_same && read.get_pixel(i, j).color == basic_target.get_pixel(i, j).color;
+        CHECK(read_same);
+        CHECK(!ax::planar_buffer(40000, 1, ax::plane_color).try_write_to_tga("planar_test.tga"));
+        CHECK(!read.try_read_from_tga("planar_test.tga") && read.get_width() == 40000);
+        CHECK(ax::planar_buffer(70000, 1, ax::plane_color).try_write_to_tga("planar_test.tga"));
+        std::remove("planar_test.tga");
+    }
+
+    TEST("hierarchical depth rendering matches plain rendering")
+    {
+        // open model
+        ax::basic_model model;
+        model.try_read_from_obj("../../data/model.obj");
+
+        // render model plainly, then serially and tiled with hierarchical depth, drawing the
+        // latter twice so that the second pass is mostly rejected
+        VAL& clear_pixel = ax::basic_pixel(std::numeric_limits<float>::lowest(), ax::zero<ax::v3>(), { 0, 0, 0, 255 });
+        VAL& light = ax::v3(0.0f, 0.0f, 1.0f);
+        ax::basic_buffer plain_target(200, 200);
+        ax::basic_buffer serial_target(200, 200);
+        ax::basic_buffer tiled_target(200, 200);
+        ax::hierarchical_depth serial_depth(200, 200);
+        ax::hierarchical_depth tiled_depth(200, 200);
+        plain_target.fill(clear_pixel);
+        serial_target.fill(clear_pixel);
+        tiled_target.fill(clear_pixel);
+        serial_depth.fill(clear_pixel.depth);
+        tiled_depth.fill(clear_pixel.depth);
+        ax::draw_textured_ortho(light, model, plain_target);
+        ax::draw_textured_ortho(light, model, serial_target, &serial_depth);
+        ax::draw_textured_ortho(light, model, serial_target, &serial_depth);
+        ax::draw_textured_ortho_tiled(light, model, tiled_target, 20, &tiled_depth);
+        ax::draw_textured_ortho_tiled(light, model, tiled_target, 20, &tiled_depth);
+
+        // compare
+        VAR same = true;
+        for (VAR j = 0; j < 200; ++j)
+        {
+            for (VAR i = 0; i < 200; ++i)
+            {
+                VAL& pixel = plain_target.get_pixel(i, j);
+                VAL& serial_pixel = serial_target.get_pixel(i, j);
+                VAL& tiled_pixel = tiled_target.get_pixel(i, j);
+                same = same &&
+                    pixel.depth == serial_pixel.depth && pixel.color == serial_pixel.color &&
+                    pixel.depth == tiled_pixel.depth && pixel.color == tiled_pixel.color;
+            }
+        }
+        CHECK(same);
+        CHECK(serial_depth.get_width() == 25);
+
+        // ensure rebuilt blocks bound their pixels
+        serial_depth.rebuild(serial_target);
+        VAL& center = serial_target.get_pixel(100, 100);
+        CHECK(serial_depth.get_min(12, 12) <= center.depth && center.depth <= serial_depth.get_max(12, 12));
+
+        // ensure a hierarchy refuses targets it wasn't sized for, or that have no depths
+        VAR mismatch_threw = false;
+        VAR no_depth_threw = false;
+        try { serial_depth.rebuild(ax::basic_buffer(201, 200)); }
+        catch (const std::invalid_argument&) { mismatch_threw = true; }
+        try { serial_depth.rebuild(ax::planar_buffer(200, 200, ax::plane_color)); }
+        catch (const std::invalid_argument&) { no_depth_threw = true; }
+        CHECK(mismatch_threw && no_depth_threw);
+    }
+
+    TEST("models load as welded indexed triangles")
+    {
+        // open model
+        ax::basic_model model;
+        model.try_read_from_obj("../../data/model.obj");
+        VAL& vertices = model.get_vertices();
+        VAL& indices = model.get_indices();
+        CHECK(model.get_face_count() > 0);
+        CHECK(indices.size() == ax::itoz(model.get_face_count()) * 3_z);
+        CHECK(vertices.size() < indices.size());
+
+        // ensure every index is in range and the unwelded views agree with the vertices
+        VAR valid = true;
+        for (VAL index : indices) valid = valid && index < vertices.size();
+        VAL& faces = model.get_faces();
+        VAL& positions = model.get_positions();
+        VAL& uvs = model.get_uvs();
+        CHECK(faces.size() == indices.size() / 3_z);
+        CHECK(positions.size() == vertices.size() && uvs.size() == vertices.size());
+        for (VAR i = 0_z; i < faces.size(); ++i)
+        {
+            for (VAR k = 0_z; k < 3_z; ++k)
+            {
+                VAL& corner = faces[i][k];
+                valid = valid &&
+                    ax::itoz(corner.x) == indices[i * 3_z + k] &&
+                    positions[ax::itoz(corner.x)] == model.get_position(ax::ztoi(i), ax::ztoi(k)) &&
+                    uvs[ax::itoz(corner.y)] == model.get_uv(ax::ztoi(i), ax::ztoi(k));
+            }
+        }
+        CHECK(valid);
+        CHECK(model.get_face(0)[1] == static_cast<int>(indices[1]));
+    }
+
+    TEST("obj loading handles corner forms, relative indices and chunking")
+    {
+        // write and read a small obj mixing corner forms
+        {
+            std::ofstream out("obj_test.obj", std::ios::binary);
+            out << "# comment\nv 0 0 0\nv 1.5e0 0 -0.25\r\nv 0 1 0\nv 1 1 0\nvt 0 0\nvt 1 0\nvt 0 1\nvn 0 0 1\n";
+            out << "f 1/1/1 2/2/1 3/3/1\nf -3/-2/-1 -1/-1/-1 -2/-3/-1\nf 1 2 4 3\n";
+        }
+        ax::basic_model model;
+        CHECK(!model.try_read_from_obj("obj_test.obj"));
+        CHECK(model.get_face_count() == 4);
+        CHECK(model.get_position(0, 1) == ax::v3(1.5f, 0.0f, -0.25f));
+        CHECK(model.get_face(1) == std::vector<int>({ 1, 3, 4 }));
+        CHECK(model.get_position(1, 1) == ax::v3(1.0f, 1.0f, 0.0f) && model.get_position(1, 2) == ax::v3(0.0f, 1.0f, 0.0f));
+        CHECK(model.get_uv(1, 2) == ax::v2(0.0f, 0.0f));
+        CHECK(model.get_indices()[6] != model.get_indices()[0] && model.get_normal(2, 0) == ax::zero<ax::v3>());
+
+        // write and read an obj big enough to be split into chunks, using only relative indices
+        VAL face_count = 30000;
+        {
+            std::ofstream out("obj_test.obj", std::ios::binary);
+            for (VAR i = 0; i < face_count; ++i)
+                out << "v " << i << " 0 0\nv " << i << " 1 0\nv " << i << " 0 1\nvt 0.5 0.25\nf -3/-1 -2/-1 -1/-1\n";
+        }
+        CHECK(!model.try_read_from_obj("obj_test.obj"));
+        CHECK(model.get_face_count() == face_count);
+        VAR same = true;
+        for (VAR i = 0; i < face_count; ++i)
+        {
+            VAL x = static_cast<float>(i);
+            same = same &&
+                model.get_position(i, 0) == ax::v3(x, 0.0f, 0.0f) &&
+                model.get_position(i, 1) == ax::v3(x, 1.0f, 0.0f) &&
+                model.get_position(i, 2) == ax::v3(x, 0.0f, 1.0f) &&
+                model.get_uv(i, 0) == ax::v2(0.5f, 0.25f);
+        }
+        CHECK(same);
+
+        // malformed faces are reported by line, whether too small, zero or out of range
+        for (VAL& face : { "f 1 2"_s, "f 0 1 2"_s, "f 1 2 9"_s, "f 1/4 2 3"_s, "f -4 1 2"_s, "f 1 2 x"_s })
+        {
+            {
+                std::ofstream out("obj_test.obj", std::ios::binary);
+                out << "v 0 0 0\nv 1 0 0\nv 0 1 0\nvt 0 0\nf 1 2 3\n" << face << "\nf 1 2 3\n";
+            }
+            VAL& error_opt = model.try_read_from_obj("obj_test.obj");
+            CHECK(error_opt && (*error_opt).find("line 6 ") != std::string::npos);
+            CHECK(model.get_face_count() == 0);
+        }
+
+        // even deep into a chunked obj
+        {
+            std::ofstream out("obj_test.obj", std::ios::binary);
+            for (VAR i = 0; i < face_count; ++i)
+                out << "v " << i << " 0 0\nv " << i << " 1 0\nv " << i << " 0 1\nvt 0.5 0.25\n" << (i == face_count - 2 ? "f -3/-1 -2/-1\n" : "f -3/-1 -2/-1 -1/-1\n");
+        }
+        VAL& error_opt = model.try_read_from_obj("obj_test.obj");
+        CHECK(error_opt && (*error_opt).find("line " + std::to_string(face_count * 5 - 5) + " ") != std::string::npos);
+        std::remove("obj_test.obj");
+        CHECK(model.try_read_from_obj("obj_test.obj"));
+    }
+
+    TEST("binary models round trip and cache objs")
+    {
+        // open model, then round trip it through the binary format
+        ax::basic_model model;
+        model.try_read_from_obj("../../data/model.obj");
+        CHECK(!model.try_write_to_binary("model_test.axmesh"));
+        ax::basic_model model_binary;
+        CHECK(!model_binary.try_read_from_binary("model_test.axmesh"));
+        CHECK(model_binary.get_indices() == model.get_indices());
+        CHECK(model_binary.get_vertices().size() == model.get_vertices().size());
+        CHECK(std::memcmp(model_binary.get_vertices().data(), model.get_vertices().data(), model.get_vertices().size() * sizeof(ax::basic_vertex)) == 0);
+        std::remove("model_test.axmesh");
+        CHECK(model_binary.try_read_from_binary("model_test.axmesh"));
+        CHECK(model_binary.try_read_from_binary("../../data/model.obj"));
+
+        // read through the cache twice, first writing then reading it, each time getting the
+        // same geometry as reading the obj
+        VAL& binary_path = ax::basic_model::get_binary_path("../../data/model.obj");
+        CHECK(binary_path == "../../data/model.axmesh");
+        std::remove(binary_path.c_str());
+        ax::basic_model model_cached;
+        CHECK(!model_cached.try_read_from_obj_cached("../../data/model.obj"));
+        CHECK(std::ifstream(binary_path).good());
+        CHECK(!model_cached.try_read_from_obj_cached("../../data/model.obj"));
+        CHECK(model_cached.get_indices() == model.get_indices());
+        CHECK(std::memcmp(model_cached.get_vertices().data(), model.get_vertices().data(), model.get_vertices().size() * sizeof(ax::basic_vertex)) == 0);
+        CHECK(model_cached.get_surface().get_diffuse_map().get_width() == model.get_surface().get_diffuse_map().get_width());
+        std::remove(binary_path.c_str());
+    }
+
+    TEST("model order optimization improves vertex reuse and keeps faces")
+    {
+        // open model, then shuffle its faces as a scan might leave them
+        ax::basic_model model;
+        model.try_read_from_obj("../../data/model.obj");
+        VAL& positions = model.get_positions();
+        VAL& uvs = model.get_uvs();
+        VAL& normals = model.get_normals();
+        std::vector<ax::v3i> corners;
+        for (VAL index : model.get_indices()) corners.push_back(ax::v3i(static_cast<int>(index)));
+        std::vector<std::size_t> shuffle(ax::itoz(model.get_face_count()));
+        for (VAR i = 0_z; i < shuffle.size(); ++i) shuffle[i] = (i * 7919_z) % shuffle.size();
+        std::vector<ax::v3i> shuffled_corners;
+        for (VAL face : shuffle) shuffled_corners.insert(shuffled_corners.end(), corners.begin() + face * 3_z, corners.begin() + face * 3_z + 3_z);
+        model.set_geometry(positions, uvs, normals, shuffled_corners);
+        VAL shuffled_ratio = ax::get_vertex_cache_miss_ratio(model.get_indices(), model.get_vertices().size());
+
+        // collects each face's corner vertices, as wound, in a sorted list
+        VAL get_faces = [](const ax::basic_model& model)
+        {
+            std::vector<std::vector<float>> faces;
+            VAL& indices = model.get_indices();
+            VAL& vertices = model.get_vertices();
+            for (VAR i = 0_z; i < indices.size(); i += 3_z)
+            {
+                std::vector<float> face;
+                for (VAR k = 0_z; k < 3_z; ++k)
+                {
+                    VAL& vertex = vertices[indices[i + k]];
+                    face.insert(face.end(), { vertex.position.x, vertex.position.y, vertex.position.z, vertex.uv.x, vertex.uv.y, vertex.normal.x, vertex.normal.y, vertex.normal.z });
+                }
+                faces.push_back(face);
+            }
+            std::sort(faces.begin(), faces.end());
+            return faces;
+        };
+        VAL& shuffled_faces = get_faces(model);
+
+        // optimize both ways, each time reusing vertices far more while keeping every face
+        for (VAL spatial_sort : { false, true })
+        {
+            ax::basic_model optimized;
+            optimized.set_geometry(positions, uvs, normals, shuffled_corners);
+            optimized.optimize_order(spatial_sort);
+            VAL ratio = ax::get_vertex_cache_miss_ratio(optimized.get_indices(), optimized.get_vertices().size());
+            CHECK(ratio < shuffled_ratio * 0.5f && ratio < 1.0f);
+            CHECK(get_faces(optimized) == shuffled_faces);
+
+            // and vertices are numbered by first use
+            VAR next = 0u;
+            VAR first_use = true;
+            for (VAL index : optimized.get_indices())
+            {
+                first_use = first_use && index <= next;
+                if (index == next) ++next;
+            }
+            CHECK(first_use);
+        }
+
+        // the miss ratio spans from full reuse to none
+        CHECK(ax::get_vertex_cache_miss_ratio({ 0u, 1u, 2u, 0u, 1u, 2u }, 3_z) == 1.5f);
+        CHECK(ax::get_vertex_cache_miss_ratio({ 0u, 1u, 2u, 3u, 4u, 5u }, 6_z) == 3.0f);
+    }
+
+    TEST("vertex cache transforms each vertex once and stays current")
+    {
+        // open model
+        ax::basic_model model;
+        model.try_read_from_obj("../../data/model.obj");
+
+        // run the vertex stage serially and in parallel
+        ax::vertex_cache cache;
+        ax::vertex_cache cache_parallel;
+        CHECK(!cache.get_current(model, 200, 100));
+        VAL& vertices = cache.update(model, 200, 100);
+        VAL& vertices_parallel = cache_parallel.update(model, 200, 100, ax::worker_pool::get_default());
+        CHECK(vertices.size() == model.get_vertices().size());
+        CHECK(cache.get_current(model, 200, 100));
+        CHECK(!cache.get_current(model, 100, 100));
+        VAR same = true;
+        for (VAR i = 0_z; i < vertices.size(); ++i)
+        {
+            VAL& expected = ax::get_screen_vertex(model.get_vertices()[i].position, 200, 100);
+            same = same &&
+                vertices[i].position == expected.position && vertices[i].depth == expected.depth &&
+                vertices_parallel[i].position == expected.position;
+        }
+        CHECK(same);
+
+        // render with the cache across frames, comparing to rendering without it
+        VAL& clear_pixel = ax::basic_pixel(std::numeric_limits<float>::lowest(), ax::zero<ax::v3>(), { 0, 0, 0, 255 });
+        VAL& light = ax::v3(0.0f, 0.0f, 1.0f);
+        ax::basic_buffer plain_target(200, 200);
+        ax::basic_buffer cached_target(200, 200);
+        plain_target.fill(clear_pixel);
+        ax::draw_textured_ortho(light, model, plain_target);
+        for (VAR frame = 0; frame < 2; ++frame)
+        {
+            cached_target.fill(clear_pixel);
+            ax::draw_textured_ortho_tiled(light, model, cached_target, 32, nullptr, &cache);
+        }
+        CHECK(cache.get_current(model, 200, 200));
+        same = true;
+        for (VAR j = 0; j < 200; ++j)
+            for (VAR i = 0; i < 200; ++i)
+                same = same && plain_target.get_pixel(i, j).color == cached_target.get_pixel(i, j).color;
+        CHECK(same);
+    }
+
+    TEST("caches notice a model reloaded with the same counts")
+    {
+        // write two objs with the same vertex and face counts but different positions and faces
+        {
+            std::ofstream a("reload_a.obj");
+            a << "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nf 1 2 3\nf 1 3 4\n";
+            std::ofstream b("reload_b.obj");
+            b << "v 0.5 0 0\nv 0 0.5 0\nv -0.5 0 0\nv 0 -0.5 0\nf 1 2 4\nf 2 3 4\n";
+        }
+
+        // run the vertex stage on one, then reload the other into the same model
+        ax::basic_model model;
+        model.try_read_from_obj("reload_a.obj");
+        ax::vertex_cache cache;
+        ax::edge_list edges;
+        cache.update(model, 100, 100);
+        edges.update(model);
+        model.try_read_from_obj("reload_b.obj");
+        CHECK(model.get_vertices().size() == cache.get_vertices().size());
+        CHECK(!cache.get_current(model, 100, 100));
+        VAL& vertices = cache.update(model, 100, 100);
+        VAR same = true;
+        for (VAR i = 0_z; i < vertices.size(); ++i)
+            same = same && vertices[i].position == ax::get_screen_vertex(model.get_vertices()[i].position, 100, 100).position;
+        CHECK(same);
+
+        // and build the edges of the other
+        CHECK(model.get_indices().size() == 6_z);
+        CHECK(!edges.get_current(model));
+        ax::edge_list fresh_edges;
+        CHECK(edges.update(model) == fresh_edges.update(model));
+
+        // reordering changes the geometry too
+        model.optimize_order();
+        CHECK(!cache.get_current(model, 100, 100));
+        CHECK(!edges.get_current(model));
+        std::remove("reload_a.obj");
+        std::remove("reload_b.obj");
+    }
+
+    TEST("textures match their source buffers")
+    {
+        // make an odd-sized buffer of distinct colors
+        ax::basic_buffer buffer(13, 10);
+        for (VAR j = 0; j < 10; ++j)
+            for (VAR i = 0; i < 13; ++i)
+                buffer.set_pixel(i, j, ax::basic_pixel(0.0f, ax::zero<ax::v3>(), { static_cast<uint8_t>(i * 19), static_cast<uint8_t>(j * 23), static_cast<uint8_t>(i + j), 255 }));
+
+        // convert to each format
+        ax::basic_texture diffuse(buffer, ax::texture_rgba8);
+        ax::basic_texture specular(buffer, ax::texture_r8, ax::texture_clamp);
+        ax::basic_texture tangent(buffer, ax::texture_normal);
+        CHECK(diffuse.get_bytes_per_texel() == 4);
+        CHECK(specular.get_bytes_per_texel() == 1);
+
+        // compare texels and samples
+        VAR same = true;
+        for (VAR j = 0; j < 10; ++j)
+        {
+            for (VAR i = 0; i < 13; ++i)
+            {
+                VAL& position = ax::v2((i + 0.5f) / 13.0f, (j + 0.5f) / 10.0f);
+                same = same &&
+                    diffuse.get_color(i, j) == buffer.get_pixel(i, j).color &&
+                    diffuse.sample_diffuse(position) == buffer.sample_diffuse(position) &&
+                    specular.sample_specular(position) == buffer.sample_specular(position) &&
+                    tangent.sample_tangent(position) == buffer.sample_tangent(position);
+            }
+        }
+        CHECK(same);
+
+        // check addressing
+        CHECK(diffuse.sample_diffuse(ax::v2(1.25f, -0.75f)) == diffuse.sample_diffuse(ax::v2(0.25f, 0.25f)));
+        CHECK(specular.sample_specular(ax::v2(-0.5f, 1.5f)) == specular.get_value(0, 9));
+        CHECK(ax::basic_texture().sample_specular(ax::v2(0.5f, 0.5f)) == 1.0f);
+    }
+
+    TEST("texture mips box filter down to one texel")
+    {
+        // make a buffer of alternating black and white columns
+        ax::basic_buffer buffer(16, 6);
+        for (VAR j = 0; j < 6; ++j)
+            for (VAR i = 0; i < 16; ++i)
+                buffer.set_pixel(i, j, ax::basic_pixel(0.0f, ax::zero<ax::v3>(), i % 2 == 0 ? ax::color(0, 0, 0, 255) : ax::color(255, 255, 255, 255)));
+
+        // generate mips
+        ax::basic_texture texture(buffer, ax::texture_rgba8);
+        texture.generate_mips();
+        CHECK(texture.get_level_count() == 5);
+        CHECK(texture.get_level(1).width == 8 && texture.get_level(1).height == 3);
+        CHECK(texture.get_level(4).width == 1 && texture.get_level(4).height == 1);
+        CHECK(texture.get_color(3, 1, 1).r == 128);
+
+        // check lod selection and sampling
+        CHECK(texture.get_lod(ax::v2(1.0f / 16.0f, 0.0f), ax::v2(0.0f, 1.0f / 6.0f)) == 0.0f);
+        CHECK(texture.get_lod(ax::v2(4.0f / 16.0f, 0.0f), ax::zero<ax::v2>()) == 2.0f);
+        CHECK(texture.get_lod(ax::v2(1000.0f, 0.0f), ax::zero<ax::v2>()) == 4.0f);
+        CHECK(texture.sample_diffuse(ax::v2(0.5f, 0.5f), 0.0f) == texture.sample_diffuse(ax::v2(0.5f, 0.5f)));
+        CHECK(texture.sample_diffuse(ax::v2(0.3f, 0.7f), 1.5f).g == 128);
+    }
+
+    TEST("surfaces load their maps asynchronously")
+    {
+        // load the maps on a single-threaded pool, waiting from inside one of its jobs
+        ax::worker_pool pool(1_z);
+        ax::basic_surface surface;
+        VAR load = surface.read_from_obj_async("../../data/model.obj", pool);
+        CHECK(load.get_pending());
+        VAL& error_opt = pool.submit([&]() { return load.wait(); }).get();
+        CHECK(!error_opt);
+        CHECK(!load.get_pending());
+        CHECK(surface.get_diffuse_map().get_width() == 1024);
+        CHECK(surface.get_tangent_map().get_level_count() > 1);
+        CHECK(surface.get_specular_map().get_bytes_per_texel() == 1);
+
+        // missing maps are fine but broken ones are reported
+        {
+            std::ofstream out("obj_test.obj", std::ios::binary);
+            out << "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\n";
+        }
+        ax::basic_model model;
+        CHECK(!model.try_read_from_obj("obj_test.obj"));
+        CHECK(model.get_surface().get_diffuse_map().get_width() == 0);
+        {
+            std::ofstream out("obj_test_spec.tga", std::ios::binary);
+            out << "not a tga";
+        }
+        CHECK(model.try_read_from_obj("obj_test.obj"));
+        std::remove("obj_test_spec.tga");
+        std::remove("obj_test.obj");
+    }
+
+    TEST("tga decoding handles raw, rle, gray and origins")
+    {
+        // encode a 21 x 5 image of distinct colors as tga data of each kind
+        VAL width = 21;
+        VAL height = 5;
+        VAL get_expected = [](int i, int j) { return ax::color(static_cast<uint8_t>(i * 11), static_cast<uint8_t>(j * 13), static_cast<uint8_t>(i + j * 3), static_cast<uint8_t>(100 + i)); };
+        VAL make_data = [&](char datatypecode, int inbytespp, bool top_left, bool rle)
+        {
+            ax::tga_header header;
+            std::memset(&header, 0, sizeof(header));
+            header.datatypecode = datatypecode;
+            header.width = static_cast<short>(width);
+            header.height = static_cast<short>(height);
+            header.bitsperpixel = static_cast<char>(inbytespp * 8);
+            header.imagedescriptor = top_left ? 0x20 : 0;
+            std::vector<uint8_t> pixels;
+            for (VAR j = 0; j < height; ++j)
+            {
+                for (VAR i = 0; i < width; ++i)
+                {
+                    VAL& color = get_expected(i, top_left ? height - 1 - j : j);
+                    VAL bgra = std::vector<uint8_t>({ color.b, color.g, color.r, color.a });
+                    if (inbytespp == 1) pixels.push_back(color.r);
+                    else pixels.insert(pixels.end(), bgra.begin(), bgra.begin() + inbytespp);
+                }
+            }
+            std::vector<char> data(reinterpret_cast<char*>(&header), reinterpret_cast<char*>(&header) + sizeof(header));
+            if (!rle) data.insert(data.end(), pixels.begin(), pixels.end());
+            else
+            {
+                // alternate literal packets of 7 pixels and a run of 9 copies of the next, spanning rows
+                VAL pixel_count = width * height;
+                VAR k = 0;
+                while (k < pixel_count)
+                {
+                    VAL literal_count = std::min(7, pixel_count - k);
+                    data.push_back(static_cast<char>(literal_count - 1));
+                    data.insert(data.end(), pixels.begin() + k * inbytespp, pixels.begin() + (k + literal_count) * inbytespp);
+                    k += literal_count;
+                    if (k >= pixel_count) break;
+                    VAL run_count = std::min(9, pixel_count - k);
+                    data.push_back(static_cast<char>(128 + run_count - 1));
+                    data.insert(data.end(), pixels.begin() + k * inbytespp, pixels.begin() + (k + 1) * inbytespp);
+                    for (VAR r = 1; r < run_count; ++r) std::copy(pixels.begin() + k * inbytespp, pixels.begin() + (k + 1) * inbytespp, pixels.begin() + (k + r) * inbytespp);
+                    k += run_count;
+                }
+            }
+            return std::make_pair(data, pixels);
+        };
+
+        // decode each and compare against the pixels that were encoded
+        VAR same = true;
+        for (VAL inbytespp : { 1, 3, 4 })
+        {
+            for (VAL top_left : { false, true })
+            {
+                for (VAL rle : { false, true })
+                {
+                    VAL& data_and_pixels = make_data(inbytespp == 1 ? (rle ? 11 : 3) : (rle ? 10 : 2), inbytespp, top_left, rle);
+                    VAL& data = data_and_pixels.first;
+                    VAL& pixels = data_and_pixels.second;
+                    ax::basic_buffer buffer;
+                    CHECK(!buffer.try_read_from_tga_data(data.data(), data.size()));
+                    CHECK(buffer.get_width() == width && buffer.get_height() == height);
+                    for (VAR j = 0; j < height; ++j)
+                    {
+                        for (VAR i = 0; i < width; ++i)
+                        {
+                            VAL source = &pixels[((top_left ? height - 1 - j : j) * width + i) * inbytespp];
+                            VAL& expected = inbytespp == 1 ?
+                                ax::color(source[0], source[0], source[0], 255) :
+                                ax::color(source[2], source[1], source[0], inbytespp == 4 ? source[3] : 255);
+                            same = same && buffer.get_pixel(i, j).color == expected;
+                        }
+                    }
+                    CHECK(buffer.try_read_from_tga_data(data.data(), data.size() - 1));
+                }
+            }
+        }
+        CHECK(same);
+
+        // check that files decode as their in-memory data does
+        ax::basic_buffer spec_file;
+        CHECK(!spec_file.try_read_from_tga("../../data/model_spec.tga"));
+        CHECK(spec_file.get_width() == 1024);
+        CHECK(ax::basic_buffer().try_read_from_tga("../../data/missing.tga"));
+    }
+
+    TEST("tga encoding round trips without touching the buffer")
+    {
+        // make an odd-sized buffer of distinct colors
+        ax::basic_buffer buffer(37, 9);
+        for (VAR j = 0; j < 9; ++j)
+            for (VAR i = 0; i < 37; ++i)
+                buffer.set_pixel(i, j, ax::basic_pixel(static_cast<float>(i), ax::zero<ax::v3>(), { static_cast<uint8_t>(i * 7), static_cast<uint8_t>(j * 29), static_cast<uint8_t>(i ^ j), static_cast<uint8_t>(255 - i) }));
+        const ax::basic_buffer copy(buffer);
+
+        // write then read it back
+        CHECK(!static_cast<const ax::basic_buffer&>(buffer).try_write_to_tga("tga_test.tga"));
+        ax::basic_buffer read;
+        CHECK(!read.try_read_from_tga("tga_test.tga"));
+        std::remove("tga_test.tga");
+        CHECK(read.get_width() == 37 && read.get_height() == 9);
+        VAR same = true;
+        for (VAR j = 0; j < 9; ++j)
+        {
+            for (VAR i = 0; i < 37; ++i)
+            {
+                same = same &&
+                    read.get_pixel(i, j).color == copy.get_pixel(i, j).color &&
+                    buffer.get_pixel(i, j).color == copy.get_pixel(i, j).color &&
+                    buffer.get_pixel(i, j).depth == copy.get_pixel(i, j).depth;
+            }
+        }
+        CHECK(same);
+
+        // flip swaps whole rows
+        buffer.flip_vertical();
+        CHECK(buffer.get_pixel(5, 0).color == copy.get_pixel(5, 8).color);
+        CHECK(buffer.get_pixel(36, 4).color == copy.get_pixel(36, 4).color);
+        CHECK(buffer.get_pixel(0, 8).color == copy.get_pixel(0, 0).color);
+    }
+
+    TEST("qoi encoding round trips serially and in parallel bands")
+    {
+        // render into a fast-cleared target large enough to encode in several bands
+        ax::basic_model model;
+        model.try_read_from_obj("../../data/model.obj");
+        ax::basic_buffer buffer(1200, 1200);
+        buffer.fast_clear(ax::basic_pixel(std::numeric_limits<float>::lowest(), ax::zero<ax::v3>(), { 0, 0, 0, 255 }));
+        ax::draw_textured_ortho_tiled(ax::v3(0.0f, 0.0f, 1.0f), model, buffer, 64);
+        CHECK(buffer.get_clear_pending());
+
+        // encode both ways without resolving the clear, each decoding to the same colors
+        ax::worker_pool pool(4_z);
+        VAL& serial_data = buffer.get_qoi_data();
+        VAL& parallel_data = buffer.get_qoi_data(pool);
+        CHECK(buffer.get_clear_pending());
+        CHECK(serial_data.size() < 1200_z * 1200_z * 4_z / 3_z && parallel_data.size() < 1200_z * 1200_z * 4_z / 3_z);
+        ax::basic_buffer serial_read;
+        ax::basic_buffer parallel_read;
+        CHECK(!serial_read.try_read_from_qoi_data(reinterpret_cast<const char*>(serial_data.data()), serial_data.size()));
+        CHECK(!parallel_read.try_read_from_qoi_data(reinterpret_cast<const char*>(parallel_data.data()), parallel_data.size()));
+        VAR same = serial_read.get_width() == 1200 && parallel_read.get_height() == 1200;
+        for (VAR j = 0; j < 1200 && same; ++j)
+            for (VAR i = 0; i < 1200; ++i)
+                same = same && serial_read.get_pixel(i, j).color == buffer.get_pixel(i, j).color && parallel_read.get_pixel(i, j).color == buffer.get_pixel(i, j).color;
+        CHECK(same);
+
+        // round trip through a file
+        CHECK(!buffer.try_write_to_qoi("qoi_test.qoi", pool));
+        ax::basic_buffer file_read;
+        CHECK(!file_read.try_read_from_qoi("qoi_test.qoi"));
+        std::remove("qoi_test.qoi");
+        CHECK(file_read.get_pixel(600, 600).color == buffer.get_pixel(600, 600).color);
+
+        // decode a hand-made stream, its first row being the buffer's top
+        const uint8_t stream[] = { 'q', 'o', 'i', 'f', 0, 0, 0, 1, 0, 0, 0, 2, 4, 0, 0xFE, 255, 0, 0, 0x40 | 1 << 4 | 2 << 2 | 2, 0, 0, 0, 0, 0, 0, 0, 1 };
+        ax::basic_buffer small;
+        CHECK(!small.try_read_from_qoi_data(reinterpret_cast<const char*>(stream), sizeof(stream)));
+        CHECK(small.get_width() == 1 && small.get_height() == 2);
+        CHECK(small.get_pixel(0, 1).color == ax::color(255, 0, 0, 255) && small.get_pixel(0, 0).color == ax::color(254, 0, 0, 255));
+        CHECK(small.try_read_from_qoi_data(reinterpret_cast<const char*>(stream), 16_z));
+
+        // round trip the widest image a tga can hold too, but no wider
+        ax::basic_buffer wide(65535, 2);
+        for (VAR i = 0; i < 65535; ++i)
+        {
+            wide.set_pixel(i, 0, ax::basic_pixel(0.0f, ax::zero<ax::v3>(), ax::color(static_cast<uint8_t>(i), static_cast<uint8_t>(i >> 8), 0, 255)));
+            wide.set_pixel(i, 1, ax::basic_pixel(0.0f, ax::zero<ax::v3>(), ax::color(0, 0, static_cast<uint8_t>(i / 7), 255)));
+        }
+        CHECK(!wide.try_write_to_qoi("qoi_test.qoi", pool));
+        ax::basic_buffer wide_read;
+        CHECK(!wide_read.try_read_from_qoi("qoi_test.qoi"));
+        std::remove("qoi_test.qoi");
+        same = wide_read.get_width() == 65535 && wide_read.get_height() == 2;
+        for (VAR j = 0; j < 2 && same; ++j)
+            for (VAR i = 0; i < 65535; ++i)
+                same = same && wide_read.get_pixel(i, j).color == wide.get_pixel(i, j).color;
+        CHECK(same);
+        ax::basic_buffer wider(65536, 1);
+        CHECK(wider.try_write_to_qoi("qoi_test.qoi"));
+        VAR wider_data = wide.get_qoi_data();
+        wider_data[5] = 1;
+        wider_data[6] = 0;
+        wider_data[7] = 0;
+        CHECK(wide_read.try_read_from_qoi_data(reinterpret_cast<const char*>(wider_data.data()), wider_data.size()));
+    }
+
+    TEST("model bvhs answer ray and box queries like brute force")
+    {
+        // brute force ray casts for comparison
+        VAL cast = [](const ax::basic_model& model, const ax::v3& origin, const ax::v3& direction)
+        {
+            VAR closest = std::numeric_limits<float>::max();
+            for (VAR i = 0; i < model.get_face_count(); ++i)
+            {
+                VAL a = model.get_position(i, 0);
+                VAL e1 = model.get_position(i, 1) - a;
+                VAL e2 = model.get_position(i, 2) - a;
+                VAL p = direction ^ e2;
+                VAL determinant = e1 * p;
+                if (determinant == 0.0f) continue;
+                VAL s = origin - a;
+                VAL u = (s * p) / determinant;
+                VAL q = s ^ e1;
+                VAL v = (direction * q) / determinant;
+                VAL t = (e2 * q) / determinant;
+                if (u >= 0.0f && v >= 0.0f && u + v <= 1.0f && t >= 0.0f) closest = std::min(closest, t);
+            }
+            return closest;
+        };
+
+        // cast rays through the model both ways, including axis-aligned ones
+        ax::basic_model model;
+        model.try_read_from_obj("../../data/model.obj");
+        ax::model_bvh bvh;
+        bvh.build(model);
+        CHECK(bvh.get_face_count() == ax::itoz(model.get_face_count()));
+        CHECK(bvh.get_nodes().size() < ax::itoz(model.get_face_count()));
+        VAR same = true;
+        VAR hits = 0;
+        for (VAR i = 0; i < 400; ++i)
+        {
+            VAL x = -1.0f + static_cast<float>(i % 20) * 0.1f + 0.013f;
+            VAL y = -1.0f + static_cast<float>(i / 20) * 0.1f + 0.007f;
+            VAL origin = ax::v3(x, y, 2.0f);
+            VAL direction = i % 2 == 0 ? ax::v3(0.0f, 0.0f, -1.0f) : ax::v3(0.1f, -0.05f, -1.0f);
+            VAL expected = cast(model, origin, direction);
+            ax::face_hit hit;
+            VAL found = bvh.try_intersect(origin, direction, hit);
+            same = same && found == (expected != std::numeric_limits<float>::max());
+            if (!found) continue;
+            ++hits;
+            same = same && std::abs(hit.distance - expected) < 1e-5f;
+            VAL point = origin + direction * hit.distance;
+            VAL interpolated =
+                model.get_position(hit.face_index, 0) * hit.barycentric.x +
+                model.get_position(hit.face_index, 1) * hit.barycentric.y +
+                model.get_position(hit.face_index, 2) * hit.barycentric.z;
+            same = same && (interpolated - point).Length() < 1e-4f;
+            ax::face_hit any_hit;
+            same = same && bvh.try_intersect_any(origin, direction, any_hit) && any_hit.distance >= hit.distance;
+            same = same && !bvh.try_intersect_any(origin, direction, any_hit, hit.distance * 0.99f);
+        }
+        CHECK(same);
+        CHECK(hits > 100);
+
+        // query a box against every face's exact overlap, approximated by sampling
+        VAL box = ax::box3(ax::v3(-0.2f, -0.1f, -1.0f), ax::v3(0.1f, 0.3f, 1.0f));
+        std::vector<ax::face_hit> overlaps;
+        bvh.get_overlaps(box, overlaps);
+        std::vector<int> found_faces;
+        for (VAL& overlap : overlaps) found_faces.push_back(overlap.face_index);
+        std::sort(found_faces.begin(), found_faces.end());
+        VAR overlapping = !found_faces.empty();
+        for (VAR i = 0; i < model.get_face_count(); ++i)
+        {
+            VAR inside = false;
+            for (VAR j = 0; j <= 10 && !inside; ++j)
+            {
+                for (VAR k = 0; j + k <= 10 && !inside; ++k)
+                {
+                    VAL u = static_cast<float>(j) / 10.0f;
+                    VAL v = static_cast<float>(k) / 10.0f;
+                    VAL point = model.get_position(i, 0) * (1.0f - u - v) + model.get_position(i, 1) * u + model.get_position(i, 2) * v;
+                    inside = point.x >= box.first.x && point.y >= box.first.y && point.z >= box.first.z && point.x <= box.second.x && point.y <= box.second.y && point.z <= box.second.z;
+                }
+            }
+            if (inside) overlapping = overlapping && std::binary_search(found_faces.begin(), found_faces.end(), i);
+        }
+        CHECK(overlapping);
+        CHECK(std::adjacent_find(found_faces.begin(), found_faces.end()) == found_faces.end());
+
+        // build a grid big enough to build in parallel, then probe its cells
+        VAL cells = 200;
+        std::vector<ax::v3> positions;
+        std::vector<ax::v3i> corners;
+        for (VAR j = 0; j <= cells; ++j)
+            for (VAR i = 0; i <= cells; ++i)
+                positions.push_back(ax::v3(static_cast<float>(i) / cells * 2.0f - 1.0f, static_cast<float>(j) / cells * 2.0f - 1.0f, 0.0f));
+        for (VAR j = 0; j < cells; ++j)
+        {
+            for (VAR i = 0; i < cells; ++i)
+            {
+                VAL corner = j * (cells + 1) + i;
+                corners.insert(corners.end(), { ax::v3i(corner, -1, -1), ax::v3i(corner + 1, -1, -1), ax::v3i(corner + cells + 2, -1, -1) });
+                corners.insert(corners.end(), { ax::v3i(corner, -1, -1), ax::v3i(corner + cells + 2, -1, -1), ax::v3i(corner + cells + 1, -1, -1) });
+            }
+        }
+        ax::basic_model grid;
+        grid.set_geometry(positions, {}, {}, corners);
+        ax::worker_pool pool(4_z);
+        bvh.build(grid, pool);
+        CHECK(bvh.get_face_count() == 80000_z);
+        VAR probed = true;
+        for (VAR i = 0; i < 100; ++i)
+        {
+            VAL cell_x = (i * 37) % cells;
+            VAL cell_y = (i * 91) % cells;
+            VAL origin = ax::v3((static_cast<float>(cell_x) + 0.75f) / cells * 2.0f - 1.0f, (static_cast<float>(cell_y) + 0.25f) / cells * 2.0f - 1.0f, 1.0f);
+            ax::face_hit hit;
+            probed = probed && bvh.try_intersect(origin, ax::v3(0.0f, 0.0f, -1.0f), hit) && hit.face_index == (cell_y * cells + cell_x) * 2 && std::abs(hit.distance - 1.0f) < 1e-5f;
+        }
+        CHECK(probed);
+        bvh.clear();
+        ax::face_hit hit;
+        CHECK(!bvh.try_intersect(ax::zero<ax::v3>(), ax::v3(0.0f, 0.0f, -1.0f), hit));
+    }
+
+    TEST("instanced draws match drawing each instance in turn")
+    {
+        // place a few overlapping instances, one of them far offscreen
+        ax::basic_model model;
+        model.try_read_from_obj("../../data/model.obj");
+        std::vector<ax::model_instance> instances;
+        for (VAR i = 0; i < 6; ++i)
+        {
+            ax::matrix4 translation;
+            ax::matrix4 rotation;
+            ax::matrix4 scaling;
+            ax::matrix4::Translation(ax::v3(-0.5f + 0.2f * static_cast<float>(i), i == 5 ? 8.0f : 0.3f - 0.1f * static_cast<float>(i), 0.1f * static_cast<float>(i % 3)), translation);
+            ax::matrix4::RotationY(0.3f * static_cast<float>(i) - 0.6f, rotation);
+            ax::matrix4::Scaling(ax::v3(0.5f + 0.05f * static_cast<float>(i)), scaling);
+            instances.push_back({ translation * rotation * scaling, ax::v3(0.0f, 0.1f * static_cast<float>(i), 1.0f).NormalizeSafe(), ax::color(255, 255, 255, 255) });
+        }
+
+        // draws the instances one triangle at a time, tinted afterwards
+        VAL draw_each = [&](ax::basic_buffer& buffer)
+        {
+            for (VAL& instance : instances)
+            {
+                for (VAR i = 0; i < model.get_face_count(); ++i)
+                {
+                    VAL& triangle = ax::triangle3(instance.transform * model.get_position(i, 0), instance.transform * model.get_position(i, 1), instance.transform * model.get_position(i, 2));
+                    if (ax::get_normal(triangle).z <= 0.0f) continue;
+                    VAL& uvs = ax::triangle2(model.get_uv(i, 0), model.get_uv(i, 1), model.get_uv(i, 2));
+                    ax::draw_textured_ortho(instance.light, model.get_surface(), uvs, triangle, buffer);
+                }
+            }
+        };
+
+        // draw both ways, tiled on a pool
+        VAL clear_pixel = ax::basic_pixel(std::numeric_limits<float>::lowest(), ax::zero<ax::v3>(), { 0, 0, 0, 255 });
+        ax::basic_buffer expected(300, 200);
+        ax::basic_buffer instanced(300, 200);
+        expected.fill(clear_pixel);
+        instanced.fill(clear_pixel);
+        draw_each(expected);
+        ax::worker_pool pool(4_z);
+        ax::draw_textured_ortho_instanced(model, instances.data(), instances.size(), instanced, 32, pool);
+        VAR same = true;
+        VAR covered = 0;
+        for (VAR j = 0; j < 200; ++j)
+        {
+            for (VAR i = 0; i < 300; ++i)
+            {
+                same = same && instanced.get_pixel(i, j).color == expected.get_pixel(i, j).color && instanced.get_pixel(i, j).depth == expected.get_pixel(i, j).depth;
+                if (expected.get_pixel(i, j).depth != std::numeric_limits<float>::lowest()) ++covered;
+            }
+        }
+        CHECK(same);
+        CHECK(covered > 300 * 200 / 4);
+
+        // tint an instance
+        instances.resize(1_z);
+        instances[0].tint = ax::color(128, 255, 64, 255);
+        expected.fill(clear_pixel);
+        instanced.fill(clear_pixel);
+        draw_each(expected);
+        ax::draw_textured_ortho_instanced(model, instances.data(), instances.size(), instanced);
+        VAR tinted = true;
+        for (VAR j = 0; j < 200; ++j)
+        {
+            for (VAR i = 0; i < 300; ++i)
+            {
+                VAL& color = expected.get_pixel(i, j).color;
+                VAL& tinted_color = instanced.get_pixel(i, j).color;
+                if (expected.get_pixel(i, j).depth == std::numeric_limits<float>::lowest()) continue;
+                tinted = tinted && tinted_color.r == (color.r * 128 + 127) / 255 && tinted_color.g == color.g && tinted_color.b == (color.b * 64 + 127) / 255;
+            }
+        }
+        CHECK(tinted);
+
+        // culled and empty draws leave the target alone
+        ax::matrix4::Translation(ax::v3(5.0f, 0.0f, 0.0f), instances[0].transform);
+        instanced.fill(clear_pixel);
+        ax::draw_textured_ortho_instanced(model, instances.data(), instances.size(), instanced);
+        ax::draw_textured_ortho_instanced(model, nullptr, 0_z, instanced);
+        CHECK(instanced.get_pixel(150, 100).depth == std::numeric_limits<float>::lowest());
+    }
+
+    TEST("model lods simplify along seams and select by screen size")
+    {
+        // build a chain of levels, each coarser than the last
+        ax::basic_model model;
+        model.try_read_from_obj("../../data/model.obj");
+        ax::model_lods lods;
+        lods.build(model, 256);
+        CHECK(lods.get_level_count() > 3_z && &lods.get_model() == &model);
+        VAR coarser = true;
+        for (VAR i = 1_z; i < lods.get_level_count(); ++i)
+            coarser = coarser && lods.get_level(i).get_face_count() < lods.get_level(i - 1_z).get_face_count();
+        CHECK(coarser);
+
+        // collapsing onto existing vertices keeps each level's position and uv pairs from the model
+        VAL& coarsest = lods.get_level(lods.get_level_count() - 1_z);
+        VAR kept = coarsest.get_face_count() > 0;
+        for (VAL& vertex : coarsest.get_vertices())
+        {
+            VAL found = std::find_if(model.get_vertices().begin(), model.get_vertices().end(), [&vertex](const ax::basic_vertex& source)
+            {
+                return source.position == vertex.position && source.uv == vertex.uv;
+            });
+            kept = kept && found != model.get_vertices().end();
+        }
+        CHECK(kept);
+
+        // small targets select coarser levels
+        CHECK(lods.select_level(2048, 2048) == 0_z);
+        CHECK(lods.select_level(64, 64) > lods.select_level(512, 512));
+        CHECK(lods.select_level(16, 16) == lods.get_level_count() - 1_z);
+
+        // a selected level covers about the same pixels as the model itself
+        ax::basic_buffer full(64, 64);
+        ax::basic_buffer reduced(64, 64);
+        full.fill(ax::basic_pixel(std::numeric_limits<float>::lowest(), ax::zero<ax::v3>(), { 0, 0, 0, 255 }));
+        reduced.fill(ax::basic_pixel(std::numeric_limits<float>::lowest(), ax::zero<ax::v3>(), { 0, 0, 0, 255 }));
+        ax::draw_textured_ortho(ax::v3(0.0f, 0.0f, 1.0f), model, full);
+        ax::draw_textured_ortho(ax::v3(0.0f, 0.0f, 1.0f), lods, reduced);
+        VAR full_covered = 0;
+        VAR reduced_covered = 0;
+        for (VAR j = 0; j < 64; ++j)
+        {
+            for (VAR i = 0; i < 64; ++i)
+            {
+                if (full.get_pixel(i, j).depth != std::numeric_limits<float>::lowest()) ++full_covered;
+                if (reduced.get_pixel(i, j).depth != std::numeric_limits<float>::lowest()) ++reduced_covered;
+            }
+        }
+        CHECK(lods.select_level(64, 64) > 0_z);
+        CHECK(std::abs(full_covered - reduced_covered) * 20 < full_covered);
+
+        // levels need the model to be set
+        lods.clear();
+        CHECK(lods.get_level_count() == 0_z);
+        VAR threw = false;
+        try { lods.get_level(0_z); }
+        catch (const std::out_of_range&) { threw = true; }
+        CHECK(threw);
+    }
+
+    TEST("banded tga draws match drawing the whole target")
+    {
+        // draw the whole target, then in bands straight to a file, with a partial last band
+        ax::basic_model model;
+        model.try_read_from_obj("../../data/model.obj");
+        VAL light = ax::v3(0.0f, 0.0f, 1.0f);
+        VAL clear_pixel = ax::basic_pixel(std::numeric_limits<float>::lowest(), ax::zero<ax::v3>(), { 0, 0, 0, 255 });
+        ax::basic_buffer whole(300, 200);
+        whole.fill(clear_pixel);
+        ax::draw_textured_ortho_tiled(light, model, whole, 64);
+        ax::worker_pool pool(4_z);
+        CHECK(!ax::try_draw_textured_ortho_to_tga(light, model, clear_pixel, 300, 200, "band_test.tga", 24, 64, pool));
+        ax::basic_buffer banded;
+        CHECK(!banded.try_read_from_tga("band_test.tga"));
+        VAR same = banded.get_width() == 300 && banded.get_height() == 200;
+        for (VAR j = 0; j < 200 && same; ++j)
+            for (VAR i = 0; i < 300; ++i)
+                same = same && banded.get_pixel(i, j).color == whole.get_pixel(i, j).color;
+        CHECK(same);
+
+        // draw in bands from inside the only job of a one-thread pool, in narrower columns
+        ax::worker_pool single_pool(1_z);
+        CHECK(!single_pool.submit([&]() { return ax::try_draw_textured_ortho_to_tga(light, model, clear_pixel, 300, 200, "band_test.tga", 24, 32, single_pool); }).get());
+        CHECK(!banded.try_read_from_tga("band_test.tga"));
+        same = banded.get_width() == 300 && banded.get_height() == 200;
+        for (VAR j = 0; j < 200 && same; ++j)
+            for (VAR i = 0; i < 300; ++i)
+                same = same && banded.get_pixel(i, j).color == whole.get_pixel(i, j).color;
+        CHECK(same);
+
+        // write a target wider than a signed tga dimension allows
+        CHECK(!ax::try_draw_textured_ortho_to_tga(light, model, clear_pixel, 40000, 3, "band_test.tga", 2));
+        CHECK(!banded.try_read_from_tga("band_test.tga"));
+        CHECK(banded.get_width() == 40000 && banded.get_height() == 3);
+        VAR covered = 0;
+        for (VAR i = 0; i < 40000; ++i) if (banded.get_pixel(i, 1).color != clear_pixel.color) ++covered;
+        CHECK(covered > 10000);
+        std::remove("band_test.tga");
+
+        // report what can't be written, leaving no partial file behind
+        CHECK(ax::try_draw_textured_ortho_to_tga(light, model, clear_pixel, 70000, 3, "band_test.tga"));
+        CHECK(!std::ifstream("band_test.tga").is_open());
+        CHECK(ax::try_draw_textured_ortho_to_tga(light, model, clear_pixel, 300, 200, "no_such_directory/band_test.tga"));
+    }
+
     TEST("main")
     {
         // open model
@@ -296,7 +1611,7 @@ namespace ax
         VAL& light = ax::v3(0.0f, 0.0f, 1.0f);
         ax::draw_textured_ortho(light, model, render_target);
 
-        // write render target as flipped to file
+        // write render target to file
         render_target.try_write_to_tga(image_file_path);
     }
 }
@@ -7,22 +7,31 @@
 #include "basic_buffer_ops.hpp"
 #include "basic_buffer.hpp"
 #include "basic_model.hpp"
+#include "basic_texture.hpp"
 #include "castable.hpp"
 #include "cast.hpp"
 #include "choice.hpp"
 #include "choice4.hpp"
 #include "choice5.hpp"
+#include "edge_list.hpp"
 #include "event.hpp"
 #include "eventable.hpp"
 #include "field.hpp"
+#include "frame_pipeline.hpp"
 #include "functional.hpp"
 #include "hash.hpp"
+#include "hierarchical_depth.hpp"
 #include "id.hpp"
+#include "mapped_file.hpp"
 #include "math.hpp"
+#include "model_bvh.hpp"
+#include "model_lods.hpp"
+#include "model_order.hpp"
 #include "name.hpp"
 #include "option.hpp"
 #include "pair.hpp"
 #include "parser.hpp"
+#include "planar_buffer.hpp"
 #include "prelude.hpp"
 #include "propertied.hpp"
 #include "property.hpp"
@@ -31,6 +40,7 @@
 #include "record5.hpp"
 #include "reflectable.hpp"
 #include "reflection.hpp"
+#include "render_stats.hpp"
 #include "serialization.hpp"
 // #include "stream.hpp" - NOTE: WIP.
 #include "string.hpp"
@@ -38,10 +48,14 @@
 #include "symbol.hpp"
 #include "symbolics.hpp"
 #include "tga.hpp"
+#include "triangle_traversal.hpp"
 #include "type_descriptor.hpp"
 #include "type_descriptors.hpp"
 #include "type.hpp"
 #include "unparser.hpp"
 #include "vector.hpp"
+#include "vertex_cache.hpp"
+#include "visibility_buffer.hpp"
+#include "worker_pool.hpp"
 
 #endif
@@ -1,12 +1,16 @@
 #ifndef AX_BASIC_BUFFER_HPP
 #define AX_BASIC_BUFFER_HPP
 
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
 #include <vector>
 
 #include "prelude.hpp"
 #include "math.hpp"
 #include "option.hpp"
 #include "tga.hpp"
+#include "worker_pool.hpp"
 
 namespace ax
 {
@@ -24,10 +28,19 @@ namespace ax
         ax::color color;
     };
 
+    // A buffer of pixels, row 0 being the bottom of the image.
+    //
+    // Besides fill, a buffer can be fast-cleared, which only records the clear pixel along with a
+    // bit per clear_tile_size-square tile. A cleared tile reads as the clear pixel, takes it on
+    // when first written through get_pixel_in_place or set_pixel, and is exported straight from
+    // it, so that pixels nothing draws to are never touched. Writes to distinct tiles may happen
+    // concurrently.
     struct basic_buffer
     {
     public:
 
+        static constexpr int clear_tile_size = 8;
+
         basic_buffer();
         basic_buffer(int w, int h);
         basic_buffer(const basic_buffer& image);
@@ -40,7 +53,20 @@ namespace ax
         ax::basic_pixel& get_pixel_in_place(int x, int y);
         const ax::basic_pixel& get_pixel(int x, int y) const;
         bool set_pixel(int x, int y, const ax::basic_pixel& pixel);
+
+        // Set only the color of a pixel the caller knows is in bounds.
+        void set_color_in_bounds(int x, int y, const ax::color& color)
+        {
+            if (clear_pending) resolve_tile_of(x, y);
+            pixels[x + y * width].color = color;
+        }
+
         void fill(const ax::basic_pixel& pixel);
+        void fast_clear(const ax::basic_pixel& pixel);
+        void resolve_clear();
+        bool get_clear_pending() const { return clear_pending; }
+        bool get_tile_cleared(int tile_x, int tile_y) const;
+        const ax::basic_pixel& get_clear_pixel() const { return clear_pixel; }
         void flip_vertical();
         void clear();
 
@@ -48,19 +74,57 @@ namespace ax
         ax::v3 sample_tangent(const ax::v2& position) const;
         float sample_specular(const ax::v2& position) const;
 
+        // Encode as an uncompressed 32-bit tga. Rows are written bottom-up as the buffer stores
+        // them without touching the buffer, so concurrent writes of the same buffer are safe.
         ax::option<std::string> try_write_to_tga(const char* filename) const;
         ax::option<std::string> try_read_from_tga(const char* filename);
 
+        // Stream a tga in pieces - a header for a width x height image, rows of buffers or runs of
+        // colors in the bottom-up order the header promises, then the footer - so that an image
+        // too large to hold can be written a band of rows at a time.
+        static ax::option<std::string> try_write_tga_header(int width, int height, std::ostream& out);
+        ax::option<std::string> try_write_tga_rows(int row_begin, int row_end, std::ostream& out) const;
+        static ax::option<std::string> try_write_tga_colors(const ax::color* colors, std::size_t count, std::ostream& out);
+        static ax::option<std::string> try_write_tga_footer(std::ostream& out);
+
+        // Decode a whole tga file already in memory, such as a mapping of it. Rows are written
+        // straight to their final place according to the image origin, so no flip is needed.
+        ax::option<std::string> try_read_from_tga_data(const char* data, std::size_t size);
+
+        // Encode as a qoi, a lossless format of run, color index and small delta ops that's
+        // typically several times smaller than a tga for little more work. Given a pool, bands of
+        // rows are encoded in parallel, each starting with an empty color index so that it needs
+        // nothing from the bands before it, which still concatenates into a standard qoi stream.
+        // Like the tga writer, the buffer isn't touched, and files are limited to 65535 pixels a
+        // side.
+        std::vector<uint8_t> get_qoi_data() const;
+        std::vector<uint8_t> get_qoi_data(ax::worker_pool& pool) const;
+        ax::option<std::string> try_write_to_qoi(const char* file_path) const;
+        ax::option<std::string> try_write_to_qoi(const char* file_path, ax::worker_pool& pool) const;
+        ax::option<std::string> try_read_from_qoi(const char* file_path);
+        ax::option<std::string> try_read_from_qoi_data(const char* data, std::size_t size);
+
     private:
 
-        ax::option<std::string> try_read_data_raw(int inbytespp, std::ifstream& in);
-        ax::option<std::string> try_read_data_rle(int inbytespp, std::ifstream& in);
-        ax::color color_from_tga(int inbytespp, const ax::color& color) const;
-        ax::color color_to_tga(const ax::color& color) const;
+        ax::option<std::string> try_read_data_raw(int inbytespp, bool top_left, const char* data, std::size_t size);
+        ax::option<std::string> try_read_data_rle(int inbytespp, bool top_left, const char* data, std::size_t size);
+        void set_row_colors(int y, const ax::color* colors);
+        void get_row_colors(int y, ax::color* colors) const;
+        void encode_qoi_rows(int row_begin, int row_end, std::vector<uint8_t>& data) const;
+        std::vector<uint8_t> get_qoi_data(int band_rows, ax::worker_pool* pool) const;
+        void resolve_tile(int tile_x, int tile_y);
+        void resolve_tile_of(int x, int y);
+        void reset_clear();
 
         std::vector<ax::basic_pixel> pixels;
         int width;
         int height;
+
+        // Fast clear state, with a flag per tile raised while it still holds the clear pixel.
+        std::vector<uint8_t> tiles_cleared;
+        int tiles_x;
+        ax::basic_pixel clear_pixel;
+        bool clear_pending;
     };
 }
 
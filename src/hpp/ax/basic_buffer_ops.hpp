@@ -4,17 +4,73 @@
 #include "prelude.hpp"
 #include "math.hpp"
 #include "basic_buffer.hpp"
+#include "planar_buffer.hpp"
+#include "hierarchical_depth.hpp"
+#include "edge_list.hpp"
+#include "render_stats.hpp"
 #include "basic_model.hpp"
+#include "model_lods.hpp"
+#include "vertex_cache.hpp"
+#include "visibility_buffer.hpp"
+#include "worker_pool.hpp"
 
 namespace ax
 {
+    // One placement of a model in an instanced draw.
+    struct model_instance
+    {
+        ax::matrix4 transform;
+        ax::v3 light;
+        ax::color tint;
+    };
+
     void draw_dot(const ax::color& color, int x, int y, ax::basic_buffer& buffer);
     void draw_line(const ax::color& color, int x, int y, int x2, int y2, ax::basic_buffer& buffer);
+
+    // Draw the same pixels as draw_line, writing only colors and clipping up front.
+    void draw_line_clipped(const ax::color& color, int x, int y, int x2, int y2, ax::basic_buffer& buffer);
+
     void draw_wired_ortho(const ax::color& color, const ax::line2& line, ax::basic_buffer& buffer);
     void draw_wired_ortho(const ax::color& color, const ax::triangle2& triangle, ax::basic_buffer& buffer);
-    void draw_wired_ortho(const ax::color& color, const ax::basic_model& model, ax::basic_buffer& buffer);
-    void draw_textured_ortho(const ax::v3& light, const ax::basic_surface& surface, const ax::triangle2& uvs, const ax::triangle3& triangle, ax::basic_buffer& buffer);
-    void draw_textured_ortho(const ax::v3& light, const ax::basic_model& model, ax::basic_buffer& buffer);
+
+    // Draw each unique edge of a model once, reusing edge_list and vertex_cache while current.
+    void draw_wired_ortho(const ax::color& color, const ax::basic_model& model, ax::basic_buffer& buffer, ax::edge_list* edge_list = nullptr, ax::vertex_cache* vertex_cache = nullptr);
+
+    // Draw textured triangles, rejecting blocks early against hierarchical_depth when given.
+    void draw_textured_ortho(const ax::v3& light, const ax::basic_surface& surface, const ax::triangle2& uvs, const ax::triangle3& triangle, ax::basic_buffer& buffer, ax::hierarchical_depth* hierarchical_depth = nullptr, ax::render_stats* render_stats = nullptr);
+    void draw_textured_ortho(const ax::v3& light, const ax::basic_surface& surface, const ax::triangle2& uvs, const ax::triangle3& triangle, ax::planar_buffer& buffer, ax::hierarchical_depth* hierarchical_depth = nullptr, ax::render_stats* render_stats = nullptr);
+
+    // Draw a model, reusing vertex_cache while current for the model and target size.
+    void draw_textured_ortho(const ax::v3& light, const ax::basic_model& model, ax::basic_buffer& buffer, ax::hierarchical_depth* hierarchical_depth = nullptr, ax::vertex_cache* vertex_cache = nullptr, ax::render_stats* render_stats = nullptr);
+    void draw_textured_ortho(const ax::v3& light, const ax::basic_model& model, ax::planar_buffer& buffer, ax::hierarchical_depth* hierarchical_depth = nullptr, ax::vertex_cache* vertex_cache = nullptr, ax::render_stats* render_stats = nullptr);
+
+    // Draw a model with a binned rasterizer, tiles in parallel, matching draw_textured_ortho.
+    void draw_textured_ortho_tiled(const ax::v3& light, const ax::basic_model& model, ax::basic_buffer& buffer, int tile_size = 64, ax::hierarchical_depth* hierarchical_depth = nullptr, ax::vertex_cache* vertex_cache = nullptr, ax::render_stats* render_stats = nullptr);
+    void draw_textured_ortho_tiled(const ax::v3& light, const ax::basic_model& model, ax::basic_buffer& buffer, int tile_size, ax::worker_pool& pool, ax::hierarchical_depth* hierarchical_depth = nullptr, ax::vertex_cache* vertex_cache = nullptr, ax::render_stats* render_stats = nullptr);
+    void draw_textured_ortho_tiled(const ax::v3& light, const ax::basic_model& model, ax::planar_buffer& buffer, int tile_size = 64, ax::hierarchical_depth* hierarchical_depth = nullptr, ax::vertex_cache* vertex_cache = nullptr, ax::render_stats* render_stats = nullptr);
+    void draw_textured_ortho_tiled(const ax::v3& light, const ax::basic_model& model, ax::planar_buffer& buffer, int tile_size, ax::worker_pool& pool, ax::hierarchical_depth* hierarchical_depth = nullptr, ax::vertex_cache* vertex_cache = nullptr, ax::render_stats* render_stats = nullptr);
+
+    // Draw whichever level of a model's lods suits the target's size.
+    void draw_textured_ortho(const ax::v3& light, const ax::model_lods& lods, ax::basic_buffer& buffer, ax::hierarchical_depth* hierarchical_depth = nullptr, ax::vertex_cache* vertex_cache = nullptr, ax::render_stats* render_stats = nullptr);
+    void draw_textured_ortho(const ax::v3& light, const ax::model_lods& lods, ax::planar_buffer& buffer, ax::hierarchical_depth* hierarchical_depth = nullptr, ax::vertex_cache* vertex_cache = nullptr, ax::render_stats* render_stats = nullptr);
+    void draw_textured_ortho_tiled(const ax::v3& light, const ax::model_lods& lods, ax::basic_buffer& buffer, int tile_size, ax::worker_pool& pool, ax::hierarchical_depth* hierarchical_depth = nullptr, ax::vertex_cache* vertex_cache = nullptr, ax::render_stats* render_stats = nullptr);
+    void draw_textured_ortho_tiled(const ax::v3& light, const ax::model_lods& lods, ax::planar_buffer& buffer, int tile_size, ax::worker_pool& pool, ax::hierarchical_depth* hierarchical_depth = nullptr, ax::vertex_cache* vertex_cache = nullptr, ax::render_stats* render_stats = nullptr);
+
+    // Draw many culled instances of one model in a single tiled draw, setting up each visible face once.
+    void draw_textured_ortho_instanced(const ax::basic_model& model, const ax::model_instance* instances, std::size_t instance_count, ax::basic_buffer& buffer, int tile_size = 64, ax::hierarchical_depth* hierarchical_depth = nullptr, ax::render_stats* render_stats = nullptr);
+    void draw_textured_ortho_instanced(const ax::basic_model& model, const ax::model_instance* instances, std::size_t instance_count, ax::basic_buffer& buffer, int tile_size, ax::worker_pool& pool, ax::hierarchical_depth* hierarchical_depth = nullptr, ax::render_stats* render_stats = nullptr);
+    void draw_textured_ortho_instanced(const ax::basic_model& model, const ax::model_instance* instances, std::size_t instance_count, ax::planar_buffer& buffer, int tile_size = 64, ax::hierarchical_depth* hierarchical_depth = nullptr, ax::render_stats* render_stats = nullptr);
+    void draw_textured_ortho_instanced(const ax::basic_model& model, const ax::model_instance* instances, std::size_t instance_count, ax::planar_buffer& buffer, int tile_size, ax::worker_pool& pool, ax::hierarchical_depth* hierarchical_depth = nullptr, ax::render_stats* render_stats = nullptr);
+
+    // Draw a model straight into a tga too large to hold in memory, band by band.
+    ax::option<std::string> try_draw_textured_ortho_to_tga(const ax::v3& light, const ax::basic_model& model, const ax::basic_pixel& clear_pixel, int width, int height, const char* file_path, int band_height = 64, int tile_size = 64, ax::render_stats* render_stats = nullptr);
+    ax::option<std::string> try_draw_textured_ortho_to_tga(const ax::v3& light, const ax::basic_model& model, const ax::basic_pixel& clear_pixel, int width, int height, const char* file_path, int band_height, int tile_size, ax::worker_pool& pool, ax::render_stats* render_stats = nullptr);
+
+    // Draw a model with deferred shading, shading each covered pixel once.
+    void draw_textured_ortho_deferred(const ax::v3& light, const ax::basic_model& model, ax::basic_buffer& buffer, int tile_size = 64, ax::visibility_buffer* visibility_buffer = nullptr, ax::vertex_cache* vertex_cache = nullptr, ax::render_stats* render_stats = nullptr);
+    void draw_textured_ortho_deferred(const ax::v3& light, const ax::basic_model& model, ax::basic_buffer& buffer, int tile_size, ax::worker_pool& pool, ax::visibility_buffer* visibility_buffer = nullptr, ax::vertex_cache* vertex_cache = nullptr, ax::render_stats* render_stats = nullptr);
+    void draw_textured_ortho_deferred(const ax::v3& light, const ax::basic_model& model, ax::planar_buffer& buffer, int tile_size = 64, ax::visibility_buffer* visibility_buffer = nullptr, ax::vertex_cache* vertex_cache = nullptr, ax::render_stats* render_stats = nullptr);
+    void draw_textured_ortho_deferred(const ax::v3& light, const ax::basic_model& model, ax::planar_buffer& buffer, int tile_size, ax::worker_pool& pool, ax::visibility_buffer* visibility_buffer = nullptr, ax::vertex_cache* vertex_cache = nullptr, ax::render_stats* render_stats = nullptr);
 }
 
 #endif
@@ -1,6 +1,8 @@
 #ifndef AX_BASIC_MODEL_HPP
 #define AX_BASIC_MODEL_HPP
 
+#include <cstdint>
+#include <memory>
 #include <vector>
 #include <string>
 #include <iosfwd>
@@ -8,6 +10,8 @@
 #include "math.hpp"
 #include "option.hpp"
 #include "basic_buffer.hpp"
+#include "basic_texture.hpp"
+#include "worker_pool.hpp"
 
 namespace ax
 {
@@ -18,6 +22,33 @@ namespace ax
         ax::v2 uv;
     };
 
+    // A pending load of a surface's maps, each decoding on its own worker pool job. Waiting loads
+    // any map no job has started yet on the waiting thread, so it's safe to wait from inside a
+    // job. The surface must be left alone until the load is waited on, which destroying the handle
+    // also does.
+    struct surface_load
+    {
+    public:
+
+        surface_load();
+        surface_load(surface_load&& that);
+        ~surface_load();
+        surface_load& operator=(surface_load&& that);
+        surface_load(const surface_load&) = delete;
+        surface_load& operator=(const surface_load&) = delete;
+
+        bool get_pending() const { return shared != nullptr; }
+
+        // Wait for every map to load, returning the first error among them.
+        ax::option<std::string> wait();
+
+    private:
+
+        friend struct basic_surface;
+        struct state;
+        std::shared_ptr<state> shared;
+    };
+
     struct basic_surface
     {
     public:
@@ -25,22 +56,30 @@ namespace ax
         basic_surface();
         ~basic_surface();
 
-        const ax::basic_buffer& get_diffuse_map() const { return diffuse_map; }
-        const ax::basic_buffer& get_tangent_map() const { return tangent_map; }
-        const ax::basic_buffer& get_specular_map() const { return specular_map; }
+        const ax::basic_texture& get_diffuse_map() const { return diffuse_map; }
+        const ax::basic_texture& get_tangent_map() const { return tangent_map; }
+        const ax::basic_texture& get_specular_map() const { return specular_map; }
 
-        void read_from_obj(const char* file_path);
+        // Load the maps kept next to an obj concurrently. Maps without a file are left empty,
+        // while maps that fail to decode are reported.
+        ax::surface_load read_from_obj_async(const char* file_path, ax::worker_pool& pool);
+        ax::option<std::string> try_read_from_obj(const char* file_path);
+        ax::option<std::string> try_read_from_obj(const char* file_path, ax::worker_pool& pool);
         void clear();
 
     private:
 
-        bool try_read_buffer_from_tga(std::string file_path, const char *suffix, ax::basic_buffer &buffer);
+        static ax::option<std::string> try_read_texture_from_tga(const std::string& file_path, const char* suffix, ax::texture_format format, ax::worker_pool& pool, ax::basic_texture& texture);
 
-        ax::basic_buffer diffuse_map;
-        ax::basic_buffer tangent_map;
-        ax::basic_buffer specular_map;
+        ax::basic_texture diffuse_map;
+        ax::basic_texture tangent_map;
+        ax::basic_texture specular_map;
     };
 
+    // A triangle-only indexed mesh. Loading triangulates polygons and welds each distinct
+    // position / uv / normal index triple into a single interleaved vertex, so that each face is
+    // just three entries of a flat index buffer. The obj's attribute lists are let go once welded,
+    // so indices everywhere refer to the welded vertices.
     struct basic_model
     {
     public:
@@ -48,6 +87,7 @@ namespace ax
         basic_model();
         ~basic_model();
 
+        int get_face_count() const { return static_cast<int>(indices.size() / 3_z); }
         std::vector<int> get_face(int index) const;
         ax::v3 get_position(int face_index, int vertex_index) const;
         ax::v3 get_position(int index) const;
@@ -56,22 +96,64 @@ namespace ax
         ax::v3 get_normal(int face_index, int vertex_index) const;
         ax::v3 get_normal(int index) const;
 
-        const std::vector<std::vector<ax::v3i>>& get_faces() const { return faces; }
-        const std::vector<ax::v3>& get_positions() const { return positions; }
-        const std::vector<ax::v2>& get_uvs() const { return uvs; }
-        const std::vector<ax::v3>& get_normals() const { return normals; }
+        const std::vector<ax::basic_vertex>& get_vertices() const { return vertices; }
+        const std::vector<uint32_t>& get_indices() const { return indices; }
         const ax::basic_surface& get_surface() const { return surface; }
 
+        // Copies of the faces and attributes laid out as they were before welding, each face
+        // corner's triple now indexing the vertex it refers to.
+        std::vector<std::vector<ax::v3i>> get_faces() const;
+        std::vector<ax::v3> get_positions() const;
+        std::vector<ax::v2> get_uvs() const;
+        std::vector<ax::v3> get_normals() const;
+
+        // An id for the current geometry, unique across models and changed whenever the geometry
+        // is replaced or reordered, so that caches built from it can tell when they're stale.
+        uint64_t get_geometry_version() const { return geometry_version; }
+
+        // Read an obj, memory-mapping it and parsing line-aligned chunks of it in parallel while
+        // the surface's maps load on the pool.
         ax::option<std::string> try_read_from_obj(const char* file_path);
+        ax::option<std::string> try_read_from_obj(const char* file_path, ax::worker_pool& pool);
+
+        // Read an obj through a binary cache next to it, reading the obj and (re)writing the cache
+        // only when the cache is missing or was made from a different version of the obj. Either
+        // way the geometry matches try_read_from_obj's.
+        ax::option<std::string> try_read_from_obj_cached(const char* file_path);
+        ax::option<std::string> try_read_from_obj_cached(const char* file_path, ax::worker_pool& pool);
+
+        // Read and write the geometry in a versioned binary format - a header followed by the
+        // aligned vertex and index arrays, read back with a memory mapping and a single bulk copy
+        // per array. Surfaces aren't included.
+        ax::option<std::string> try_read_from_binary(const char* file_path);
+        ax::option<std::string> try_write_to_binary(const char* file_path) const;
+
+        // Replace the geometry with attribute lists and the position / uv / normal index triple of
+        // each face corner, welding them just as an obj's are. The surface is kept.
+        void set_geometry(const std::vector<ax::v3>& positions, const std::vector<ax::v2>& uvs, const std::vector<ax::v3>& normals, const std::vector<ax::v3i>& corners);
+
+        // Reorder faces for post-transform vertex reuse, optionally within a spatial sort of
+        // them, then vertices into the order faces first use them. Faces keep their winding, and
+        // the geometry version changes so that caches notice.
+        void optimize_order(bool spatial_sort = false);
         void clear();
 
+        // The path of the binary cache kept for an obj.
+        static std::string get_binary_path(const char* obj_file_path);
+
     private:
 
-        // Faces in terms of position / uv / normal.
-        std::vector<std::vector<ax::v3i>> faces; 
-        std::vector<ax::v3> positions;
-        std::vector<ax::v2> uvs;
-        std::vector<ax::v3> normals;
+        ax::option<std::string> try_read_geometry_from_obj(const char* file_path, ax::worker_pool& pool);
+        ax::option<std::string> try_read_from_binary(const char* file_path, uint64_t source_size, int64_t source_time);
+        ax::option<std::string> try_write_to_binary(const char* file_path, uint64_t source_size, int64_t source_time) const;
+
+        void weld(const std::vector<ax::v3>& positions, const std::vector<ax::v2>& uvs, const std::vector<ax::v3>& normals, const std::vector<ax::v3i>& corners);
+        void clear_geometry();
+
+        // Vertices and their indices, three per face.
+        std::vector<ax::basic_vertex> vertices;
+        std::vector<uint32_t> indices;
+        uint64_t geometry_version;
         ax::basic_surface surface;
     };
 }
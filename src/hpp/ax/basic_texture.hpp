@@ -0,0 +1,121 @@
+#ifndef AX_BASIC_TEXTURE_HPP
+#define AX_BASIC_TEXTURE_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "prelude.hpp"
+#include "math.hpp"
+#include "option.hpp"
+#include "basic_buffer.hpp"
+#include "worker_pool.hpp"
+
+namespace ax
+{
+    // The texel format of a texture.
+    enum texture_format : int
+    {
+        texture_rgba8,  // full color, as for diffuse maps
+        texture_r8,     // a single channel, as for specular maps
+        texture_normal  // normals decoded once at load time, as for tangent maps
+    };
+
+    // How a texture addresses texels outside of [0, 1).
+    enum texture_address : int
+    {
+        texture_wrap,
+        texture_clamp
+    };
+
+    // One level of a texture's mip chain, stored at offset in the texture's texel data.
+    struct texture_level
+    {
+        int width;
+        int height;
+        int tiles_x;
+        std::size_t offset;
+    };
+
+    // A read-only texture of 8x8 Morton-ordered tiles holding only what its format needs.
+    struct basic_texture
+    {
+    public:
+
+        static constexpr int tile_size = 8;
+
+        basic_texture();
+        basic_texture(const ax::basic_buffer& buffer, ax::texture_format format, ax::texture_address address = ax::texture_wrap);
+        basic_texture(const basic_texture& that) = default;
+        ~basic_texture() = default;
+        basic_texture& operator=(const basic_texture& that) = default;
+
+        int get_width() const { return width; }
+        int get_height() const { return height; }
+        int get_level_count() const { return static_cast<int>(levels.size()); }
+        const ax::texture_level& get_level(int level) const { return levels[ax::itoz(level)]; }
+        ax::texture_format get_format() const { return format; }
+        ax::texture_address get_address() const { return address; }
+        int get_bytes_per_texel() const;
+
+        // Fetch a texel by its integer coordinates, which must be in bounds of the level.
+        ax::color get_color(int x, int y, int level = 0) const { return colors[get_index(levels[ax::itoz(level)], x, y)]; }
+        float get_value(int x, int y, int level = 0) const { return static_cast<float>(values[get_index(levels[ax::itoz(level)], x, y)]) / 255.0f; }
+        const ax::v3& get_normal(int x, int y, int level = 0) const { return normals[get_index(levels[ax::itoz(level)], x, y)]; }
+
+        // Generate the mip chain down to 1x1 with a box filter, replacing any existing one.
+        void generate_mips();
+        void generate_mips(ax::worker_pool& pool);
+
+        // Compute the level of detail from the uv differences across a 2x2 pixel quad.
+        float get_lod(const ax::v2& uv_dx, const ax::v2& uv_dy) const;
+
+        // Sample the nearest base texel, defaulting as ax::basic_buffer does when empty.
+        ax::color sample_diffuse(const ax::v2& position) const;
+        ax::v3 sample_tangent(const ax::v2& position) const;
+        float sample_specular(const ax::v2& position) const;
+
+        // Sample at a level of detail, blending the two nearest levels when minified.
+        ax::color sample_diffuse(const ax::v2& position, float lod) const;
+        ax::v3 sample_tangent(const ax::v2& position, float lod) const;
+        float sample_specular(const ax::v2& position, float lod) const;
+
+        ax::option<std::string> try_read_from_tga(const char* file_path, ax::texture_format format, ax::texture_address address = ax::texture_wrap);
+        void clear();
+
+    private:
+
+        // The indices and weights of the four texels a bilinear sample blends.
+        struct bilinear_taps
+        {
+            std::size_t indices[4];
+            float weight_x;
+            float weight_y;
+        };
+
+        // Interleave the low three bits of a coordinate with zeros.
+        static int spread_tile_bits(int i) { return (i & 1) | ((i & 2) << 1) | ((i & 4) << 2); }
+
+        static std::size_t get_index(const ax::texture_level& level, int x, int y)
+        {
+            VAL tile = (y >> 3) * level.tiles_x + (x >> 3);
+            VAL morton = spread_tile_bits(x & 7) | (spread_tile_bits(y & 7) << 1);
+            return level.offset + ax::itoz((tile << 6) | morton);
+        }
+
+        std::size_t get_index(int x, int y) const { return get_index(levels[0], x, y); }
+        std::size_t get_index(const ax::v2& position) const;
+        bilinear_taps get_taps(const ax::texture_level& level, const ax::v2& position) const;
+        void generate_level(const ax::texture_level& source, const ax::texture_level& target, int row_start, int row_end);
+
+        std::vector<ax::color> colors;
+        std::vector<uint8_t> values;
+        std::vector<ax::v3> normals;
+        std::vector<ax::texture_level> levels;
+        ax::texture_format format;
+        ax::texture_address address;
+        int width;
+        int height;
+    };
+}
+
+#endif
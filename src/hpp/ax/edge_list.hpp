@@ -0,0 +1,42 @@
+#ifndef AX_EDGE_LIST_HPP
+#define AX_EDGE_LIST_HPP
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "prelude.hpp"
+#include "basic_model.hpp"
+
+namespace ax
+{
+    // The unique edges of a model's faces as pairs of vertex indices, for drawing wireframes with
+    // each shared edge drawn once. Edges are told apart by their endpoints' positions, so edges
+    // split along uv or normal seams count as one.
+    //
+    // Like ax::vertex_cache, keeping one around between frames skips rebuilding it while the
+    // model's geometry version stays the same.
+    struct edge_list
+    {
+    public:
+
+        edge_list();
+        edge_list(const edge_list& that) = default;
+        ~edge_list() = default;
+        edge_list& operator=(const edge_list& that) = default;
+
+        const std::vector<std::pair<uint32_t, uint32_t>>& get_edges() const { return edges; }
+        bool get_current(const ax::basic_model& model) const;
+
+        // Build the model's edges unless the list is already current for it, returning them.
+        const std::vector<std::pair<uint32_t, uint32_t>>& update(const ax::basic_model& model);
+        void invalidate();
+
+    private:
+
+        std::vector<std::pair<uint32_t, uint32_t>> edges;
+        uint64_t model_geometry_version;
+    };
+}
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef AX_FRAME_PIPELINE_HPP
+#define AX_FRAME_PIPELINE_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "prelude.hpp"
+#include "option.hpp"
+#include "basic_buffer.hpp"
+
+namespace ax
+{
+    // A ring of render targets written in order on a background thread, fed by a single thread.
+    struct frame_pipeline
+    {
+    public:
+
+        // Writes a finished frame, returning any error.
+        using frame_writer = std::function<ax::option<std::string>(const ax::basic_buffer&)>;
+
+        // A buffer_count below two is raised to two - one to render while the other is written.
+        frame_pipeline(int width, int height, std::size_t buffer_count = 3_z);
+        ~frame_pipeline();
+        frame_pipeline(const frame_pipeline&) = delete;
+        frame_pipeline& operator=(const frame_pipeline&) = delete;
+
+        int get_width() const { return width; }
+        int get_height() const { return height; }
+        std::size_t get_buffer_count() const { return buffers.size(); }
+
+        // Take the next buffer to render into, uncleared, waiting while it's still queued.
+        ax::basic_buffer& acquire();
+
+        // Queue the acquired buffer to be written as a tga, or by a writer, returning immediately.
+        void submit(const std::string& file_path);
+        void submit(ax::frame_pipeline::frame_writer writer);
+
+        // Wait for every submitted frame to be written, returning the first error since the last.
+        ax::option<std::string> flush();
+
+    private:
+
+        void run();
+
+        int width;
+        int height;
+        std::vector<std::unique_ptr<ax::basic_buffer>> buffers;
+        std::deque<std::pair<std::size_t, ax::frame_pipeline::frame_writer>> queue;
+        std::size_t next;
+        std::size_t in_flight;
+        bool acquired;
+        bool stopping;
+        ax::option<std::string> error_opt;
+        std::mutex mutex;
+        std::condition_variable condition;
+        std::thread writer_thread;
+    };
+}
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef AX_HIERARCHICAL_DEPTH_HPP
+#define AX_HIERARCHICAL_DEPTH_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "prelude.hpp"
+#include "basic_buffer.hpp"
+#include "planar_buffer.hpp"
+
+namespace ax
+{
+    // The min and max depth of each 8x8 block of a render target, kept in sync with it by the user.
+    struct hierarchical_depth
+    {
+    public:
+
+        static constexpr int block_size = 8;
+
+        hierarchical_depth();
+        hierarchical_depth(int pixel_width, int pixel_height);
+        hierarchical_depth(const hierarchical_depth& that) = default;
+        ~hierarchical_depth() = default;
+        hierarchical_depth& operator=(const hierarchical_depth& that) = default;
+
+        int get_width() const { return width; }
+        int get_height() const { return height; }
+        float get_min(int x, int y) const { return mins[ax::itoz(x + y * width)]; }
+        float get_max(int x, int y) const { return maxes[ax::itoz(x + y * width)]; }
+
+        void fill(float depth);
+        void rebuild(const ax::basic_buffer& buffer);
+        void rebuild(const ax::planar_buffer& buffer);
+
+        // Whether depth_nearest could pass the depth test anywhere in the given block.
+        bool get_visible(int x, int y, float depth_nearest, const ax::basic_buffer& buffer);
+        bool get_visible(int x, int y, float depth_nearest, const ax::planar_buffer& buffer);
+
+        // Note that depths up to depth_max were written into the given block.
+        void note_written(int x, int y, float depth_max);
+
+    private:
+
+        void validate(const ax::basic_buffer& buffer) const;
+        void validate(const ax::planar_buffer& buffer) const;
+        template<typename Fn> void refresh(int x, int y, Fn get_depth);
+
+        std::vector<float> mins;
+        std::vector<float> maxes;
+        std::vector<uint8_t> stales;
+        int pixel_width;
+        int pixel_height;
+        int width;
+        int height;
+    };
+}
+
+#endif
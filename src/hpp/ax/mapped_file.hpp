@@ -0,0 +1,43 @@
+#ifndef AX_MAPPED_FILE_HPP
+#define AX_MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <string>
+
+#include "prelude.hpp"
+#include "option.hpp"
+
+namespace ax
+{
+    // A read-only memory mapping of a whole file.
+    struct mapped_file
+    {
+    public:
+
+        mapped_file();
+        ~mapped_file();
+        mapped_file(mapped_file&& that);
+        mapped_file& operator=(mapped_file&& that);
+        mapped_file(const mapped_file&) = delete;
+        mapped_file& operator=(const mapped_file&) = delete;
+
+        const char* get_data() const { return data; }
+        std::size_t get_size() const { return size; }
+        bool get_open() const { return open; }
+
+        ax::option<std::string> try_open(const char* file_path);
+        void close();
+
+    private:
+
+        const char* data;
+        std::size_t size;
+        bool open;
+#if defined(_WIN32)
+        void* file_handle;
+        void* mapping_handle;
+#endif
+    };
+}
+
+#endif
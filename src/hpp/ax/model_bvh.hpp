@@ -0,0 +1,68 @@
+#ifndef AX_MODEL_BVH_HPP
+#define AX_MODEL_BVH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "prelude.hpp"
+#include "math.hpp"
+#include "basic_model.hpp"
+#include "worker_pool.hpp"
+
+namespace ax
+{
+    // A face found by a query, its distance along a ray or from a box's center, and barycentrics.
+    struct face_hit
+    {
+        int face_index;
+        float distance;
+        ax::v3 barycentric;
+    };
+
+    // A 32-byte node, a leaf of count faces at index, or with a count of zero, children at index.
+    struct bvh_node
+    {
+        ax::v3 lower;
+        uint32_t index;
+        ax::v3 upper;
+        uint32_t count;
+    };
+
+    // A SAH-binned bounding volume hierarchy over a copy of a model's faces for ray and box queries.
+    struct model_bvh
+    {
+    public:
+
+        model_bvh();
+        model_bvh(const model_bvh& that) = default;
+        ~model_bvh() = default;
+        model_bvh& operator=(const model_bvh& that) = default;
+
+        std::size_t get_face_count() const { return faces.size(); }
+        const std::vector<ax::bvh_node>& get_nodes() const { return nodes; }
+        ax::box3 get_bounds() const;
+
+        void build(const ax::basic_model& model);
+        void build(const ax::basic_model& model, ax::worker_pool& pool);
+        void clear();
+
+        // Find the closest face a ray hits from either side within max_distance, or any one.
+        bool try_intersect(const ax::v3& origin, const ax::v3& direction, ax::face_hit& hit, float max_distance = std::numeric_limits<float>::max()) const;
+        bool try_intersect_any(const ax::v3& origin, const ax::v3& direction, ax::face_hit& hit, float max_distance = std::numeric_limits<float>::max()) const;
+
+        // Collect every face overlapping a box, in no particular order.
+        void get_overlaps(const ax::box3& box, std::vector<ax::face_hit>& hits) const;
+
+    private:
+
+        bool try_intersect(const ax::v3& origin, const ax::v3& direction, float max_distance, bool any, ax::face_hit& hit) const;
+
+        std::vector<ax::bvh_node> nodes;
+        std::vector<uint32_t> faces;
+        std::vector<ax::v3> corners;
+    };
+}
+
+#endif
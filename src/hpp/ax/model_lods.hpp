@@ -0,0 +1,45 @@
+#ifndef AX_MODEL_LODS_HPP
+#define AX_MODEL_LODS_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include "prelude.hpp"
+#include "math.hpp"
+#include "basic_model.hpp"
+
+namespace ax
+{
+    // Simplify a model's geometry toward target_face_count faces by quadric error edge collapses.
+    void simplify_model(const ax::basic_model& model, int target_face_count, ax::basic_model& simplified);
+
+    // A chain of halving simplified levels of a model, which is level zero and must outlive them.
+    struct model_lods
+    {
+    public:
+
+        model_lods();
+        model_lods(const model_lods& that) = default;
+        ~model_lods() = default;
+        model_lods& operator=(const model_lods& that) = default;
+
+        std::size_t get_level_count() const { return model ? levels.size() + 1_z : 0_z; }
+        const ax::basic_model& get_level(std::size_t index) const;
+        const ax::basic_model& get_model() const { return get_level(0_z); }
+
+        // Simplify levels down to about min_face_count faces.
+        void build(const ax::basic_model& model, int min_face_count = 256);
+        void clear();
+
+        // Select the coarsest level with a face for about every pixels_per_face covered pixels.
+        std::size_t select_level(int width, int height, float pixels_per_face = 4.0f) const;
+
+    private:
+
+        const ax::basic_model* model;
+        std::vector<ax::basic_model> levels;
+        ax::box2 bounds;
+    };
+}
+
+#endif
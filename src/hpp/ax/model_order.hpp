@@ -0,0 +1,34 @@
+#ifndef AX_MODEL_ORDER_HPP
+#define AX_MODEL_ORDER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "prelude.hpp"
+#include "basic_model.hpp"
+
+namespace ax
+{
+    // The average number of vertices transformed per face when drawing indices through a FIFO
+    // post-transform cache of cache_size vertices, between 0.5 for the best meshes and 3.0 when
+    // nothing is ever reused.
+    float get_vertex_cache_miss_ratio(const std::vector<uint32_t>& indices, std::size_t vertex_count, int cache_size = 16);
+
+    // Reorder faces so that consecutive faces reuse each other's vertices, using Tipsify's fans
+    // around recently used vertices. When cluster_face_count is positive, each run of that many
+    // faces is reordered on its own and the runs keep their order, preserving a coarser order
+    // such as a spatial sort.
+    void optimize_face_order(std::vector<uint32_t>& indices, std::size_t vertex_count, int cache_size = 16, std::size_t cluster_face_count = 0_z);
+
+    // Stably sort faces by the Morton code of their centroids within the vertices' bounds, so that
+    // faces near each other in space, and so in the framebuffer and usually the texture, are drawn
+    // near each other in time.
+    void sort_faces_spatially(const std::vector<ax::basic_vertex>& vertices, std::vector<uint32_t>& indices);
+
+    // Map each vertex to its position in the order the indices first use them, placing unused
+    // vertices last, so that vertex fetches during drawing mostly walk forward through memory.
+    std::vector<uint32_t> get_first_use_order(const std::vector<uint32_t>& indices, std::size_t vertex_count);
+}
+
+#endif
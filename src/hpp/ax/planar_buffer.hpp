@@ -0,0 +1,68 @@
+#ifndef AX_PLANAR_BUFFER_HPP
+#define AX_PLANAR_BUFFER_HPP
+
+#include <vector>
+
+#include "prelude.hpp"
+#include "math.hpp"
+#include "option.hpp"
+#include "basic_buffer.hpp"
+
+namespace ax
+{
+    // The planes a planar_buffer may allocate, combinable as flags.
+    enum planar_plane : int
+    {
+        plane_depth = 1,
+        plane_normal = 2,
+        plane_color = 4,
+        plane_all = plane_depth | plane_normal | plane_color
+    };
+
+    // A render target that keeps each pixel attribute in its own contiguous plane. Passes that
+    // touch a single attribute, like the depth test or a clear, then stream only that plane, and
+    // callers pay only for the planes they ask for (4 bytes per pixel for depth-only, 8 for
+    // depth and color, versus 20 for a basic_buffer).
+    struct planar_buffer
+    {
+    public:
+
+        planar_buffer();
+        planar_buffer(int w, int h, int planes = ax::plane_all);
+        planar_buffer(const planar_buffer& buffer) = default;
+        ~planar_buffer() = default;
+        planar_buffer& operator=(const planar_buffer& buffer) = default;
+
+        int get_width() const { return width; };
+        int get_height() const { return height; };
+        int get_planes() const { return planes; }
+        bool has_planes(int planes) const { return (this->planes & planes) == planes; }
+        int get_bytes_per_pixel() const;
+
+        float* get_depth_plane() { return depths.data(); }
+        const float* get_depth_plane() const { return depths.data(); }
+        ax::v3* get_normal_plane() { return normals.data(); }
+        const ax::v3* get_normal_plane() const { return normals.data(); }
+        ax::color* get_color_plane() { return colors.data(); }
+        const ax::color* get_color_plane() const { return colors.data(); }
+
+        void fill_depth(float depth);
+        void fill_normal(const ax::v3& normal);
+        void fill_color(const ax::color& color);
+        void fill(const ax::basic_pixel& pixel);
+        void clear();
+
+        ax::option<std::string> try_write_to_tga(const char* file_path) const;
+
+    private:
+
+        std::vector<float> depths;
+        std::vector<ax::v3> normals;
+        std::vector<ax::color> colors;
+        int planes;
+        int width;
+        int height;
+    };
+}
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef AX_RENDER_STATS_HPP
+#define AX_RENDER_STATS_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "prelude.hpp"
+#include "option.hpp"
+#include "basic_buffer.hpp"
+
+// Define AX_RENDER_STATS to gather render stats, else AX_RENDER_STAT statements compile away.
+#if defined(AX_RENDER_STATS)
+    #define AX_RENDER_STAT(...) __VA_ARGS__
+#else
+    #define AX_RENDER_STAT(...)
+#endif
+
+namespace ax
+{
+    // Counts of the work done by a draw.
+    struct render_counts
+    {
+        uint64_t triangles_submitted;
+        uint64_t triangles_backfacing;
+        uint64_t triangles_degenerate;
+        uint64_t triangles_offscreen;
+        uint64_t pixels_tested;
+        uint64_t depth_passes;
+        uint64_t depth_fails;
+    };
+
+    // Nanoseconds spent in each stage of a draw, with forward shading timed as rasterization.
+    struct render_times
+    {
+        uint64_t vertex;
+        uint64_t setup;
+        uint64_t raster;
+        uint64_t shade;
+    };
+
+    // Totals of the counts, stage times and per-pixel overdraw of the draws they're passed to.
+    struct render_stats
+    {
+    public:
+
+        render_stats();
+        render_stats(const render_stats&) = delete;
+        render_stats& operator=(const render_stats&) = delete;
+
+        ax::render_counts get_counts() const;
+        ax::render_times get_times() const;
+        int get_width() const { return width; }
+        int get_height() const { return height; }
+        uint32_t get_overdraw(int x, int y) const;
+        uint32_t* get_overdraw_in_place() { return overdraw.data(); }
+
+        void add(const ax::render_counts& counts);
+        void add(const ax::render_times& times);
+
+        // Size the overdraw counts for a width x height target, resetting them if its size changed.
+        void prepare(int width, int height);
+        void reset();
+
+        // Map each pixel's overdraw onto a blue-to-red ramp normalized to the largest count.
+        ax::basic_buffer get_overdraw_heatmap() const;
+        ax::option<std::string> try_write_overdraw_to_tga(const char* file_path) const;
+
+    private:
+
+        std::atomic<uint64_t> triangles_submitted;
+        std::atomic<uint64_t> triangles_backfacing;
+        std::atomic<uint64_t> triangles_degenerate;
+        std::atomic<uint64_t> triangles_offscreen;
+        std::atomic<uint64_t> pixels_tested;
+        std::atomic<uint64_t> depth_passes;
+        std::atomic<uint64_t> depth_fails;
+        std::atomic<uint64_t> vertex_time;
+        std::atomic<uint64_t> setup_time;
+        std::atomic<uint64_t> raster_time;
+        std::atomic<uint64_t> shade_time;
+        std::vector<uint32_t> overdraw;
+        int width;
+        int height;
+    };
+}
+
+#endif
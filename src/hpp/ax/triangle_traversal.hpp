@@ -0,0 +1,221 @@
+#ifndef AX_TRIANGLE_TRAVERSAL_HPP
+#define AX_TRIANGLE_TRAVERSAL_HPP
+
+#include <algorithm>
+
+#if defined(_MSC_VER)
+    #include <intrin.h>
+#endif
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define AX_TRAVERSAL_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define AX_TRAVERSAL_SSE2
+#endif
+
+#include "prelude.hpp"
+#include "math.hpp"
+
+namespace ax
+{
+    // The number of horizontally adjacent pixels tested together during traversal - 8 with AVX2,
+    // otherwise 4 (with SSE2 when available, else scalar).
+#if defined(AX_TRAVERSAL_AVX2)
+    constexpr int traversal_width = 8;
+#else
+    constexpr int traversal_width = 4;
+#endif
+
+    // The index of the lowest set bit of a non-zero coverage mask.
+    inline int get_lowest_bit_index(unsigned int mask)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return static_cast<int>(index);
+#else
+        return __builtin_ctz(mask);
+#endif
+    }
+
+    // The edge functions of a screen-space triangle, set up once per triangle. Each function is
+    // pre-scaled by the inverse of the triangle's signed area so that it directly evaluates the
+    // barycentric weight of its opposite vertex, making coverage winding-independent. Functions
+    // are evaluated relative to the first vertex to preserve precision on large targets.
+    struct triangle_edges
+    {
+        ax::v2 origin;
+        float steps_x[3];
+        float steps_y[3];
+        float offsets[3];
+        bool degenerate;
+    };
+
+    // One block of traversal_width horizontally adjacent pixels, starting at (x, y). Bit k of
+    // mask is set when pixel x + k is covered, in which case the k-th attributes are valid.
+    struct traversal_block
+    {
+        alignas(32) float depths[ax::traversal_width];
+        alignas(32) float us[ax::traversal_width];
+        alignas(32) float vs[ax::traversal_width];
+        alignas(32) float coords_1[ax::traversal_width];
+        alignas(32) float coords_2[ax::traversal_width];
+        int x;
+        int y;
+        unsigned int mask;
+    };
+
+    // Set up the edge functions of a screen-space triangle. Only triangles of exactly zero area
+    // are considered degenerate.
+    ax::triangle_edges make_triangle_edges(const ax::triangle2& triangle_screen);
+
+    // Visit each block of pixels of the inclusive bounds that the triangle covers, interpolating
+    // depth and uv across it. Sample points sit on integer pixel coordinates and edges are
+    // inclusive, matching ax::get_in_bounds. Blocks start on multiples of traversal_width.
+    template<typename Fn>
+    void traverse_triangle(const ax::triangle_edges& edges, const float (&depths)[3], const ax::triangle2& uvs, const ax::box2i& bounds, Fn fn)
+    {
+        // nothing to traverse
+        if (edges.degenerate || bounds.first.x > bounds.second.x || bounds.first.y > bounds.second.y) return;
+
+        // attribute deltas relative to the first vertex
+        VAL depth_0 = depths[0];
+        VAL depth_1 = depths[1] - depths[0];
+        VAL depth_2 = depths[2] - depths[0];
+        VAL u_0 = std::get<0>(uvs).x;
+        VAL u_1 = std::get<1>(uvs).x - u_0;
+        VAL u_2 = std::get<2>(uvs).x - u_0;
+        VAL v_0 = std::get<0>(uvs).y;
+        VAL v_1 = std::get<1>(uvs).y - v_0;
+        VAL v_2 = std::get<2>(uvs).y - v_0;
+
+        // align blocks to the traversal width
+        VAL left = bounds.first.x - (bounds.first.x & (ax::traversal_width - 1));
+        traversal_block block;
+
+#if defined(AX_TRAVERSAL_AVX2)
+        VAL ramp = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+        VAL zero = _mm256_setzero_ps();
+        __m256 step_x[3], lane_steps[3];
+        for (VAR k = 0; k < 3; ++k)
+        {
+            step_x[k] = _mm256_set1_ps(edges.steps_x[k]);
+            lane_steps[k] = _mm256_mul_ps(ramp, step_x[k]);
+        }
+        for (VAR j = bounds.first.y; j <= bounds.second.y; ++j)
+        {
+            // evaluate the row's term of each edge
+            VAL dy = static_cast<float>(j) - edges.origin.y;
+            __m256 rows[3];
+            for (VAR k = 0; k < 3; ++k) rows[k] = _mm256_add_ps(_mm256_set1_ps(edges.steps_y[k] * dy + edges.offsets[k]), lane_steps[k]);
+            for (VAR i = left; i <= bounds.second.x; i += ax::traversal_width)
+            {
+                // step the edges to the block, anchored at the row's term so that results don't
+                // depend on where traversal started
+                VAL dx = _mm256_set1_ps(static_cast<float>(i) - edges.origin.x);
+                __m256 e[3];
+                for (VAR k = 0; k < 3; ++k) e[k] = _mm256_add_ps(rows[k], _mm256_mul_ps(dx, step_x[k]));
+
+                // compute coverage, masking off lanes outside of bounds
+                VAL inside = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(e[0], zero, _CMP_GE_OQ), _mm256_cmp_ps(e[1], zero, _CMP_GE_OQ)), _mm256_cmp_ps(e[2], zero, _CMP_GE_OQ));
+                VAR mask = static_cast<unsigned int>(_mm256_movemask_ps(inside));
+                if (i < bounds.first.x) mask &= ~0u << (bounds.first.x - i);
+                if (i + ax::traversal_width - 1 > bounds.second.x) mask &= ~(~0u << (bounds.second.x - i + 1));
+                if (mask)
+                {
+                    // interpolate attributes
+                    block.x = i;
+                    block.y = j;
+                    block.mask = mask;
+                    _mm256_store_ps(block.coords_1, e[1]);
+                    _mm256_store_ps(block.coords_2, e[2]);
+                    _mm256_store_ps(block.depths, _mm256_add_ps(_mm256_set1_ps(depth_0), _mm256_add_ps(_mm256_mul_ps(e[1], _mm256_set1_ps(depth_1)), _mm256_mul_ps(e[2], _mm256_set1_ps(depth_2)))));
+                    _mm256_store_ps(block.us, _mm256_add_ps(_mm256_set1_ps(u_0), _mm256_add_ps(_mm256_mul_ps(e[1], _mm256_set1_ps(u_1)), _mm256_mul_ps(e[2], _mm256_set1_ps(u_2)))));
+                    _mm256_store_ps(block.vs, _mm256_add_ps(_mm256_set1_ps(v_0), _mm256_add_ps(_mm256_mul_ps(e[1], _mm256_set1_ps(v_1)), _mm256_mul_ps(e[2], _mm256_set1_ps(v_2)))));
+                    fn(static_cast<const ax::traversal_block&>(block));
+                }
+            }
+        }
+#elif defined(AX_TRAVERSAL_SSE2)
+        VAL ramp = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+        VAL zero = _mm_setzero_ps();
+        __m128 step_x[3], lane_steps[3];
+        for (VAR k = 0; k < 3; ++k)
+        {
+            step_x[k] = _mm_set1_ps(edges.steps_x[k]);
+            lane_steps[k] = _mm_mul_ps(ramp, step_x[k]);
+        }
+        for (VAR j = bounds.first.y; j <= bounds.second.y; ++j)
+        {
+            // evaluate the row's term of each edge
+            VAL dy = static_cast<float>(j) - edges.origin.y;
+            __m128 rows[3];
+            for (VAR k = 0; k < 3; ++k) rows[k] = _mm_add_ps(_mm_set1_ps(edges.steps_y[k] * dy + edges.offsets[k]), lane_steps[k]);
+            for (VAR i = left; i <= bounds.second.x; i += ax::traversal_width)
+            {
+                // step the edges to the block, anchored at the row's term so that results don't
+                // depend on where traversal started
+                VAL dx = _mm_set1_ps(static_cast<float>(i) - edges.origin.x);
+                __m128 e[3];
+                for (VAR k = 0; k < 3; ++k) e[k] = _mm_add_ps(rows[k], _mm_mul_ps(dx, step_x[k]));
+
+                // compute coverage, masking off lanes outside of bounds
+                VAL inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e[0], zero), _mm_cmpge_ps(e[1], zero)), _mm_cmpge_ps(e[2], zero));
+                VAR mask = static_cast<unsigned int>(_mm_movemask_ps(inside));
+                if (i < bounds.first.x) mask &= ~0u << (bounds.first.x - i);
+                if (i + ax::traversal_width - 1 > bounds.second.x) mask &= ~(~0u << (bounds.second.x - i + 1));
+                if (mask)
+                {
+                    // interpolate attributes
+                    block.x = i;
+                    block.y = j;
+                    block.mask = mask;
+                    _mm_store_ps(block.coords_1, e[1]);
+                    _mm_store_ps(block.coords_2, e[2]);
+                    _mm_store_ps(block.depths, _mm_add_ps(_mm_set1_ps(depth_0), _mm_add_ps(_mm_mul_ps(e[1], _mm_set1_ps(depth_1)), _mm_mul_ps(e[2], _mm_set1_ps(depth_2)))));
+                    _mm_store_ps(block.us, _mm_add_ps(_mm_set1_ps(u_0), _mm_add_ps(_mm_mul_ps(e[1], _mm_set1_ps(u_1)), _mm_mul_ps(e[2], _mm_set1_ps(u_2)))));
+                    _mm_store_ps(block.vs, _mm_add_ps(_mm_set1_ps(v_0), _mm_add_ps(_mm_mul_ps(e[1], _mm_set1_ps(v_1)), _mm_mul_ps(e[2], _mm_set1_ps(v_2)))));
+                    fn(static_cast<const ax::traversal_block&>(block));
+                }
+            }
+        }
+#else
+        for (VAR j = bounds.first.y; j <= bounds.second.y; ++j)
+        {
+            // evaluate the row's term of each edge
+            VAL dy = static_cast<float>(j) - edges.origin.y;
+            float rows[3];
+            for (VAR k = 0; k < 3; ++k) rows[k] = edges.steps_y[k] * dy + edges.offsets[k];
+            for (VAR i = left; i <= bounds.second.x; i += ax::traversal_width)
+            {
+                // compute coverage and attributes a lane at a time
+                VAL dx = static_cast<float>(i) - edges.origin.x;
+                VAR mask = 0u;
+                for (VAR lane = 0; lane < ax::traversal_width; ++lane)
+                {
+                    VAL x = i + lane;
+                    float e[3];
+                    for (VAR k = 0; k < 3; ++k) e[k] = rows[k] + static_cast<float>(lane) * edges.steps_x[k] + dx * edges.steps_x[k];
+                    if (x >= bounds.first.x && x <= bounds.second.x && e[0] >= 0.0f && e[1] >= 0.0f && e[2] >= 0.0f) mask |= 1u << lane;
+                    block.coords_1[lane] = e[1];
+                    block.coords_2[lane] = e[2];
+                    block.depths[lane] = depth_0 + e[1] * depth_1 + e[2] * depth_2;
+                    block.us[lane] = u_0 + e[1] * u_1 + e[2] * u_2;
+                    block.vs[lane] = v_0 + e[1] * v_1 + e[2] * v_2;
+                }
+                if (mask)
+                {
+                    block.x = i;
+                    block.y = j;
+                    block.mask = mask;
+                    fn(static_cast<const ax::traversal_block&>(block));
+                }
+            }
+        }
+#endif
+    }
+}
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef AX_VERTEX_CACHE_HPP
+#define AX_VERTEX_CACHE_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "prelude.hpp"
+#include "math.hpp"
+#include "basic_model.hpp"
+#include "worker_pool.hpp"
+
+namespace ax
+{
+    // A model position transformed into the screen-space of a render target.
+    struct screen_vertex
+    {
+        ax::v2 position;
+        float depth;
+    };
+
+    // Transform a model-space position into the screen-space of a width x height target.
+    ax::screen_vertex get_screen_vertex(const ax::v3& position, int width, int height);
+
+    // The output of the vertex stage - each vertex of a model transformed exactly once, in the
+    // model's vertex order, so that triangle setup can index into it rather than re-transforming
+    // every shared vertex for each face referencing it.
+    //
+    // Keeping a cache around between frames skips the vertex stage entirely while the model and
+    // target size stay the same. A model whose geometry is reloaded or reordered is noticed by its
+    // geometry version.
+    struct vertex_cache
+    {
+    public:
+
+        vertex_cache();
+        vertex_cache(const vertex_cache& that) = default;
+        ~vertex_cache() = default;
+        vertex_cache& operator=(const vertex_cache& that) = default;
+
+        const std::vector<ax::screen_vertex>& get_vertices() const { return vertices; }
+        bool get_current(const ax::basic_model& model, int width, int height) const;
+
+        // Run the vertex stage for the model on a width x height target unless the cache is
+        // already current for them, returning the transformed vertices.
+        const std::vector<ax::screen_vertex>& update(const ax::basic_model& model, int width, int height);
+        const std::vector<ax::screen_vertex>& update(const ax::basic_model& model, int width, int height, ax::worker_pool& pool);
+        void invalidate();
+
+    private:
+
+        void transform(const ax::basic_model& model, std::size_t begin, std::size_t end);
+
+        std::vector<ax::screen_vertex> vertices;
+        uint64_t model_geometry_version;
+        int width;
+        int height;
+    };
+}
+
+#endif
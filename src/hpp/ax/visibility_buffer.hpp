@@ -0,0 +1,55 @@
+#ifndef AX_VISIBILITY_BUFFER_HPP
+#define AX_VISIBILITY_BUFFER_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "prelude.hpp"
+
+namespace ax
+{
+    // What a pixel of a visibility buffer sees - the depth and index of the nearest triangle
+    // covering it, along with the barycentric weights of its second and third vertices there.
+    struct visibility_sample
+    {
+        float depth;
+        uint32_t triangle;
+        float coords_1;
+        float coords_2;
+    };
+
+    // The output of the first pass of deferred shading. Rasterizing only records which triangle
+    // each pixel sees, leaving all texture sampling and lighting to a second pass that then runs
+    // exactly once per covered pixel no matter how many triangles overlap it.
+    struct visibility_buffer
+    {
+    public:
+
+        static constexpr uint32_t no_triangle = 0xFFFFFFFFu;
+
+        visibility_buffer();
+        visibility_buffer(int w, int h);
+        visibility_buffer(const visibility_buffer& that) = default;
+        ~visibility_buffer() = default;
+        visibility_buffer& operator=(const visibility_buffer& that) = default;
+
+        int get_width() const { return width; }
+        int get_height() const { return height; }
+        ax::visibility_sample& get_sample_in_place(int x, int y);
+        const ax::visibility_sample& get_sample(int x, int y) const;
+        ax::visibility_sample* get_samples() { return samples.data(); }
+        const ax::visibility_sample* get_samples() const { return samples.data(); }
+
+        // Resize to w x h, keeping samples only when the size is unchanged.
+        void resize(int w, int h);
+        void clear();
+
+    private:
+
+        std::vector<ax::visibility_sample> samples;
+        int width;
+        int height;
+    };
+}
+
+#endif
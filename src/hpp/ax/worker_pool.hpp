@@ -0,0 +1,120 @@
+#ifndef AX_WORKER_POOL_HPP
+#define AX_WORKER_POOL_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+
+#include "prelude.hpp"
+
+namespace ax
+{
+    // A fixed-size pool of worker threads that run submitted jobs in FIFO order.
+    struct worker_pool
+    {
+    public:
+
+        // A thread_count of zero means one thread per hardware thread.
+        explicit worker_pool(std::size_t thread_count = 0_z);
+        ~worker_pool();
+        worker_pool(const worker_pool&) = delete;
+        worker_pool& operator=(const worker_pool&) = delete;
+
+        std::size_t get_thread_count() const { return threads.size(); }
+
+        // Submit a job, returning a future to its result.
+        template<typename Fn>
+        VAR submit(Fn fn) -> std::future<decltype(fn())>
+        {
+            using result_t = decltype(fn());
+            VAL task = std::make_shared<std::packaged_task<result_t()>>(std::move(fn));
+            VAR future = task->get_future();
+            enqueue([task]() { (*task)(); });
+            return future;
+        }
+
+        // Invoke fn(i) for each i in [0, count), spreading indices dynamically over the workers
+        // and the calling thread. Returns once every invocation has completed. Since the caller
+        // drains the indices itself, this is safe to call from inside a job. If fn throws, no
+        // further indices are handed out, and the first exception is rethrown here once every
+        // invocation already started has returned.
+        void parallel_for(std::size_t count, const std::function<void(std::size_t)>& fn);
+
+        // The process-wide pool, sized to the hardware concurrency.
+        static ax::worker_pool& get_default();
+
+    private:
+
+        void enqueue(std::function<void()> job);
+        void run();
+
+        std::vector<std::thread> threads;
+        std::deque<std::function<void()>> jobs;
+        std::mutex jobs_mutex;
+        std::condition_variable jobs_condition;
+        bool stopping;
+    };
+
+    // A batch of jobs that each run once, by a pool job unless the thread waiting on them gets to
+    // it first, so that waiting from inside a job of a busy pool can't deadlock.
+    template<typename Result>
+    struct claimed_jobs
+    {
+    public:
+
+        explicit claimed_jobs(std::vector<std::function<Result()>> jobs) :
+            jobs(std::move(jobs)),
+            results(this->jobs.size()),
+            claims(new std::atomic<bool>[this->jobs.size()]),
+            completed(0_z),
+            mutex(),
+            condition()
+        {
+            for (VAR i = 0_z; i < this->jobs.size(); ++i) claims[i] = false;
+        }
+
+        claimed_jobs(const claimed_jobs&) = delete;
+        claimed_jobs& operator=(const claimed_jobs&) = delete;
+
+        std::size_t get_count() const { return jobs.size(); }
+
+        // Run a job unless another thread already claimed it.
+        void run(std::size_t index)
+        {
+            if (claims[index].exchange(true)) return;
+            results[index] = jobs[index]();
+            if (++completed == jobs.size())
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                condition.notify_all();
+            }
+        }
+
+        // Run whatever no job has started, then wait on the rest, returning every job's result.
+        const std::vector<Result>& wait()
+        {
+            for (VAR i = 0_z; i < jobs.size(); ++i) run(i);
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this]() { return completed.load() >= jobs.size(); });
+            return results;
+        }
+
+    private:
+
+        std::vector<std::function<Result()>> jobs;
+        std::vector<Result> results;
+        std::unique_ptr<std::atomic<bool>[]> claims;
+        std::atomic<std::size_t> completed;
+        std::mutex mutex;
+        std::condition_variable condition;
+    };
+}
+
+#endif